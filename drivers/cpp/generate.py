@@ -0,0 +1,364 @@
+#!/bin/env python
+
+"""
+Compile a model in the text format into a C++ translation unit.
+
+    generate.py [-n NAMESPACE] [-o BASENAME] < MODEL
+
+This writes BASENAME.h and BASENAME.cpp (default: model.h and model.cpp)
+for a binary, multi, or candidate model. The feature names (attribute names
+for a multi model) and weights are stored in constant arrays, which the
+linker places in read-only pages, and a feature is found by a minimal
+perfect hash function (hash and displace with FNV-1a), so the compiled
+model needs neither file I/O nor initialization at run time.
+"""
+
+import sys
+import optparse
+
+def fnv1a(key, seed):
+    h = (2166136261 ^ seed) & 0xFFFFFFFF
+    for c in bytearray(key):
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+def perfect_hash(keys):
+    """ Build a minimal perfect hash (hash and displace) of the keys.
+
+    A key is placed to the slot fnv1a(key, d) % n, where d is the
+    displacement of the bucket fnv1a(key, 0) % n. A displacement d < 0
+    places the (single) key of the bucket to the slot -d-1 directly.
+    """
+    n = len(keys)
+    buckets = [[] for i in range(n)]
+    for i, key in enumerate(keys):
+        buckets[fnv1a(key, 0) % n].append(i)
+
+    displacements = [0] * n
+    slots = [-1] * n
+    order = sorted(range(n), key=lambda b: len(buckets[b]), reverse=True)
+
+    # Place the buckets with multiple keys by searching displacements.
+    k = 0
+    while k < n and 1 < len(buckets[order[k]]):
+        b = order[k]
+        d = 1
+        while True:
+            placed = set()
+            for i in buckets[b]:
+                s = fnv1a(keys[i], d) % n
+                if slots[s] != -1 or s in placed:
+                    break
+                placed.add(s)
+            else:
+                break
+            d += 1
+        for i in buckets[b]:
+            slots[fnv1a(keys[i], d) % n] = i
+        displacements[b] = d
+        k += 1
+
+    # Place the buckets with a single key to the free slots.
+    free = [s for s in range(n) if slots[s] == -1]
+    for b in order[k:]:
+        if not buckets[b]:
+            break
+        s = free.pop()
+        slots[s] = buckets[b][0]
+        displacements[b] = -s - 1
+
+    return displacements, slots
+
+def cstring(key):
+    """ Escape a key for a C string literal. """
+    out = []
+    for c in bytearray(key):
+        if c == 0x5C or c == 0x22:
+            out.append('\\' + chr(c))
+        elif 0x20 <= c < 0x7F and c != 0x3F:
+            out.append(chr(c))
+        else:
+            out.append('\\%03o' % c)
+    return '"' + ''.join(out) + '"'
+
+def double(w):
+    return repr(float(w))
+
+def read_model(fi):
+    """ Read a model in the text format. """
+    mtype = fi.readline().rstrip(b'\r\n')
+    labels = []
+    features = []
+    for line in fi:
+        line = line.rstrip(b'\r\n')
+        if line.startswith(b'@label\t'):
+            labels.append(line[7:])
+            continue
+        if not line or line.startswith(b'@'):
+            continue
+        fields = line.split(b'\t', 1)
+        if len(fields) != 2 or not fields[1]:
+            raise ValueError('broken feature weight: %r' % line)
+        features.append((fields[1], float(fields[0])))
+    return mtype, labels, features
+
+class Common:
+    @staticmethod
+    def lookup(fo, name, n):
+        if n == 0:
+            fo.write('''
+int %s(const char *name, size_t length)
+{
+    return -1;
+}
+''' % name)
+            return
+        fo.write('''
+static inline unsigned int hash(const char *str, size_t length, unsigned int seed)
+{
+    // FNV-1a.
+    unsigned int h = 2166136261U ^ seed;
+    for (size_t i = 0;i < length;++i) {
+        h = (h ^ (unsigned char)str[i]) * 16777619U;
+    }
+    return h;
+}
+
+int %s(const char *name, size_t length)
+{
+    const int d = displacements[hash(name, length, 0) %% NUM_KEYS];
+    const int i = (d < 0) ? -d-1 : (int)(hash(name, length, (unsigned int)d) %% NUM_KEYS);
+    if (lengths[i] == length && std::memcmp(keys[i], name, length) == 0) {
+        return i;
+    }
+    return -1;
+}
+''' % name)
+
+    @staticmethod
+    def tables(fo, keys):
+        displacements, slots = perfect_hash(keys)
+        n = len(keys)
+        fo.write('enum { NUM_KEYS = %d };\n\n' % n)
+        fo.write('static const int displacements[%d] = {\n' % max(n, 1))
+        for i in range(0, max(n, 1), 8):
+            fo.write('    %s,\n' % ', '.join(str(d) for d in (displacements[i:i+8] or [0])))
+        fo.write('};\n\n')
+        fo.write('static const char * const keys[%d] = {\n' % max(n, 1))
+        for s in slots or [None]:
+            fo.write('    %s,\n' % (cstring(keys[s]) if s is not None else '""'))
+        fo.write('};\n\n')
+        fo.write('static const size_t lengths[%d] = {\n' % max(n, 1))
+        for s in slots or [None]:
+            fo.write('    %d,\n' % (len(keys[s]) if s is not None else 0))
+        fo.write('};\n\n')
+        return slots
+
+class Binary:
+    """ binary and candidate models: feature -> weight """
+    @staticmethod
+    def header(fo, bias):
+        fo.write('''
+/**
+ * Finds a feature.
+ *  @return int         The feature number, or -1 for an unknown feature.
+ */
+int feature(const char *name, size_t length);
+
+/**
+ * Returns the weight of a feature.
+ */
+double weight(int i);
+
+/**
+ * Computes the score of %s.
+ *  @param  names       The array of null-terminated feature names.
+ *  @param  values      The array of feature values, or NULL for 1.0.
+ *  @param  n           The number of features.
+ */
+double score(const char * const *names, const double *values, size_t n);
+''' % ('an instance (including the bias feature)' if bias else 'a candidate'))
+
+    @staticmethod
+    def source(fo, features, bias):
+        keys = [f for f, w in features]
+        weights = dict(features)
+        slots = Common.tables(fo, keys)
+        fo.write('static const double weights[%d] = {\n' % max(len(keys), 1))
+        for s in slots or [None]:
+            fo.write('    %s,\n' % (double(weights[keys[s]]) if s is not None else '0.'))
+        fo.write('};\n\n')
+        fo.write('static const double BIAS = %s;\n' % double(weights.get(b'__BIAS__', 0.) if bias else 0.))
+        Common.lookup(fo, 'feature', len(keys))
+        fo.write('''
+double weight(int i)
+{
+    return weights[i];
+}
+
+double score(const char * const *names, const double *values, size_t n)
+{
+    double s = BIAS;
+    for (size_t i = 0;i < n;++i) {
+        int f = feature(names[i], std::strlen(names[i]));
+        if (0 <= f) {
+            s += weights[f] * (values != NULL ? values[i] : 1.);
+        }
+    }
+    return s;
+}
+''')
+
+class Multi:
+    """ multi models: attribute -> row of (label, weight) """
+    @staticmethod
+    def header(fo, bias):
+        fo.write('''
+/// The number of labels.
+enum { NUM_LABELS = %d };
+
+/**
+ * Returns a label.
+ */
+const char *label(int l);
+
+/**
+ * Finds an attribute.
+ *  @return int         The attribute number, or -1 for an unknown
+ *                      attribute.
+ */
+int attribute(const char *name, size_t length);
+
+/**
+ * Computes the scores of the labels (including the bias feature).
+ *  @param  attributes  The array of null-terminated attribute names.
+ *  @param  values      The array of attribute values, or NULL for 1.0.
+ *  @param  n           The number of attributes.
+ *  @param  scores      The array receiving NUM_LABELS scores.
+ *  @return int         The label number of the highest score.
+ */
+int score_labels(const char * const *attributes, const double *values, size_t n, double *scores);
+''' % bias)
+
+    @staticmethod
+    def source(fo, labels, features):
+        # Group the features by the attributes.
+        label_numbers = dict((l, i) for i, l in enumerate(labels))
+        rows = {}
+        keys = []
+        for f, w in features:
+            p = f.rfind(b'\t')
+            if p < 0:
+                raise ValueError('label is missing: %r' % f)
+            l = label_numbers.get(f[p+1:])
+            if l is None:
+                # Ignore a feature of a label not listed in the model.
+                continue
+            a = f[:p]
+            if a not in rows:
+                rows[a] = []
+                keys.append(a)
+            rows[a].append((l, w))
+
+        fo.write('static const char * const labels[%d] = {\n' % max(len(labels), 1))
+        for l in labels or [b'']:
+            fo.write('    %s,\n' % cstring(l))
+        fo.write('};\n\n')
+
+        slots = Common.tables(fo, keys)
+        offsets = [0]
+        cells = []
+        for s in slots:
+            cells.extend(rows[keys[s]])
+            offsets.append(len(cells))
+        fo.write('static const int rows[%d] = {\n' % len(offsets))
+        for i in range(0, len(offsets), 8):
+            fo.write('    %s,\n' % ', '.join(str(o) for o in offsets[i:i+8]))
+        fo.write('};\n\n')
+        fo.write('static const int row_labels[%d] = {\n' % max(len(cells), 1))
+        for i in range(0, max(len(cells), 1), 8):
+            fo.write('    %s,\n' % ', '.join(str(l) for l, w in (cells[i:i+8] or [(0, 0.)])))
+        fo.write('};\n\n')
+        fo.write('static const double row_weights[%d] = {\n' % max(len(cells), 1))
+        for l, w in cells or [(0, 0.)]:
+            fo.write('    %s,\n' % double(w))
+        fo.write('};\n')
+
+        Common.lookup(fo, 'attribute', len(keys))
+        fo.write('''
+const char *label(int l)
+{
+    return labels[l];
+}
+
+static inline void add_row(double *scores, int a, double value)
+{
+    for (int i = rows[a];i < rows[a+1];++i) {
+        scores[row_labels[i]] += row_weights[i] * value;
+    }
+}
+
+int score_labels(const char * const *attributes, const double *values, size_t n, double *scores)
+{
+    for (int l = 0;l < NUM_LABELS;++l) {
+        scores[l] = 0.;
+    }
+    const int bias = attribute("__BIAS__", 8);
+    if (0 <= bias) {
+        add_row(scores, bias, 1.);
+    }
+    for (size_t i = 0;i < n;++i) {
+        int a = attribute(attributes[i], std::strlen(attributes[i]));
+        if (0 <= a) {
+            add_row(scores, a, values != NULL ? values[i] : 1.);
+        }
+    }
+
+    int k = 0;
+    for (int l = 1;l < NUM_LABELS;++l) {
+        if (scores[k] < scores[l]) {
+            k = l;
+        }
+    }
+    return k;
+}
+''')
+
+if __name__ == '__main__':
+    parser = optparse.OptionParser(usage='%prog [-n NAMESPACE] [-o BASENAME] < MODEL')
+    parser.add_option('-n', '--namespace', default='classias_model', help='the namespace of the model')
+    parser.add_option('-o', '--output', default='model', help='write BASENAME.h and BASENAME.cpp')
+    (options, args) = parser.parse_args()
+
+    fi = getattr(sys.stdin, 'buffer', sys.stdin)
+    mtype, labels, features = read_model(fi)
+    if mtype == b'@classias\tlinear\tbinary':
+        cls, bias = Binary, True
+    elif mtype == b'@classias\tlinear\tcandidate':
+        cls, bias = Binary, False
+    elif mtype.startswith(b'@classias\tlinear\tmulti\t'):
+        cls, bias = Multi, len(labels)
+    else:
+        sys.stderr.write('ERROR: unknown model type: %r\n' % mtype)
+        sys.exit(1)
+
+    ns = options.namespace
+    guard = '__%s_H__' % ns.upper()
+    basename = options.output.replace('\\', '/').split('/')[-1]
+
+    fo = open(options.output + '.h', 'w')
+    fo.write('/* Generated by classias drivers/cpp/generate.py; do not edit. */\n\n')
+    fo.write('#ifndef %s\n#define %s\n\n#include <stddef.h>\n\nnamespace %s\n{\n' % (guard, guard, ns))
+    cls.header(fo, bias)
+    fo.write('\n};\n\n#endif/*%s*/\n' % guard)
+    fo.close()
+
+    fo = open(options.output + '.cpp', 'w')
+    fo.write('/* Generated by classias drivers/cpp/generate.py; do not edit. */\n\n')
+    fo.write('#include <cstring>\n\n#include "%s.h"\n\nnamespace %s\n{\n\n' % (basename, ns))
+    if cls is Multi:
+        Multi.source(fo, labels, features)
+    else:
+        Binary.source(fo, features, bias)
+    fo.write('\n};\n')
+    fo.close()
@@ -0,0 +1,475 @@
+/*
+ *		Python extension module for scoring with classias models.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+/*
+ * Usage:
+ *
+ *   import classias
+ *   model = classias.Model('model.txt')     # in the text or binary format
+ *   for label, score, prob in model.predict(instances):
+ *       ...
+ *
+ * An instance of a binary or multi model is a sequence of features, and an
+ * instance of a candidate model is a sequence of candidates, each of which
+ * is a sequence of features. A feature is a name (str or bytes) with the
+ * value 1.0, or a pair of a name and a value. The predicted label is a
+ * bool (binary), a label string (multi), or the index of a candidate
+ * (candidate); the probability is computed by the logistic (binary) or
+ * softmax function (multi and candidate).
+ *
+ * predict() converts the batch of instances into arrays with the GIL held,
+ * and scores the whole batch with the GIL released. The batch holds a
+ * reference to every feature name, so that the caller may modify the
+ * instances from another thread meanwhile; a model cannot be reloaded by
+ * Model.__init__() while it is predicting.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <exception>
+#include <string>
+#include <vector>
+
+#include <classias/predictor.h>
+
+typedef struct {
+    PyObject_HEAD
+    classias::predictor* predictor;
+    /// The number of predict() calls running with the GIL released.
+    int num_busy;
+} ModelObject;
+
+/**
+ * A batch of instances converted into arrays.
+ */
+struct batch_type
+{
+    /// The feature names (pointing to the buffers of the Python objects in
+    /// objects).
+    std::vector<const char*> names;
+    /// The lengths of the feature names.
+    std::vector<size_t> lengths;
+    /// The feature values.
+    std::vector<double> values;
+    /// The offsets of the feature groups (instances or candidates) in
+    /// the features, with the end of the last group appended.
+    std::vector<size_t> groups;
+    /// The offsets of the instances in the groups (candidate), with the
+    /// end of the last instance appended.
+    std::vector<size_t> instances;
+    /// The sequences and feature names referred by the batch, which must
+    /// be kept alive until the batch is scored.
+    std::vector<PyObject*> objects;
+
+    ~batch_type()
+    {
+        for (size_t i = 0;i < objects.size();++i) {
+            Py_DECREF(objects[i]);
+        }
+    }
+};
+
+static int get_name(batch_type& batch, PyObject* obj, const char** name, size_t* length)
+{
+    Py_ssize_t size = 0;
+    if (PyUnicode_Check(obj)) {
+        *name = PyUnicode_AsUTF8AndSize(obj, &size);
+        if (*name == NULL) {
+            return -1;
+        }
+    } else if (PyBytes_Check(obj)) {
+        char *buffer = NULL;
+        if (PyBytes_AsStringAndSize(obj, &buffer, &size) != 0) {
+            return -1;
+        }
+        *name = buffer;
+    } else {
+        PyErr_SetString(PyExc_TypeError, "a feature name must be str or bytes");
+        return -1;
+    }
+    *length = (size_t)size;
+
+    // Keep the name alive even if the caller drops it from the instance.
+    Py_INCREF(obj);
+    batch.objects.push_back(obj);
+    return 0;
+}
+
+static PyObject* get_sequence(batch_type& batch, PyObject* obj, const char* message)
+{
+    PyObject* seq = PySequence_Fast(obj, message);
+    if (seq != NULL) {
+        batch.objects.push_back(seq);
+    }
+    return seq;
+}
+
+static int append_group(batch_type& batch, PyObject* features)
+{
+    PyObject* seq = get_sequence(batch, features, "a sequence of features is expected");
+    if (seq == NULL) {
+        return -1;
+    }
+
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0;i < n;++i) {
+        PyObject* item = PySequence_Fast_GET_ITEM(seq, i);
+        const char* name = NULL;
+        size_t length = 0;
+        double value = 1.;
+
+        if (PyUnicode_Check(item) || PyBytes_Check(item)) {
+            // A feature name with the value 1.0.
+            if (get_name(batch, item, &name, &length) != 0) {
+                return -1;
+            }
+        } else {
+            // A pair of a feature name and value.
+            PyObject* pair = get_sequence(batch, item, "a feature must be a name or a (name, value) pair");
+            if (pair == NULL) {
+                return -1;
+            }
+            if (PySequence_Fast_GET_SIZE(pair) != 2) {
+                PyErr_SetString(PyExc_TypeError, "a feature must be a name or a (name, value) pair");
+                return -1;
+            }
+            if (get_name(batch, PySequence_Fast_GET_ITEM(pair, 0), &name, &length) != 0) {
+                return -1;
+            }
+            value = PyFloat_AsDouble(PySequence_Fast_GET_ITEM(pair, 1));
+            if (value == -1. && PyErr_Occurred()) {
+                return -1;
+            }
+        }
+
+        batch.names.push_back(name);
+        batch.lengths.push_back(length);
+        batch.values.push_back(value);
+    }
+
+    batch.groups.push_back(batch.names.size());
+    return 0;
+}
+
+static int convert_batch(batch_type& batch, PyObject* instances, bool candidate)
+{
+    PyObject* seq = get_sequence(batch, instances, "a sequence of instances is expected");
+    if (seq == NULL) {
+        return -1;
+    }
+
+    batch.groups.push_back(0);
+    batch.instances.push_back(0);
+    const Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    for (Py_ssize_t i = 0;i < n;++i) {
+        PyObject* inst = PySequence_Fast_GET_ITEM(seq, i);
+        if (candidate) {
+            PyObject* candidates = get_sequence(batch, inst, "a sequence of candidates is expected");
+            if (candidates == NULL) {
+                return -1;
+            }
+            const Py_ssize_t m = PySequence_Fast_GET_SIZE(candidates);
+            for (Py_ssize_t j = 0;j < m;++j) {
+                if (append_group(batch, PySequence_Fast_GET_ITEM(candidates, j)) != 0) {
+                    return -1;
+                }
+            }
+        } else {
+            if (append_group(batch, inst) != 0) {
+                return -1;
+            }
+        }
+        batch.instances.push_back(batch.groups.size() - 1);
+    }
+    return 0;
+}
+
+/**
+ * Scores a batch (without the GIL).
+ */
+static void score_batch(
+    const classias::predictor& p,
+    const batch_type& batch,
+    std::vector<int>& labels,
+    std::vector<double>& scores,
+    std::vector<double>& probs
+    )
+{
+    const size_t num_instances = batch.instances.size() - 1;
+    labels.resize(num_instances);
+    scores.resize(num_instances);
+    probs.resize(num_instances);
+
+    // Intern the features.
+    std::vector<int> features(batch.names.size());
+    for (size_t i = 0;i < features.size();++i) {
+        features[i] = p.feature(batch.names[i], batch.lengths[i]);
+    }
+
+    const int* f = features.empty() ? NULL : &features[0];
+    const double* v = batch.values.empty() ? NULL : &batch.values[0];
+    std::vector<double> buffer(p.type() == classias::predictor::TYPE_MULTI ? p.num_labels() : 0);
+
+    for (size_t i = 0;i < num_instances;++i) {
+        const size_t g = batch.instances[i];
+        const size_t begin = batch.groups[g];
+        const size_t end = batch.groups[g+1];
+
+        switch (p.type()) {
+        case classias::predictor::TYPE_BINARY:
+            scores[i] = p.score(f + begin, v + begin, end - begin);
+            labels[i] = (0. < scores[i]) ? 1 : 0;
+            probs[i] = classias::predictor::logistic(scores[i]);
+            break;
+
+        case classias::predictor::TYPE_MULTI:
+            labels[i] = p.score_labels(f + begin, v + begin, end - begin, buffer.empty() ? NULL : &buffer[0]);
+            if (0 <= labels[i]) {
+                scores[i] = buffer[labels[i]];
+                classias::predictor::softmax(&buffer[0], p.num_labels());
+                probs[i] = buffer[labels[i]];
+            }
+            break;
+
+        case classias::predictor::TYPE_CANDIDATE:
+            {
+                const size_t m = batch.instances[i+1] - g;
+                buffer.resize(m);
+                labels[i] = p.score_candidates(f, v, &batch.groups[g], m, m ? &buffer[0] : NULL);
+                if (0 <= labels[i]) {
+                    scores[i] = buffer[labels[i]];
+                    classias::predictor::softmax(&buffer[0], (int)m);
+                    probs[i] = buffer[labels[i]];
+                }
+            }
+            break;
+        }
+    }
+}
+
+static int Model_init(ModelObject* self, PyObject* args, PyObject* kwds)
+{
+    static const char* kwlist[] = {"filename", NULL};
+    const char* filename = NULL;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "s", (char**)kwlist, &filename)) {
+        return -1;
+    }
+    if (0 < self->num_busy) {
+        PyErr_SetString(PyExc_RuntimeError, "the model cannot be reloaded while it is predicting");
+        return -1;
+    }
+
+    classias::predictor* p = new classias::predictor;
+    std::string error;
+    Py_BEGIN_ALLOW_THREADS
+    try {
+        p->open(filename);
+    } catch (const std::exception& e) {
+        error = e.what();
+    }
+    Py_END_ALLOW_THREADS
+
+    if (!error.empty()) {
+        delete p;
+        PyErr_SetString(PyExc_IOError, error.c_str());
+        return -1;
+    }
+    if (0 < self->num_busy) {
+        // predict() started while the new model was being loaded.
+        delete p;
+        PyErr_SetString(PyExc_RuntimeError, "the model cannot be reloaded while it is predicting");
+        return -1;
+    }
+
+    delete self->predictor;
+    self->predictor = p;
+    return 0;
+}
+
+static void Model_dealloc(ModelObject* self)
+{
+    delete self->predictor;
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int check_model(ModelObject* self)
+{
+    if (self->predictor == NULL) {
+        PyErr_SetString(PyExc_RuntimeError, "the model is not loaded");
+        return -1;
+    }
+    return 0;
+}
+
+static PyObject* Model_predict(ModelObject* self, PyObject* instances)
+{
+    if (check_model(self) != 0) {
+        return NULL;
+    }
+    const classias::predictor& p = *self->predictor;
+
+    batch_type batch;
+    if (convert_batch(batch, instances, p.type() == classias::predictor::TYPE_CANDIDATE) != 0) {
+        return NULL;
+    }
+
+    std::vector<int> labels;
+    std::vector<double> scores, probs;
+    ++self->num_busy;
+    Py_BEGIN_ALLOW_THREADS
+    score_batch(p, batch, labels, scores, probs);
+    Py_END_ALLOW_THREADS
+    --self->num_busy;
+
+    PyObject* results = PyList_New((Py_ssize_t)labels.size());
+    if (results == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0;i < labels.size();++i) {
+        PyObject* label = NULL;
+        if (labels[i] < 0) {
+            label = Py_None;
+            Py_INCREF(label);
+        } else if (p.type() == classias::predictor::TYPE_BINARY) {
+            label = PyBool_FromLong(labels[i]);
+        } else if (p.type() == classias::predictor::TYPE_MULTI) {
+            size_t length = 0;
+            const char* str = p.label(labels[i], length);
+            label = PyUnicode_DecodeUTF8(str, (Py_ssize_t)length, "surrogateescape");
+        } else {
+            label = PyLong_FromLong(labels[i]);
+        }
+        PyObject* item = (label != NULL) ? Py_BuildValue("(Ndd)", label, scores[i], probs[i]) : NULL;
+        if (item == NULL) {
+            Py_DECREF(results);
+            return NULL;
+        }
+        PyList_SET_ITEM(results, (Py_ssize_t)i, item);
+    }
+    return results;
+}
+
+static PyObject* Model_get_type(ModelObject* self, void* closure)
+{
+    if (check_model(self) != 0) {
+        return NULL;
+    }
+    switch (self->predictor->type()) {
+    case classias::predictor::TYPE_BINARY:
+        return PyUnicode_FromString("binary");
+    case classias::predictor::TYPE_MULTI:
+        return PyUnicode_FromString("multi");
+    case classias::predictor::TYPE_CANDIDATE:
+        return PyUnicode_FromString("candidate");
+    default:
+        Py_RETURN_NONE;
+    }
+}
+
+static PyObject* Model_get_labels(ModelObject* self, void* closure)
+{
+    if (check_model(self) != 0) {
+        return NULL;
+    }
+    const classias::predictor& p = *self->predictor;
+    const int n = (p.type() == classias::predictor::TYPE_MULTI) ? p.num_labels() : 0;
+    PyObject* labels = PyTuple_New(n);
+    if (labels == NULL) {
+        return NULL;
+    }
+    for (int i = 0;i < n;++i) {
+        size_t length = 0;
+        const char* str = p.label(i, length);
+        PyObject* label = PyUnicode_DecodeUTF8(str, (Py_ssize_t)length, "surrogateescape");
+        if (label == NULL) {
+            Py_DECREF(labels);
+            return NULL;
+        }
+        PyTuple_SET_ITEM(labels, i, label);
+    }
+    return labels;
+}
+
+static PyMethodDef Model_methods[] = {
+    {"predict", (PyCFunction)Model_predict, METH_O,
+     "predict(instances) -> list of (label, score, probability)\n\n"
+     "Scores a batch of instances with the GIL released."},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Model_getset[] = {
+    {(char*)"type", (getter)Model_get_type, NULL, (char*)"The model type ('binary', 'multi', or 'candidate').", NULL},
+    {(char*)"labels", (getter)Model_get_labels, NULL, (char*)"The labels of a multi model.", NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyTypeObject ModelType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "classias.Model",                   /* tp_name */
+    sizeof(ModelObject),                /* tp_basicsize */
+};
+
+static struct PyModuleDef classias_module = {
+    PyModuleDef_HEAD_INIT,
+    "classias",
+    "Scoring with classias models (binary, multi, and candidate).",
+    -1,
+    NULL,
+};
+
+PyMODINIT_FUNC PyInit_classias(void)
+{
+    ModelType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ModelType.tp_doc = "Model(filename): a classias model in the text or binary format.";
+    ModelType.tp_new = PyType_GenericNew;
+    ModelType.tp_init = (initproc)Model_init;
+    ModelType.tp_dealloc = (destructor)Model_dealloc;
+    ModelType.tp_methods = Model_methods;
+    ModelType.tp_getset = Model_getset;
+    if (PyType_Ready(&ModelType) < 0) {
+        return NULL;
+    }
+
+    PyObject* m = PyModule_Create(&classias_module);
+    if (m == NULL) {
+        return NULL;
+    }
+    Py_INCREF(&ModelType);
+    if (PyModule_AddObject(m, "Model", (PyObject*)&ModelType) < 0) {
+        Py_DECREF(&ModelType);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
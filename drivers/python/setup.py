@@ -0,0 +1,26 @@
+#!/bin/env python
+
+"""
+Build the extension module for scoring with classias models:
+
+    python setup.py build_ext --inplace
+"""
+
+import os
+from setuptools import setup, Extension
+
+root = os.path.dirname(os.path.abspath(__file__))
+
+setup(
+    name='classias',
+    version='1.1.1',
+    description='Scoring with classias models',
+    ext_modules=[
+        Extension(
+            'classias',
+            sources=['classiasmodule.cpp'],
+            include_dirs=[os.path.join(root, '..', '..', 'include')],
+            language='c++',
+            ),
+        ],
+    )
@@ -0,0 +1,359 @@
+/*
+ *		Client for the tagging server.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifdef  HAVE_CONFIG_H
+#include <config.h>
+#endif/*HAVE_CONFIG_H*/
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <classias/version.h>
+#include <classias/thread.h>
+#include <optparse.h>
+#include <serving.h>
+
+class option : public optparse
+{
+public:
+    enum {
+        MODE_NORMAL = 0,
+        MODE_BENCHMARK,
+        MODE_STATS,
+        MODE_RELOAD,
+        MODE_VERSION,
+        MODE_HELP,
+    };
+
+    int         mode;
+    std::string socket;
+    std::string model;
+    int         lines;
+    int         concurrency;
+    int         requests;
+
+    option() :
+        mode(MODE_NORMAL), lines(1000), concurrency(1), requests(1000)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('s') || LONGOPT("socket"))
+            socket = arg;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('l') || LONGOPT("lines"))
+            lines = atoi(arg);
+            if (lines < 1) {
+                std::stringstream ss;
+                ss << "the number of lines must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('b') || LONGOPT("benchmark"))
+            mode = MODE_BENCHMARK;
+
+        ON_OPTION_WITH_ARG(SHORTOPT('c') || LONGOPT("concurrency"))
+            concurrency = atoi(arg);
+            if (concurrency < 1) {
+                std::stringstream ss;
+                ss << "the concurrency must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('n') || LONGOPT("requests"))
+            requests = atoi(arg);
+            if (requests < 1) {
+                std::stringstream ss;
+                ss << "the number of requests must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(LONGOPT("stats"))
+            mode = MODE_STATS;
+
+        ON_OPTION_WITH_ARG(LONGOPT("reload"))
+            mode = MODE_RELOAD;
+            model = arg;
+
+        ON_OPTION(SHORTOPT('v') || LONGOPT("version"))
+            mode = MODE_VERSION;
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            mode = MODE_HELP;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS]" << std::endl;
+    os << "This utility sends a data set read from STDIN to a tagging server" << std::endl;
+    os << "(classias-tag --server=SOCKET), and writes the tagging output to STDOUT." << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -s, --socket=SOCKET   connect to the server at the Unix domain SOCKET" << std::endl;
+    os << "  -l, --lines=N         send N lines (rounded up to the end of an instance)" << std::endl;
+    os << "                        per request (DEFAULT=1000)" << std::endl;
+    os << "  -b, --benchmark       send the requests repeatedly without writing the output," << std::endl;
+    os << "                        and report the throughput and latencies" << std::endl;
+    os << "  -c, --concurrency=N   send requests over N connections in the benchmark" << std::endl;
+    os << "                        (DEFAULT=1)" << std::endl;
+    os << "  -n, --requests=N      send N requests per connection in the benchmark" << std::endl;
+    os << "                        (DEFAULT=1000)" << std::endl;
+    os << "  --stats               show the statistics of the server" << std::endl;
+    os << "  --reload=FILE         let the server replace the model with FILE (a path" << std::endl;
+    os << "                        for the server); use '-' for the current model file" << std::endl;
+    os << "  -v, --version         show the version and copyright information" << std::endl;
+    os << "  -h, --help            show this help message and exit" << std::endl;
+    os << std::endl;
+}
+
+typedef std::vector<std::string> requests_type;
+
+static void read_requests(std::istream& is, int lines, requests_type& requests)
+{
+    int n = 0;
+    bool inner = false;
+    std::string line, request;
+
+    for (;;) {
+        std::getline(is, line);
+        if (is.eof()) {
+            break;
+        }
+
+        request += line;
+        request += '\n';
+        ++n;
+
+        // Never split an instance (@boi ... @eoi) into two requests.
+        if (line.compare(0, 4, "@boi") == 0) {
+            inner = true;
+        } else if (line == "@eoi") {
+            inner = false;
+        }
+
+        if (lines <= n && !inner) {
+            requests.push_back(request);
+            request.clear();
+            n = 0;
+        }
+    }
+
+    if (!request.empty()) {
+        requests.push_back(request);
+    }
+}
+
+static bool is_error(const std::string& response)
+{
+    return response.compare(0, 7, "@error\t") == 0;
+}
+
+static std::string request(int fd, frame_reader& reader, const std::string& payload)
+{
+    std::string response;
+    write_frame(fd, payload);
+    if (!reader.read(response)) {
+        throw serving_error("the server closed the connection");
+    }
+    return response;
+}
+
+/**
+ * A connection of the benchmark.
+ */
+struct benchmark_client
+{
+    const option* opt;
+    const requests_type* requests;
+    int offset;
+    latency_stats latencies;
+    std::string error;
+    classias::thread thread;
+
+    static void run(void *arg)
+    {
+        benchmark_client* c = reinterpret_cast<benchmark_client*>(arg);
+        const requests_type& requests = *c->requests;
+
+        try {
+            int fd = connect_socket(c->opt->socket);
+            frame_reader reader(fd);
+            for (int i = 0;i < c->opt->requests;++i) {
+                // Start from a different request for every connection.
+                const std::string& payload = requests[(c->offset + i) % requests.size()];
+                double begin = classias::monotonic_time();
+                std::string response = request(fd, reader, payload);
+                c->latencies.add(classias::monotonic_time() - begin);
+                if (is_error(response)) {
+                    c->error = response.substr(7);
+                    break;
+                }
+            }
+            close(fd);
+        } catch (const serving_error& e) {
+            c->error = e.what();
+        }
+    }
+};
+
+static int benchmark(const option& opt, const requests_type& requests, std::ostream& os, std::ostream& es)
+{
+    std::vector<benchmark_client*> clients;
+    for (int i = 0;i < opt.concurrency;++i) {
+        benchmark_client* c = new benchmark_client;
+        c->opt = &opt;
+        c->requests = &requests;
+        c->offset = i * (int)(requests.size() / opt.concurrency);
+        clients.push_back(c);
+    }
+
+    double begin = classias::monotonic_time();
+    for (size_t i = 0;i < clients.size();++i) {
+        clients[i]->thread.start(benchmark_client::run, clients[i]);
+    }
+
+    int ret = 0;
+    latency_stats latencies;
+    for (size_t i = 0;i < clients.size();++i) {
+        clients[i]->thread.join();
+        latencies.merge(clients[i]->latencies);
+        if (!clients[i]->error.empty()) {
+            es << "ERROR: " << clients[i]->error;
+            if (clients[i]->error[clients[i]->error.size()-1] != '\n') {
+                es << std::endl;
+            }
+            ret = 1;
+        }
+        delete clients[i];
+    }
+    double elapsed = classias::monotonic_time() - begin;
+
+    os << "Connections: " << opt.concurrency << std::endl;
+    os << "Lines per request: " << opt.lines << std::endl;
+    latencies.output(os, elapsed);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    option opt;
+    std::istream& is = std::cin;
+    std::ostream& os = std::cout;
+    std::ostream& es = std::cerr;
+
+    // Parse the command-line options.
+    try {
+        opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.mode == option::MODE_HELP) {
+        usage(os, argv[0]);
+        return 0;
+    } else if (opt.mode == option::MODE_VERSION) {
+        // Show the copyright information.
+        os << CLASSIAS_NAME " ";
+        os << CLASSIAS_VERSION << " ";
+        os << "client ";
+        os << CLASSIAS_COPYRIGHT << std::endl;
+        os << std::endl;
+        return 0;
+    }
+
+    if (opt.socket.empty()) {
+        es << "ERROR: the socket of the server is not specified (-s)" << std::endl;
+        return 1;
+    }
+
+    try {
+        if (opt.mode == option::MODE_STATS) {
+            int fd = connect_socket(opt.socket);
+            frame_reader reader(fd);
+            os << request(fd, reader, "@stats");
+            close(fd);
+            return 0;
+        } else if (opt.mode == option::MODE_RELOAD) {
+            int fd = connect_socket(opt.socket);
+            frame_reader reader(fd);
+            std::string response = request(fd, reader, (opt.model == "-") ? "@reload" : "@reload\t" + opt.model);
+            close(fd);
+            if (is_error(response)) {
+                es << "ERROR: " << response.substr(7);
+                return 1;
+            }
+            os << response;
+            return 0;
+        }
+
+        // Read the requests from STDIN.
+        requests_type requests;
+        read_requests(is, opt.lines, requests);
+        if (requests.empty()) {
+            return 0;
+        }
+
+        if (opt.mode == option::MODE_BENCHMARK) {
+            return benchmark(opt, requests, os, es);
+        }
+
+        // Send the requests one by one, and write the responses.
+        int fd = connect_socket(opt.socket);
+        frame_reader reader(fd);
+        for (size_t i = 0;i < requests.size();++i) {
+            std::string response = request(fd, reader, requests[i]);
+            if (is_error(response)) {
+                es << "ERROR: " << response.substr(7);
+                close(fd);
+                return 1;
+            }
+            os << response;
+        }
+        close(fd);
+
+    } catch (const serving_error& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,305 @@
+/*
+ *		Framed requests and latency statistics for the tagging server.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifndef __SERVING_H__
+#define __SERVING_H__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef  _WIN32
+#include <io.h>
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif/*_WIN32*/
+
+/*
+ * The tagging server (classias-tag --server) and client (classias-client)
+ * exchange frames over a Unix domain socket or a pair of pipes. A frame
+ * consists of the number of bytes of the payload in decimal, a newline
+ * character, and the payload. The payload of a request is a sequence of
+ * lines in the input format of classias-tag (whole instances for the
+ * candidate model), and the payload of the response is the tagging
+ * output of the lines, or a line "@error<TAB>MESSAGE" if the server fails
+ * to tag the lines. A request "@stats" asks the server for the
+ * statistics of the requests served so far, and a request "@reload"
+ * (optionally followed by a TAB and the path to a model file) replaces
+ * the model without stopping the server; without a path, the server
+ * reloads the model file currently in use.
+ */
+
+class serving_error : public std::runtime_error
+{
+public:
+    explicit serving_error(const std::string& msg)
+        : std::runtime_error(msg)
+    {
+    }
+};
+
+/**
+ * A reader of frames from a file descriptor.
+ */
+class frame_reader
+{
+protected:
+    int m_fd;
+    std::vector<char> m_buffer;
+    size_t m_begin;
+    size_t m_end;
+
+public:
+    frame_reader(int fd) : m_fd(fd), m_buffer(65536), m_begin(0), m_end(0)
+    {
+    }
+
+    /**
+     * Reads a frame.
+     *  @param  payload     The string receiving the payload.
+     *  @retval bool        \c false at the end of the input.
+     *  @throws serving_error   If the frame is broken.
+     */
+    bool read(std::string& payload)
+    {
+        // Read the size of the payload.
+        size_t size = 0;
+        int digits = 0;
+        for (;;) {
+            if (m_begin == m_end && !fill()) {
+                if (digits == 0) {
+                    return false;
+                }
+                throw serving_error("unexpected end of a frame");
+            }
+            char c = m_buffer[m_begin++];
+            if (c == '\n') {
+                break;
+            } else if ('0' <= c && c <= '9' && digits < 18) {
+                size = size * 10 + (c - '0');
+                ++digits;
+            } else if (c != '\r') {
+                throw serving_error("invalid frame header");
+            }
+        }
+        if (digits == 0) {
+            throw serving_error("invalid frame header");
+        }
+
+        // Read the payload.
+        payload.clear();
+        payload.reserve(size);
+        while (payload.size() < size) {
+            if (m_begin == m_end && !fill()) {
+                throw serving_error("unexpected end of a frame");
+            }
+            size_t n = std::min(size - payload.size(), m_end - m_begin);
+            payload.append(&m_buffer[m_begin], n);
+            m_begin += n;
+        }
+        return true;
+    }
+
+protected:
+    bool fill()
+    {
+        for (;;) {
+            int n = (int)::read(m_fd, &m_buffer[0], (unsigned int)m_buffer.size());
+            if (0 < n) {
+                m_begin = 0;
+                m_end = (size_t)n;
+                return true;
+            } else if (n == 0) {
+                return false;
+            } else if (errno != EINTR) {
+                throw serving_error(std::string("failed to read a frame: ") + std::strerror(errno));
+            }
+        }
+    }
+};
+
+/**
+ * Writes a frame.
+ *  @param  fd          The file descriptor.
+ *  @param  payload     The payload.
+ *  @throws serving_error   If the frame is not written.
+ */
+inline void write_frame(int fd, const std::string& payload)
+{
+    std::ostringstream ss;
+    ss << payload.size() << '\n';
+    std::string frame = ss.str();
+    frame += payload;
+
+    const char *p = frame.c_str();
+    size_t size = frame.size();
+    while (0 < size) {
+        int n = (int)::write(fd, p, (unsigned int)size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw serving_error(std::string("failed to write a frame: ") + std::strerror(errno));
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+}
+
+#ifndef _WIN32
+
+/**
+ * Creates a Unix domain socket listening at a path.
+ *  @param  path        The path of the socket, which is removed first.
+ *  @return int         The file descriptor.
+ *  @throws serving_error   If the socket is not created.
+ */
+inline int listen_socket(const std::string& path)
+{
+    struct sockaddr_un addr;
+    if (sizeof(addr.sun_path) <= path.size()) {
+        throw serving_error("the socket path is too long: " + path);
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        throw serving_error(std::string("failed to create a socket: ") + std::strerror(errno));
+    }
+    unlink(path.c_str());
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 128) != 0) {
+        int e = errno;
+        close(fd);
+        throw serving_error("failed to listen at " + path + ": " + std::strerror(e));
+    }
+    return fd;
+}
+
+/**
+ * Connects to a Unix domain socket.
+ *  @param  path        The path of the socket.
+ *  @return int         The file descriptor.
+ *  @throws serving_error   If the connection fails.
+ */
+inline int connect_socket(const std::string& path)
+{
+    struct sockaddr_un addr;
+    if (sizeof(addr.sun_path) <= path.size()) {
+        throw serving_error("the socket path is too long: " + path);
+    }
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strcpy(addr.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) {
+        throw serving_error(std::string("failed to create a socket: ") + std::strerror(errno));
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        int e = errno;
+        close(fd);
+        throw serving_error("failed to connect to " + path + ": " + std::strerror(e));
+    }
+    return fd;
+}
+
+#endif/*_WIN32*/
+
+/**
+ * Latencies of requests.
+ */
+class latency_stats
+{
+protected:
+    std::vector<double> m_latencies;
+
+public:
+    void add(double latency)
+    {
+        m_latencies.push_back(latency);
+    }
+
+    void merge(const latency_stats& other)
+    {
+        m_latencies.insert(m_latencies.end(), other.m_latencies.begin(), other.m_latencies.end());
+    }
+
+    size_t size() const
+    {
+        return m_latencies.size();
+    }
+
+    /**
+     * Outputs the number of requests, throughput, and latency percentiles.
+     *  @param  os          The output stream.
+     *  @param  elapsed     The elapsed time in seconds.
+     */
+    void output(std::ostream& os, double elapsed) const
+    {
+        std::vector<double> v(m_latencies);
+        std::sort(v.begin(), v.end());
+
+        os << "Requests: " << v.size() << std::endl;
+        os << "Elapsed time: " << elapsed << " [s]" << std::endl;
+        os << "Throughput: " << (0 < elapsed ? v.size() / elapsed : 0.) << " [requests/s]" << std::endl;
+        os << "Latency [ms]:";
+        os << " p50=" << percentile(v, 0.50) * 1000;
+        os << " p90=" << percentile(v, 0.90) * 1000;
+        os << " p99=" << percentile(v, 0.99) * 1000;
+        os << " max=" << (v.empty() ? 0. : v.back() * 1000);
+        os << std::endl;
+    }
+
+protected:
+    static double percentile(const std::vector<double>& v, double p)
+    {
+        // The nearest-rank percentile of the sorted latencies.
+        if (v.empty()) {
+            return 0.;
+        }
+        size_t rank = (size_t)(p * v.size() + 0.999999);
+        return v[std::max(rank, (size_t)1) - 1];
+    }
+};
+
+#endif/*__SERVING_H__*/
@@ -0,0 +1,266 @@
+/*
+ *		Quantizer of the feature weights of a model.
+ *
+ * Copyright (c) 2008, Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Northwestern University, University of Tokyo,
+ *       nor the names of its contributors may be used to endorse or promote
+ *       products derived from this software without specific prior written
+ *       permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifdef  HAVE_CONFIG_H
+#include <config.h>
+#endif/*HAVE_CONFIG_H*/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <typeinfo>
+#include <classias/version.h>
+#include <classias/predictor.h>
+#include <optparse.h>
+
+class option : public optparse
+{
+public:
+    enum {
+        MODE_NORMAL = 0,
+        MODE_VERSION,
+        MODE_HELP,
+    };
+
+    int         mode;
+    int         format;
+    int         block;
+
+    option() :
+        mode(MODE_NORMAL), format(classias::model_file::WEIGHT_INT8), block(64)
+    {
+    }
+
+    BEGIN_OPTION_MAP_INLINE()
+        ON_OPTION_WITH_ARG(SHORTOPT('f') || LONGOPT("format"))
+            if (strcmp(arg, "f16") == 0 || strcmp(arg, "float16") == 0) {
+                format = classias::model_file::WEIGHT_FLOAT16;
+            } else if (strcmp(arg, "i8") == 0 || strcmp(arg, "int8") == 0) {
+                format = classias::model_file::WEIGHT_INT8;
+            } else if (strcmp(arg, "i8-label") == 0 || strcmp(arg, "int8-label") == 0) {
+                format = classias::model_file::WEIGHT_INT8;
+                block = 0;
+            } else if (strcmp(arg, "f64") == 0 || strcmp(arg, "double") == 0) {
+                format = classias::model_file::WEIGHT_DOUBLE;
+            } else {
+                std::stringstream ss;
+                ss << "unknown weight format specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(SHORTOPT('b') || LONGOPT("block"))
+            block = atoi(arg);
+            if (block < 1 || (block & (block - 1)) != 0) {
+                std::stringstream ss;
+                ss << "the block size must be a power of two: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(SHORTOPT('v') || LONGOPT("version"))
+            mode = MODE_VERSION;
+
+        ON_OPTION(SHORTOPT('h') || LONGOPT("help"))
+            mode = MODE_HELP;
+
+    END_OPTION_MAP()
+};
+
+static void usage(std::ostream& os, const char *argv0)
+{
+    os << "USAGE: " << argv0 << " [OPTIONS] MODEL OUTPUT" << std::endl;
+    os << "This utility quantizes the feature weights of MODEL (in the text or binary" << std::endl;
+    os << "format), and writes the model in the binary format to OUTPUT. Evaluate the" << std::endl;
+    os << "accuracy delta of the quantization on a labeled data set TEST with:" << std::endl;
+    os << "    classias-tag -t -m OUTPUT --baseline=MODEL < TEST" << std::endl;
+    os << std::endl;
+    os << "OPTIONS:" << std::endl;
+    os << "  -f, --format=FORMAT   store the weights in FORMAT:" << std::endl;
+    os << "      f16, float16              half precision" << std::endl;
+    os << "      i8, int8                  8-bit integers with a scale per block of" << std::endl;
+    os << "                                features (DEFAULT)" << std::endl;
+    os << "      i8-label, int8-label      8-bit integers with a scale per label (multi)" << std::endl;
+    os << "      f64, double               double precision (no quantization)" << std::endl;
+    os << "  -b, --block=N         share a scale of int8 weights by N features, a power of" << std::endl;
+    os << "                        two (DEFAULT=64)" << std::endl;
+    os << "  -v, --version         show the version and copyright information" << std::endl;
+    os << "  -h, --help            show this help message and exit" << std::endl;
+    os << std::endl;
+}
+
+static const char* format_name(int format, int block)
+{
+    switch (format) {
+    case classias::model_file::WEIGHT_FLOAT16:
+        return "float16";
+    case classias::model_file::WEIGHT_INT8:
+        return (block == 0 ? "int8 (label scales)" : "int8 (block scales)");
+    default:
+        return "double";
+    }
+}
+
+static size_t weight_size(const classias::model_file& model, int format, int block)
+{
+    const size_t n = (size_t)model.num_features();
+    switch (format) {
+    case classias::model_file::WEIGHT_FLOAT16:
+        return sizeof(unsigned short) * n;
+    case classias::model_file::WEIGHT_INT8:
+        return n + sizeof(float) * (block == 0 ? model.num_labels() : (n + block - 1) / block);
+    default:
+        return sizeof(double) * n;
+    }
+}
+
+static size_t file_size(const std::string& filename)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::binary);
+    ifs.seekg(0, std::ios::end);
+    return ifs.fail() ? 0 : (size_t)ifs.tellg();
+}
+
+static int quantize(option& opt, const std::string& input, const std::string& output, std::ostream& os)
+{
+    // Load the model in the text or binary format.
+    classias::predictor source;
+    source.open(input);
+    const classias::model_file& model = source.model();
+    if (opt.format == classias::model_file::WEIGHT_INT8 && opt.block == 0 &&
+        model.num_attributes() == 0) {
+        throw classias::model_file_error("The scales of labels require a multi model: " + input);
+    }
+
+    // Copy the labels and weights to the writer.
+    classias::model_writer writer(model.type());
+    for (int l = 0;l < model.num_labels();++l) {
+        writer.add_label(model.label(l));
+    }
+    for (int i = 0;i < model.num_features();++i) {
+        if (0 < model.num_attributes()) {
+            // Remove the label from the name of an attribute-label feature.
+            const std::string name = model.feature(i);
+            writer.insert(name.substr(0, name.rfind('\t')), model.feature_label(i), model.weight(i));
+        } else {
+            writer.insert(model.feature(i), model.weight(i));
+        }
+    }
+    writer.quantize(opt.format, (unsigned int)opt.block);
+    writer.save(output);
+
+    // Measure the errors of the quantized weights.
+    classias::model_file quantized;
+    quantized.open(output);
+    double max_error = 0., sum_error = 0.;
+    for (int i = 0;i < model.num_features();++i) {
+        const std::string name = model.feature(i);
+        const int j = quantized.find(name.c_str(), name.size());
+        const double e = std::fabs(model.weight(i) - (0 <= j ? quantized.weight(j) : 0.));
+        if (max_error < e) {
+            max_error = e;
+        }
+        sum_error += e;
+    }
+
+    // Report the sizes and errors.
+    const int block = (opt.format == classias::model_file::WEIGHT_INT8 ? opt.block : 0);
+    const size_t before = weight_size(model, model.weight_format(), 64);
+    const size_t after = weight_size(quantized, opt.format, block);
+    os << "Model: " << input << std::endl;
+    os << "Number of features: " << model.num_features() << std::endl;
+    os << "Weight format: " << format_name(model.weight_format(), 64) <<
+        " -> " << format_name(opt.format, block);
+    if (0 < block) {
+        os << ", " << block << " features per scale";
+    }
+    os << std::endl;
+    os << "Weight size: " << before << " -> " << after << " bytes";
+    if (0 < after) {
+        os << " (" << std::setprecision(3) << before / (double)after << "x smaller)";
+    }
+    os << std::endl;
+    os << "File size: " << file_size(input) << " -> " << file_size(output) << " bytes" << std::endl;
+    os << std::setprecision(6);
+    os << "Weight error: max " << max_error << ", mean " <<
+        (0 < model.num_features() ? sum_error / model.num_features() : 0.) << std::endl;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int arg_used = 0;
+    option opt;
+    std::ostream& os = std::cout;
+    std::ostream& es = std::cerr;
+
+    // Parse the command-line options.
+    try {
+        arg_used = opt.parse(argv, argc);
+    } catch (const optparse::unrecognized_option& e) {
+        es << "ERROR: unrecognized option: " << e.what() << std::endl;
+        return 1;
+    } catch (const optparse::invalid_value& e) {
+        es << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+
+    // Show the help message and exit.
+    if (opt.mode == option::MODE_HELP) {
+        usage(os, argv[0]);
+        return 0;
+    } else if (opt.mode == option::MODE_VERSION) {
+        // Show the copyright information.
+        os << CLASSIAS_NAME " ";
+        os << CLASSIAS_VERSION << " ";
+        os << "quantizer ";
+        os << CLASSIAS_COPYRIGHT << std::endl;
+        os << std::endl;
+        return 0;
+    }
+
+    if (argc - arg_used != 2) {
+        es << "ERROR: specify an input model and an output file" << std::endl;
+        return 1;
+    }
+
+    try {
+        return quantize(opt, argv[arg_used], argv[arg_used+1], os);
+    } catch (const std::exception& e) {
+        es << "ERROR: " << typeid(e).name() << ": " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -44,13 +44,14 @@
 #include <classias/evaluation.h>
 
 #include "option.h"
+#include "tagger.h"
 #include "tokenize.h"
-#include "defaultmap.h"
+#include "weight_table.h"
 #include <util.h>
 
-typedef defaultmap<std::string, double> model_type;
-typedef classias::classify::linear_binary_logistic<model_type> classifier_type;
+typedef weight_table model_type;
 
+template <class classifier_type>
 static void
 parse_line(
     classifier_type& inst,
@@ -120,82 +121,112 @@ read_model(
             throw invalid_model("feature name is missing", line);
         }
 
-        model[line.substr(pos)] = w;
+        model.insert(line.c_str() + pos, line.size() - pos, w);
     }
 }
 
-int binary_tag(option& opt, std::ifstream& ifs)
+template <class model_type>
+class binary_tagger
 {
-    int lines = 0;
-    std::istream& is = opt.is;
-    std::ostream& os = opt.os;
-    classias::accuracy acc;
-    classias::precall pr(2);
-
-    // Load a model.
-    model_type model;
-    read_model(model, ifs, opt);
+protected:
+    typedef classias::classify::linear_binary_logistic<model_type> classifier_type;
+
+    const model_type& m_model;
+    const option& m_opt;
+    classias::accuracy m_acc;
+    classias::precall m_pr;
+
+public:
+    binary_tagger(const model_type& model, const option& opt)
+        : m_model(model), m_opt(opt), m_pr(2)
+    {
+    }
 
-    for (;;) {
-        // Read a line.
-        std::string line;
-        std::getline(is, line);
-        if (is.eof()) {
-            break;
-        }
-        ++lines;
+    static bool boundary(const std::string& line)
+    {
+        return true;
+    }
 
+    void process(const std::string& line, int lines, std::ostream& os)
+    {
         // An empty line or comment line.
         if (line.empty() || line.compare(0, 1, "#") == 0) {
             // Output the comment line if necessary.
-            if (opt.output & option::OUTPUT_COMMENT) {
+            if (m_opt.output & option::OUTPUT_COMMENT) {
                 os << line << std::endl;
             }
-            continue;
+            return;
         }
 
         // Parse the line and classify the instance.
         bool rlabel;
-        classifier_type inst(model);
-        parse_line(inst, rlabel, opt, line, lines);
+        classifier_type inst(m_model);
+        parse_line(inst, rlabel, m_opt, line, lines);
 
         // Determine whether we output this instance or not.
-        if (opt.condition == option::CONDITION_ALL ||
-            (opt.condition == option::CONDITION_FALSE && rlabel != static_cast<bool>(inst))) {
+        if (m_opt.condition == option::CONDITION_ALL ||
+            (m_opt.condition == option::CONDITION_FALSE && rlabel != static_cast<bool>(inst))) {
 
             // Output the reference label.
-            if (opt.output & option::OUTPUT_RLABEL) {
-                os << (rlabel ? "+1" : "-1") << opt.token_separator;
+            if (m_opt.output & option::OUTPUT_RLABEL) {
+                os << (rlabel ? "+1" : "-1") << m_opt.token_separator;
             }
 
             // Output the predicted label.
             os << (static_cast<bool>(inst) ? "+1" : "-1");
 
             // Output the score/probability if necessary.
-            if (opt.output & option::OUTPUT_PROBABILITY) {
-                os << opt.value_separator << inst.prob();
-            } else if (opt.output & option::OUTPUT_SCORE) {
-                os << opt.value_separator << inst.score();
+            if (m_opt.output & option::OUTPUT_PROBABILITY) {
+                os << m_opt.value_separator << inst.prob();
+            } else if (m_opt.output & option::OUTPUT_SCORE) {
+                os << m_opt.value_separator << inst.score();
             }
 
             os << std::endl;
         }
 
         // Accumulate the performance.
-        if (opt.test) {
+        if (m_opt.test) {
             int rl = static_cast<int>(rlabel);
             int ml = static_cast<int>(static_cast<bool>(inst));
-            acc.set(ml == rl);
-            pr.set(ml, rl);
+            m_acc.set(ml == rl);
+            m_pr.set(ml, rl);
         }
     }
 
-    // Output the performance if necessary.
-    if (opt.test) {
-        int positive_labels[] = {1};
-        acc.output(os);
-        pr.output_micro(os, positive_labels, positive_labels+1);
+    void reset()
+    {
     }
 
-    return 0;
+    void merge(const binary_tagger& other)
+    {
+        m_acc.merge(other.m_acc);
+        m_pr.merge(other.m_pr);
+    }
+
+    void finish(std::ostream& os)
+    {
+        // Output the performance if necessary.
+        if (m_opt.test) {
+            int positive_labels[] = {1};
+            if (m_opt.accuracy != NULL) {
+                *m_opt.accuracy = m_acc;
+            }
+            m_acc.output(os);
+            m_pr.output_micro(os, positive_labels, positive_labels+1);
+        }
+    }
+};
+
+int binary_tag(option& opt, std::ifstream& ifs)
+{
+    // Load a model.
+    model_type model;
+    read_model(model, ifs, opt);
+    return run_tagger(opt, binary_tagger<model_type>(model, opt));
+}
+
+int binary_tag(option& opt, const classias::model_file& model)
+{
+    return run_tagger(opt, binary_tagger<classias::model_file>(model, opt));
 }
@@ -45,14 +45,14 @@
 #include <classias/evaluation.h>
 
 #include "option.h"
+#include "tagger.h"
 #include "tokenize.h"
-#include "defaultmap.h"
+#include "weight_table.h"
 #include <util.h>
 
-typedef defaultmap<std::string, double> model_type;
+typedef weight_table model_type;
 typedef std::vector<std::string> labels_type;
 typedef std::vector<std::string> comments_type;
-typedef classias::classify::linear_multi_logistic<model_type> classifier_type;
 
 class feature_generator
 {
@@ -81,6 +81,7 @@ public:
     }
 };
 
+template <class classifier_type>
 static void
 parse_line(
     classifier_type& inst,
@@ -155,10 +156,11 @@ read_model(
             throw invalid_model("feature name is missing", line);
         }
 
-        model[line.substr(pos)] = w;
+        model.insert(line.c_str() + pos, line.size() - pos, w);
     }
 }
 
+template <class classifier_type>
 static void output_model_candidates(
     std::ostream& os,
     classifier_type& inst,
@@ -196,6 +198,7 @@ static void output_model_candidates(
     os << "@eoi" << std::endl;
 }
 
+template <class classifier_type>
 static void output_model_label(
     std::ostream& os,
     classifier_type& inst,
@@ -217,110 +220,109 @@ static void output_model_label(
     os << std::endl;
 }
 
-int candidate_tag(option& opt, std::ifstream& ifs)
+template <class model_type>
+class candidate_tagger
 {
-    int rl = -1;
-    int lines = 0;
-    feature_generator fgen;
-    std::istream& is = opt.is;
-    std::ostream& os = opt.os;
-    bool inner = false;
-    std::string comment_outer, comment_inner;
-    comments_type comments;
-
-    // Load a model.
-    model_type model;
-    read_model(model, ifs, opt);
+protected:
+    typedef classias::classify::linear_multi_logistic<model_type> classifier_type;
+
+    const option& m_opt;
+    feature_generator m_fgen;
+    classifier_type m_inst;
+    labels_type m_labels;
+    comments_type m_comments;
+    std::string m_comment_outer;
+    std::string m_comment_inner;
+    bool m_inner;
+    int m_rl;
+    classias::accuracy m_acc;
 
-    // Create an instance of a classifier on the model.
-    classifier_type inst(model);
-    labels_type labels;
-
-    // Objects for performance evaluation.
-    classias::accuracy acc;
-    classias::precall pr(labels.size());
+public:
+    candidate_tagger(const model_type& model, const option& opt)
+        : m_opt(opt), m_inst(model), m_inner(false), m_rl(-1)
+    {
+    }
 
-    for (;;) {
-        // Read a line.
-        std::string line;
-        std::getline(is, line);
-        if (is.eof()) {
-            break;
-        }
-        ++lines;
+    static bool boundary(const std::string& line)
+    {
+        // A block must not end in the middle of an instance.
+        return line == "@eoi";
+    }
 
+    void process(const std::string& line, int lines, std::ostream& os)
+    {
         // An empty line or comment line.
         if (line.empty() || line.compare(0, 1, "#") == 0) {
-            if (opt.output & option::OUTPUT_COMMENT) {
-                if (0 < inst.size()) {
+            if (m_opt.output & option::OUTPUT_COMMENT) {
+                if (0 < m_inst.size()) {
                     // Store the comment line to the current instance.
-                    comments[inst.size()-1] += line;
-                    comments[inst.size()-1] += '\n';
-                } else if (inner) {
-                    comment_inner += line;
-                    comment_inner += '\n';
+                    m_comments[m_inst.size()-1] += line;
+                    m_comments[m_inst.size()-1] += '\n';
+                } else if (m_inner) {
+                    m_comment_inner += line;
+                    m_comment_inner += '\n';
                 } else {
-                    comment_outer += line;
-                    comment_outer += '\n';
+                    m_comment_outer += line;
+                    m_comment_outer += '\n';
                 }
             }
-            continue;
+            return;
         }
 
         if (line.compare(0, 4, "@boi") == 0) {
             // Begin of an instance.
-            rl = -1;
-            inst.clear();
-            labels.clear();
-            comments.clear();
-            inner = true;
+            m_rl = -1;
+            m_inst.clear();
+            m_labels.clear();
+            m_comments.clear();
+            m_inner = true;
 
         } else if (line == "@eoi") {
-            inst.finalize();
+            m_inst.finalize();
 
             // Determine whether we output this instance or not.
-            if (opt.condition == option::CONDITION_ALL ||
-                (opt.condition == option::CONDITION_FALSE && rl != inst.argmax())) {
+            if (m_opt.condition == option::CONDITION_ALL ||
+                (m_opt.condition == option::CONDITION_FALSE && m_rl != m_inst.argmax())) {
 
                 // Output BOI.
-                os << comment_outer;
+                os << m_comment_outer;
                 os << "@boi" << std::endl;
-                os << comment_inner;
+                os << m_comment_inner;
 
-                if (opt.output & option::OUTPUT_ALL) {
-                    for (int i = 0;i < inst.size();++i) {
+                if (m_opt.output & option::OUTPUT_ALL) {
+                    for (int i = 0;i < m_inst.size();++i) {
                         // Output the reference label.
-                        if (opt.output & option::OUTPUT_RLABEL) {
-                            os << ((i == rl) ? '+' : '-');
+                        if (m_opt.output & option::OUTPUT_RLABEL) {
+                            os << ((i == m_rl) ? '+' : '-');
                         }
                         // Output the predicted label.
-                        os << ((i == inst.argmax()) ? '+' : '-');
-                        os << labels[i];
+                        os << ((i == m_inst.argmax()) ? '+' : '-');
+                        os << m_labels[i];
 
                         // Output the score/probability if necessary.
-                        if (opt.output & option::OUTPUT_PROBABILITY) {
-                            os << opt.value_separator << inst.prob(i);
-                        } else if (opt.output & option::OUTPUT_SCORE) {
-                            os << opt.value_separator << inst.score(i);
+                        if (m_opt.output & option::OUTPUT_PROBABILITY) {
+                            os << m_opt.value_separator << m_inst.prob(i);
+                        } else if (m_opt.output & option::OUTPUT_SCORE) {
+                            os << m_opt.value_separator << m_inst.score(i);
                         }
 
                         os << std::endl;
-                        os << comments[i];
+                        os << m_comments[i];
                     }
 
                 } else {
                     // Output the reference label.
-                    if (opt.output & option::OUTPUT_RLABEL) {
-                        os << labels[rl] << opt.token_separator;
+                    if (m_opt.output & option::OUTPUT_RLABEL) {
+                        os << m_labels[m_rl] << m_opt.token_separator;
                     }
                     // Output the predicted label.
-                    os << labels[inst.argmax()];
+                    os << m_labels[m_inst.argmax()];
 
                     // Output the score/probability if necessary.
-                    if (opt.output & option::OUTPUT_PROBABILITY) {
-                        os << opt.value_separator << inst.prob(inst.argmax());
-                    } else if (opt.output & option::OUTPUT_SCORE) {
-                        os << opt.value_separator << inst.score(inst.argmax());
+                    if (m_opt.output & option::OUTPUT_PROBABILITY) {
+                        os << m_opt.value_separator << m_inst.prob(m_inst.argmax());
+                    } else if (m_opt.output & option::OUTPUT_SCORE) {
+                        os << m_opt.value_separator << m_inst.score(m_inst.argmax());
                     }
 
                     os << std::endl;
@@ -332,39 +334,73 @@ int candidate_tag(option& opt, std::ifstream& ifs)
             }
 
             // Accumulate the performance.
-            if (opt.test) {
-                acc.set(inst.argmax() == rl);
+            if (m_opt.test) {
+                m_acc.set(m_inst.argmax() == m_rl);
             }
 
-            rl = -1;
-            inst.clear();
-            labels.clear();
-            comments.clear();
-            comment_inner.clear();
-            comment_outer.clear();
-            inner = false;
+            m_rl = -1;
+            m_inst.clear();
+            m_labels.clear();
+            m_comments.clear();
+            m_comment_inner.clear();
+            m_comment_outer.clear();
+            m_inner = false;
 
         } else {
             std::string label;
             bool truth = false;
-            parse_line(inst, fgen, label, truth, opt, line, lines);
+            parse_line(m_inst, m_fgen, label, truth, m_opt, line, lines);
             if (truth) {
-                rl = inst.size() - 1;
+                m_rl = m_inst.size() - 1;
             }
-            labels.push_back(label);
-            if (labels.size() != inst.size()) {
+            m_labels.push_back(label);
+            if ((int)m_labels.size() != m_inst.size()) {
                 throw invalid_data("", line, lines);
             }
-            if ((int)comments.size() < inst.size()) {
-                comments.resize(inst.size());
+            if ((int)m_comments.size() < m_inst.size()) {
+                m_comments.resize(m_inst.size());
             }
         }
     }
 
-    // Output the performance if necessary.
-    if (opt.test) {
-        acc.output(os);
+    void reset()
+    {
+        // Discard an instance left incomplete by the previous request.
+        m_rl = -1;
+        m_inst.clear();
+        m_labels.clear();
+        m_comments.clear();
+        m_comment_inner.clear();
+        m_comment_outer.clear();
+        m_inner = false;
+    }
+
+    void merge(const candidate_tagger& other)
+    {
+        m_acc.merge(other.m_acc);
+    }
+
+    void finish(std::ostream& os)
+    {
+        // Output the performance if necessary.
+        if (m_opt.test) {
+            if (m_opt.accuracy != NULL) {
+                *m_opt.accuracy = m_acc;
+            }
+            m_acc.output(os);
+        }
     }
+};
 
-    return 0;
+int candidate_tag(option& opt, std::ifstream& ifs)
+{
+    // Load a model.
+    model_type model;
+    read_model(model, ifs, opt);
+    return run_tagger(opt, candidate_tagger<model_type>(model, opt));
+}
+
+int candidate_tag(option& opt, const classias::model_file& model)
+{
+    return run_tagger(opt, candidate_tagger<classias::model_file>(model, opt));
 }
@@ -36,16 +36,24 @@
 #endif/*HAVE_CONFIG_H*/
 
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <typeinfo>
 #include <classias/version.h>
+#include <classias/evaluation.h>
+#include <classias/model_file.h>
 #include <optparse.h>
 
 #include "option.h"
+#include "server.h"
 
 int binary_tag(option& opt, std::ifstream& ifs);
 int multi_tag(option& opt, std::ifstream& ifs);
 int candidate_tag(option& opt, std::ifstream& ifs);
+int binary_tag(option& opt, const classias::model_file& model);
+int multi_tag(option& opt, const classias::model_file& model);
+int candidate_tag(option& opt, const classias::model_file& model);
 
 class optionparser : public option, public optparse
 {
@@ -65,6 +73,9 @@ public:
         ON_OPTION(SHORTOPT('t') || LONGOPT("test"))
             test = true;
 
+        ON_OPTION_WITH_ARG(LONGOPT("baseline"))
+            baseline = arg;
+
         ON_OPTION_WITH_ARG(SHORTOPT('s') || LONGOPT("token-separator"))
             if (strcmp(arg, " ") == 0 || strcasecmp(arg, "s") == 0 || strcasecmp(arg, "spc") == 0 || strcasecmp(arg, "space") == 0) {
                 token_separator = ' ';
@@ -116,6 +127,33 @@ public:
         ON_OPTION(SHORTOPT('q') || LONGOPT("quiet"))
             condition = CONDITION_NONE;
 
+        ON_OPTION_WITH_ARG(LONGOPT("threads"))
+            threads = atoi(arg);
+            if (threads < 1) {
+                std::stringstream ss;
+                ss << "the number of threads must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(LONGOPT("server"))
+            server = arg;
+
+        ON_OPTION_WITH_ARG(LONGOPT("batch"))
+            batch_size = atoi(arg);
+            if (batch_size < 1) {
+                std::stringstream ss;
+                ss << "the batch size must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(LONGOPT("batch-wait"))
+            batch_wait = atoi(arg);
+            if (batch_wait < 0) {
+                std::stringstream ss;
+                ss << "the batch wait must be a non-negative integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
         ON_OPTION(SHORTOPT('v') || LONGOPT("version"))
             mode = MODE_VERSION;
 
@@ -131,8 +169,12 @@ static void usage(std::ostream& os, const char *argv0)
     os << "This utility tags labels for a data set read from STDIN." << std::endl;
     os << std::endl;
     os << "OPTIONS:" << std::endl;
-    os << "  -m, --model=FILE      load the model from FILE" << std::endl;
+    os << "  -m, --model=FILE      load the model from FILE; a model in the binary format" << std::endl;
+    os << "                        (classias-train --binary-model) is mapped into memory" << std::endl;
     os << "  -t, --test            evaluate the tagging performance on the labeled data" << std::endl;
+    os << "  --baseline=FILE       evaluate the model in FILE as well (e.g., the model" << std::endl;
+    os << "                        before quantization), and report the accuracy delta" << std::endl;
+    os << "                        of the model from the baseline (with -t)" << std::endl;
     os << "  -n, --negative=LABEL  assume LABEL to be a negative label" << std::endl;
     os << "  -w, --score           output scores for the labels" << std::endl;
     os << "  -p, --probability     output probabilities for the labels" << std::endl;
@@ -141,6 +183,16 @@ static void usage(std::ostream& os, const char *argv0)
     os << "  -a, --all             output all candidate labels in the tagging output" << std::endl;
     os << "  -f, --false           output false instances only" << std::endl;
     os << "  -q, --quiet           suppress tagging results from the output" << std::endl;
+    os << "  --threads=N           tag blocks of lines on N threads sharing the model," << std::endl;
+    os << "                        and output the results in the input order" << std::endl;
+    os << "  --server=SOCKET       keep the model in memory and serve tagging requests at" << std::endl;
+    os << "                        the Unix domain SOCKET (or framed requests from STDIN" << std::endl;
+    os << "                        if SOCKET is '-') on the threads given by --threads;" << std::endl;
+    os << "                        SIGHUP reloads the model in the background" << std::endl;
+    os << "  --batch=N             let a server thread take up to N requests at a time" << std::endl;
+    os << "                        (DEFAULT=16)" << std::endl;
+    os << "  --batch-wait=USEC     let a server thread wait up to USEC microseconds for" << std::endl;
+    os << "                        a batch to fill (DEFAULT=0)" << std::endl;
     os << "  -s, --token-separator=SEP assume SEP character as a token separator:" << std::endl;
     os << "      ' ',  s, spc, space       a SPACE (' ') character (DEFAULT)" << std::endl;
     os << "      '\\t', t, tab              a TAB ('\\t') character" << std::endl;
@@ -154,12 +206,8 @@ static void usage(std::ostream& os, const char *argv0)
     os << std::endl;
 }
 
-static int check_model(std::istream& is)
+static int check_type(const std::string& line)
 {
-    // Read the first line of the model.
-    std::string line;
-    std::getline(is, line);
-
     if (line == "@classias\tlinear\tbinary") {
         return option::TYPE_BINARY;
     } else if (line == "@classias\tlinear\tmulti\tdense") {
@@ -173,6 +221,115 @@ static int check_model(std::istream& is)
     }
 }
 
+static int check_model(std::istream& is)
+{
+    // Read the first line of the model.
+    std::string line;
+    std::getline(is, line);
+    return check_type(line);
+}
+
+static int tag_binary_model(option& opt)
+{
+    // Map the model file into memory.
+    classias::model_file model;
+    model.open(opt.model);
+
+    // Branches for the model type.
+    switch (check_type(model.type())) {
+    case option::TYPE_BINARY:
+        return binary_tag(opt, model);
+    case option::TYPE_MULTI_SPARSE:
+    case option::TYPE_MULTI_DENSE:
+        return multi_tag(opt, model);
+    case option::TYPE_CANDIDATE:
+        return candidate_tag(opt, model);
+    default:
+        opt.es << "ERROR: unknown model type" << std::endl;
+        return 1;
+    }
+}
+
+static int load_model(option& opt)
+{
+    // Use the model in the binary format without reading it.
+    if (classias::model_file::test(opt.model)) {
+        return tag_binary_model(opt);
+    }
+
+    // Open the model file.
+    std::ifstream ifs(opt.model.c_str());
+    if (ifs.fail()) {
+        opt.es << "ERROR: failed to open the model file: " << opt.model << std::endl;
+        return 1;
+    }
+
+    // Branches for the model type.
+    switch (check_model(ifs)) {
+    case option::TYPE_BINARY:
+        return binary_tag(opt, ifs);
+    case option::TYPE_MULTI_SPARSE:
+    case option::TYPE_MULTI_DENSE:
+        return multi_tag(opt, ifs);
+    case option::TYPE_CANDIDATE:
+        return candidate_tag(opt, ifs);
+    default:
+        opt.es << "ERROR: unknown model type" << std::endl;
+        return 1;
+    }
+}
+
+static int tag_with_baseline(option& opt)
+{
+    // Read the labeled data to evaluate both models on it.
+    std::ostringstream data;
+    data << opt.is.rdbuf();
+    std::istringstream bis(data.str());
+    std::istringstream mis(data.str());
+    std::ostringstream bos;
+    option bopt(bis, bos, opt.es);
+    option mopt(mis, opt.os, opt.es);
+    option* opts[] = {&bopt, &mopt};
+    for (int i = 0;i < 2;++i) {
+        opts[i]->model = opt.model;
+        opts[i]->test = opt.test;
+        opts[i]->condition = opt.condition;
+        opts[i]->output = opt.output;
+        opts[i]->threads = opt.threads;
+        opts[i]->token_separator = opt.token_separator;
+        opts[i]->value_separator = opt.value_separator;
+        opts[i]->negative_labels = opt.negative_labels;
+    }
+
+    // Evaluate the baseline model without the tagging results.
+    classias::accuracy bacc;
+    bopt.model = opt.baseline;
+    bopt.condition = option::CONDITION_NONE;
+    bopt.accuracy = &bacc;
+    int ret = load_model(bopt);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Evaluate the model.
+    classias::accuracy macc;
+    mopt.accuracy = &macc;
+    ret = load_model(mopt);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // Report the performance of the baseline model and the delta.
+    opt.os << "Baseline: " << opt.baseline << std::endl;
+    opt.os << bos.str();
+    opt.os << "Accuracy delta: " <<
+        std::showpos << std::fixed << std::setprecision(6) <<
+        (static_cast<double>(macc) - static_cast<double>(bacc)) << std::endl;
+    opt.os.unsetf(std::ios::showpos | std::ios::fixed);
+    opt.os << std::setprecision(6);
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     int ret = 0;
@@ -207,33 +364,25 @@ int main(int argc, char *argv[])
         return ret;
     }
 
-    // Open the model file.
-    std::ifstream ifs(opt.model.c_str());
-    if (ifs.fail()) {
-        es << "ERROR: failed to open the model file: " << opt.model << std::endl;
+    // The server does not know the reference labels of the requests.
+    if (!opt.server.empty() && opt.test) {
+        es << "ERROR: the server does not support the evaluation (-t)" << std::endl;
+        return 1;
+    }
+    if (!opt.baseline.empty() && !opt.test) {
+        es << "ERROR: the baseline model (--baseline) requires the evaluation (-t)" << std::endl;
         return 1;
     }
-
-    // Check the model type.
-    int type = check_model(ifs);
 
     try {
-        // Branches for the model type.
-        switch (type) {
-        case option::TYPE_BINARY:
-            ret = binary_tag(opt, ifs);
-            break;
-        case option::TYPE_MULTI_SPARSE:
-        case option::TYPE_MULTI_DENSE:
-            ret = multi_tag(opt, ifs);
-            break;
-        case option::TYPE_CANDIDATE:
-            ret = candidate_tag(opt, ifs);
-            break;
-        default:
-            es << "ERROR: unknown model type" << std::endl;
-            ret = 1;
-            break;
+        if (!opt.server.empty()) {
+            // Serve the requests, loading the model in the background.
+            tagging_server server(opt, load_model);
+            ret = server.run();
+        } else if (!opt.baseline.empty()) {
+            ret = tag_with_baseline(opt);
+        } else {
+            ret = load_model(opt);
         }
     } catch (const std::exception& e) {
         es << "ERROR: " << typeid(e).name() << ": " << e.what() << std::endl;
@@ -45,48 +45,36 @@
 #include <classias/evaluation.h>
 
 #include "option.h"
+#include "tagger.h"
 #include "tokenize.h"
-#include "defaultmap.h"
+#include "weight_table.h"
 #include <util.h>
 
-typedef defaultmap<std::string, double> model_type;
+typedef row_table model_type;
 typedef std::vector<std::string> labels_type;
 typedef std::vector<int> positive_labels_type;
-typedef classias::classify::linear_multi_logistic<model_type> classifier_type;
 
-class feature_generator
+template <class classifier_type, class model_type>
+static inline void
+set_attribute(
+    classifier_type& inst,
+    const model_type& model,
+    const std::string& name,
+    double value
+    )
 {
-public:
-    typedef std::string attribute_type;
-    typedef std::string label_type;
-    typedef std::string feature_type;
-
-public:
-    feature_generator()
-    {
+    // Add the weights in the row of the attribute to the label scores.
+    int a = model.find_attribute(name.c_str(), name.size());
+    if (0 <= a) {
+        model.add_row(inst, a, value);
     }
+}
 
-    virtual ~feature_generator()
-    {
-    }
-
-    inline bool forward(
-        const std::string& a,
-        const std::string& l,
-        std::string& f
-        ) const
-    {
-        f  = a;
-        f += '\t';
-        f += l;
-        return true;
-    }
-};
-
+template <class classifier_type, class model_type>
 static void
 parse_line(
     classifier_type& inst,
-    const feature_generator& fgen,
+    const model_type& model,
     std::string& rl,
     const classias::quark& labels,
     const option& opt,
@@ -115,20 +103,13 @@ parse_line(
     // Set attributes for the instance.
     for (++itv;itv != values.end();++itv) {
         if (!itv->empty()) {
-            double value;
-            std::string name;
             get_name_value(*itv, name, value, opt.value_separator);
-
-            for (int i = 0;i < (int)labels.size();++i) {
-                inst.set(i, fgen, name, labels.to_item(i), value);
-            }
+            set_attribute(inst, model, name, value);
         }
     }
 
     // Apply the bias feature if any.
-    for (int i = 0;i < (int)labels.size();++i) {
-        inst.set(i, fgen, "__BIAS__", labels.to_item(i), 1.0);
-    }
+    set_attribute(inst, model, "__BIAS__", 1.0);
 
     // Finalize the instance.
     inst.finalize();
@@ -169,94 +150,98 @@ read_model(
             throw invalid_model("feature name is missing", line);
         }
 
-        model.insert(model_type::pair_type(line.substr(pos), w));
+        // Split the feature name into the attribute and label.
+        int sep = line.rfind('\t');
+        if (sep < pos) {
+            throw invalid_model("label is missing", line);
+        }
+        int l = labels.to_value(line.substr(sep+1), -1);
+        if (l < 0) {
+            // Ignore a feature of a label not listed in the model.
+            continue;
+        }
+
+        model.insert(line.c_str() + pos, sep - pos, l, w);
     }
-}
 
-static void output_model_label(
-    std::ostream& os,
-    classifier_type& inst,
-    const classias::quark& labels,
-    option& opt
-    )
-{
+    model.finalize();
 }
 
-int multi_tag(option& opt, std::ifstream& ifs)
+template <class model_type>
+class multi_tagger
 {
-    int lines = 0;
-    feature_generator fgen;
-    std::istream& is = opt.is;
-    std::ostream& os = opt.os;
+protected:
+    typedef classias::classify::linear_multi_logistic<model_type> classifier_type;
+
+    const model_type& m_model;
+    const classias::quark& m_labels;
+    const option& m_opt;
+    classifier_type m_inst;
+    positive_labels_type m_positives;
+    classias::accuracy m_acc;
+    classias::precall m_pr;
+    classias::quark m_rlabels;
 
-    // Load a model.
-    model_type model;
-    classias::quark labels;
-    read_model(model, labels, ifs, opt);
-
-    // Create an instance of a classifier on the model.
-    classifier_type inst(model);
-
-    // Generate a set of positive labels (necessary only for evaluation).
-    positive_labels_type positives;
-    if (opt.test) {
-        for (int i = 0;i < (int)labels.size();++i) {
-            if (opt.negative_labels.find(labels.to_item(i)) == opt.negative_labels.end()) {
-                positives.push_back(i);
+public:
+    multi_tagger(
+        const model_type& model,
+        const classias::quark& labels,
+        const option& opt
+        )
+        : m_model(model), m_labels(labels), m_opt(opt), m_inst(model),
+        m_pr(labels.size()), m_rlabels(labels)
+    {
+        // Generate a set of positive labels (necessary only for evaluation).
+        if (m_opt.test) {
+            for (int i = 0;i < (int)labels.size();++i) {
+                if (m_opt.negative_labels.find(labels.to_item(i)) == m_opt.negative_labels.end()) {
+                    m_positives.push_back(i);
+                }
             }
         }
     }
 
-    // Objects for performance evaluation.
-    classias::accuracy acc;
-    classias::precall pr(labels.size());
-
-    // Create another quark for labels unseen in the training stage.
-    classias::quark rlabels = labels;
-
-    for (;;) {
-        // Read a line.
-        std::string line;
-        std::getline(is, line);
-        if (is.eof()) {
-            break;
-        }
-        ++lines;
+    static bool boundary(const std::string& line)
+    {
+        return true;
+    }
 
+    void process(const std::string& line, int lines, std::ostream& os)
+    {
         // An empty line or comment line.
         if (line.empty() || line.compare(0, 1, "#") == 0) {
             // Output the comment line if necessary.
-            if (opt.output & option::OUTPUT_COMMENT) {
+            if (m_opt.output & option::OUTPUT_COMMENT) {
                 os << line << std::endl;
             }
-            continue;
+            return;
         }
 
         // Parse the line and classify the instance.
         std::string rlabel;
-        parse_line(inst, fgen, rlabel, labels, opt, line, lines);
+        parse_line(m_inst, m_model, rlabel, m_labels, m_opt, line, lines);
 
         // Determine whether we output this instance or not.
-        if (opt.condition == option::CONDITION_ALL ||
-            (opt.condition == option::CONDITION_FALSE && labels.to_item(inst.argmax()) != rlabel)) {
-            if (opt.output & option::OUTPUT_ALL) {
+        if (m_opt.condition == option::CONDITION_ALL ||
+            (m_opt.condition == option::CONDITION_FALSE && m_labels.to_item(m_inst.argmax()) != rlabel)) {
+            if (m_opt.output & option::OUTPUT_ALL) {
                 // Output all candidates
                 os << "@boi" << std::endl;
 
-                for (int i = 0;i < inst.size();++i) {
+                for (int i = 0;i < m_inst.size();++i) {
                     // Output the reference label.
-                    if (opt.output & option::OUTPUT_RLABEL) {
-                        os << ((labels.to_item(i) == rlabel) ? '+' : '-');
+                    if (m_opt.output & option::OUTPUT_RLABEL) {
+                        os << ((m_labels.to_item(i) == rlabel) ? '+' : '-');
                     }
                     // Output the predicted label.
-                    os << ((i == inst.argmax()) ? '+' : '-');
-                    os << labels.to_item(i);
+                    os << ((i == m_inst.argmax()) ? '+' : '-');
+                    os << m_labels.to_item(i);
 
                     // Output the score/probability if necessary.
-                    if (opt.output & option::OUTPUT_PROBABILITY) {
-                        os << opt.value_separator << inst.prob(i);
-                    } else if (opt.output & option::OUTPUT_SCORE) {
-                        os << opt.value_separator << inst.score(i);
+                    if (m_opt.output & option::OUTPUT_PROBABILITY) {
+                        os << m_opt.value_separator << m_inst.prob(i);
+                    } else if (m_opt.output & option::OUTPUT_SCORE) {
+                        os << m_opt.value_separator << m_inst.score(i);
                     }
 
                     os << std::endl;
@@ -268,47 +253,86 @@ int multi_tag(option& opt, std::ifstream& ifs)
                 // Output the predicted candidate only.
 
                 // Output the reference label.
-                if (opt.output & option::OUTPUT_RLABEL) {
-                    os << rlabel << opt.token_separator;
+                if (m_opt.output & option::OUTPUT_RLABEL) {
+                    os << rlabel << m_opt.token_separator;
                 }
 
                 // Output the predicted label.
-                os << labels.to_item(inst.argmax());
+                os << m_labels.to_item(m_inst.argmax());
 
                 // Output the score/probability if necessary.
-                if (opt.output & option::OUTPUT_PROBABILITY) {
-                    os << opt.value_separator << inst.prob(inst.argmax());
-                } else if (opt.output & option::OUTPUT_SCORE) {
-                    os << opt.value_separator << inst.score(inst.argmax());
+                if (m_opt.output & option::OUTPUT_PROBABILITY) {
+                    os << m_opt.value_separator << m_inst.prob(m_inst.argmax());
+                } else if (m_opt.output & option::OUTPUT_SCORE) {
+                    os << m_opt.value_separator << m_inst.score(m_inst.argmax());
                 }
 
                 os << std::endl;
             }
+        }
 
+        // Accumulate the performance. An instance of a label unseen in the
+        // training stage counts as an error in the accuracy (including the
+        // first instance, so that the accuracy does not depend on the
+        // assignment of instances to threads).
+        if (m_opt.test) {
+            int pl = m_inst.argmax();
+            int rl = m_rlabels.to_value(rlabel, m_rlabels.size());
+            if (rl == (int)m_rlabels.size()) {
+                rl = m_rlabels(rlabel);
+                m_pr.resize(m_rlabels.size());
+            }
+            m_acc.set(pl == rl);
+            m_pr.set(pl, rl);
         }
+    }
 
-        // Accumulate the performance.
-        if (opt.test) {
-            int pl = inst.argmax();
-            int rl = rlabels.to_value(rlabel, rlabels.size());
-            if (rl != rlabels.size()) {
-                acc.set(pl == rl);
-                pr.set(pl, rl);
-            } else {
-                int rl = rlabels(rlabel);
-                pr.resize(rlabels.size());
-                pr.set(pl, rl);
+    void reset()
+    {
+    }
+
+    void merge(const multi_tagger& other)
+    {
+        // The labels unseen in the training stage are numbered by each
+        // tagger, but they are not positive labels.
+        m_acc.merge(other.m_acc);
+        m_pr.merge(other.m_pr);
+    }
+
+    void finish(std::ostream& os)
+    {
+        // Output the performance if necessary.
+        if (m_opt.test) {
+            if (m_opt.accuracy != NULL) {
+                *m_opt.accuracy = m_acc;
             }
+            m_acc.output(os);
+            m_pr.output_labelwise(os, m_labels, m_positives.begin(), m_positives.end());
+            m_pr.output_micro(os, m_positives.begin(), m_positives.end());
+            m_pr.output_macro(os, m_positives.begin(), m_positives.end());
         }
     }
+};
+
+int multi_tag(option& opt, std::ifstream& ifs)
+{
+    // Load a model.
+    model_type model;
+    classias::quark labels;
+    read_model(model, labels, ifs, opt);
+    return run_tagger(opt, multi_tagger<model_type>(model, labels, opt));
+}
 
-    // Output the performance if necessary.
-    if (opt.test) {
-        acc.output(os);
-        pr.output_labelwise(os, labels, positives.begin(), positives.end());
-        pr.output_micro(os, positives.begin(), positives.end());
-        pr.output_macro(os, positives.begin(), positives.end());
+int multi_tag(option& opt, const classias::model_file& model)
+{
+    if (model.num_attributes() == 0 && 0 < model.num_features()) {
+        throw invalid_model("the binary model has no row of attributes");
     }
 
-    return 0;
+    // Read the labels from the model.
+    classias::quark labels;
+    for (int i = 0;i < model.num_labels();++i) {
+        labels(model.label(i));
+    }
+    return run_tagger(opt, multi_tagger<classias::model_file>(model, labels, opt));
 }
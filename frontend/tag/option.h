@@ -37,6 +37,13 @@
 #include <set>
 #include <string>
 
+class model_registry;
+
+namespace classias
+{
+class accuracy;
+};
+
 class option
 {
 public:
@@ -83,6 +90,13 @@ public:
     bool        test;
     int         condition;
     int         output;
+    int         threads;
+    std::string server;
+    int         batch_size;
+    int         batch_wait;
+    model_registry* registry;
+    std::string baseline;
+    classias::accuracy* accuracy;
 
     char        token_separator;
     char        value_separator;
@@ -96,7 +110,8 @@ public:
         ) :
         is(_is), os(_os), es(_es),
         mode(MODE_NORMAL),
-        test(false), condition(CONDITION_ALL), output(OUTPUT_MLABEL),
+        test(false), condition(CONDITION_ALL), output(OUTPUT_MLABEL), threads(1),
+        batch_size(16), batch_wait(0), registry(NULL), accuracy(NULL),
         token_separator(' '), value_separator(':')
     {
     }
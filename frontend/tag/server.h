@@ -0,0 +1,950 @@
+/*
+ *		Persistent tagging server.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <signal.h>
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif/*_WIN32*/
+
+#include <classias/thread.h>
+
+#include "option.h"
+#include <serving.h>
+
+/**
+ * A request to the tagging server.
+ */
+struct server_request
+{
+    /// The lines to be tagged.
+    std::string input;
+    /// The tagging output.
+    std::string output;
+    /// The time when the request was queued.
+    double arrival;
+    /// Whether the request has been served.
+    bool done;
+
+    server_request() : arrival(0.), done(false)
+    {
+    }
+};
+
+/**
+ * A queue of requests shared by connections and workers.
+ *
+ *  A worker takes the requests queued (up to the batch size) at a time,
+ *  optionally waiting for a while until the batch fills, so that requests
+ *  from concurrent clients are tagged in a batch with a single wake-up of
+ *  the worker.
+ */
+class request_queue
+{
+protected:
+    classias::mutex m_mutex;
+    classias::condition m_ready;
+    classias::condition m_done;
+    std::deque<server_request*> m_queue;
+    bool m_closed;
+
+    latency_stats m_latencies;
+    size_t m_num_batches;
+    double m_start;
+
+public:
+    request_queue() : m_closed(false), m_num_batches(0), m_start(classias::monotonic_time())
+    {
+    }
+
+    /**
+     * Queues a request (for a connection).
+     *  @param  r           The request.
+     */
+    void push(server_request* r)
+    {
+        classias::scoped_lock lock(m_mutex);
+        r->arrival = classias::monotonic_time();
+        r->done = false;
+        m_queue.push_back(r);
+        m_ready.signal();
+    }
+
+    /**
+     * Waits until a request is served (for a connection).
+     *  @param  r           The request.
+     */
+    void wait(server_request* r)
+    {
+        classias::scoped_lock lock(m_mutex);
+        while (!r->done) {
+            m_done.wait(m_mutex);
+        }
+    }
+
+    /**
+     * Takes a batch of requests (for a worker).
+     *  @param  batch       The vector receiving the requests.
+     *  @param  size        The maximum number of requests in a batch.
+     *  @param  usec        The maximum time in microseconds to wait for
+     *                      the batch to fill.
+     *  @retval bool        \c false if the queue has been closed.
+     */
+    bool pop(std::vector<server_request*>& batch, size_t size, unsigned int usec)
+    {
+        classias::scoped_lock lock(m_mutex);
+        batch.clear();
+        while (batch.empty()) {
+            while (m_queue.empty() && !m_closed) {
+                m_ready.wait(m_mutex);
+            }
+            if (m_queue.empty()) {
+                return false;
+            }
+
+            // Wait for more requests to fill the batch.
+            if (0 < usec) {
+                const double deadline = classias::monotonic_time() + usec * 1e-6;
+                while (m_queue.size() < size && !m_closed) {
+                    double remaining = deadline - classias::monotonic_time();
+                    if (remaining <= 0.) {
+                        break;
+                    }
+                    m_ready.wait(m_mutex, (unsigned int)(remaining * 1e6) + 1);
+                }
+            }
+
+            // Another worker may have taken the requests while waiting.
+            while (!m_queue.empty() && batch.size() < size) {
+                batch.push_back(m_queue.front());
+                m_queue.pop_front();
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Notifies the connections of the requests served (for a worker).
+     *  @param  batch       The requests served.
+     */
+    void complete(const std::vector<server_request*>& batch)
+    {
+        classias::scoped_lock lock(m_mutex);
+        const double now = classias::monotonic_time();
+        for (size_t i = 0;i < batch.size();++i) {
+            batch[i]->done = true;
+            m_latencies.add(now - batch[i]->arrival);
+        }
+        ++m_num_batches;
+        m_done.broadcast();
+    }
+
+    /**
+     * Closes the queue, which stops the workers.
+     */
+    void close()
+    {
+        classias::scoped_lock lock(m_mutex);
+        m_closed = true;
+        m_ready.broadcast();
+    }
+
+    /**
+     * Outputs the statistics of the requests served.
+     *  @param  os          The output stream.
+     */
+    void output(std::ostream& os)
+    {
+        classias::scoped_lock lock(m_mutex);
+        m_latencies.output(os, classias::monotonic_time() - m_start);
+        os << "Batches: " << m_num_batches;
+        if (0 < m_num_batches) {
+            os << " (" << (double)m_latencies.size() / m_num_batches << " requests/batch)";
+        }
+        os << std::endl;
+    }
+};
+
+/**
+ * A tagger of a model generation (hiding the type of the tagger).
+ */
+class served_tagger
+{
+public:
+    virtual ~served_tagger()
+    {
+    }
+
+    virtual void process(const std::string& line, int lines, std::ostream& os) = 0;
+    virtual void reset() = 0;
+};
+
+template <class tagger_type>
+class served_tagger_impl : public served_tagger
+{
+protected:
+    tagger_type m_tagger;
+
+public:
+    served_tagger_impl(const tagger_type& tagger) : m_tagger(tagger)
+    {
+    }
+
+    virtual void process(const std::string& line, int lines, std::ostream& os)
+    {
+        m_tagger.process(line, lines, os);
+    }
+
+    virtual void reset()
+    {
+        m_tagger.reset();
+    }
+};
+
+/**
+ * A generation of the model served.
+ *
+ *  A generation lives in the stack of the loader thread that read the
+ *  model, together with the model. The loader thread publishes the
+ *  generation, and waits until the generation retires, i.e., until a newer
+ *  generation has been published and the last worker using this generation
+ *  has released it; the model is then destroyed as the loader thread
+ *  returns. Every worker creates its own tagger of the generation.
+ */
+class model_generation
+{
+public:
+    /// The generation number.
+    int id;
+    /// The path to the model file.
+    std::string path;
+    /// The number of workers using this generation.
+    int readers;
+    /// The time when a newer generation was published.
+    double retired;
+    /// The taggers of the workers.
+    std::vector<served_tagger*> taggers;
+
+    model_generation(int num_workers) : id(0), readers(0), retired(0.), taggers(num_workers, NULL)
+    {
+    }
+
+    virtual ~model_generation()
+    {
+        for (size_t i = 0;i < taggers.size();++i) {
+            delete taggers[i];
+        }
+    }
+
+    /**
+     * Returns the tagger of a worker (for the worker).
+     *  @param  i           The index of the worker.
+     *  @return served_tagger&  The tagger.
+     */
+    served_tagger& tagger(int i)
+    {
+        if (taggers[i] == NULL) {
+            taggers[i] = create();
+        }
+        return *taggers[i];
+    }
+
+protected:
+    virtual served_tagger* create() const = 0;
+};
+
+template <class tagger_type>
+class model_generation_impl : public model_generation
+{
+protected:
+    const tagger_type& m_prototype;
+
+public:
+    model_generation_impl(const tagger_type& prototype, int num_workers)
+        : model_generation(num_workers), m_prototype(prototype)
+    {
+    }
+
+    virtual ~model_generation_impl()
+    {
+    }
+
+protected:
+    virtual served_tagger* create() const
+    {
+        return new served_tagger_impl<tagger_type>(m_prototype);
+    }
+};
+
+/**
+ * The models served, which are replaced without stopping the server.
+ *
+ *  A new model is read by a loader thread in the background while the
+ *  workers keep on tagging with the current model. The loader thread calls
+ *  the loader function (e.g., the one reading a model in the text or binary
+ *  format), which eventually calls run_tagger() and then publish() with the
+ *  tagger of the model. The publication replaces the pointer to the current
+ *  generation only; a worker acquires the current generation for a batch
+ *  and releases it after the batch, so that requests in flight finish with
+ *  the previous generation, which is reclaimed when its last worker leaves.
+ */
+class model_registry
+{
+public:
+    /// The type of a function loading a model and calling run_tagger().
+    typedef int (*loader_type)(option& opt);
+
+protected:
+    /// A task loading a model.
+    struct load_task
+    {
+        model_registry* owner;
+        option opt;
+        double begin;
+        bool published;
+        bool done;
+        bool waiting;
+        std::string report;
+        std::string error;
+        classias::thread thread;
+
+        load_task(model_registry* _owner, const option& _opt)
+            : owner(_owner), opt(_opt), begin(0.), published(false),
+            done(false), waiting(false)
+        {
+        }
+    };
+
+    const option& m_opt;
+    loader_type m_loader;
+    int m_num_workers;
+
+    classias::mutex m_mutex;
+    classias::condition m_changed;
+    model_generation* m_current;
+    std::vector<load_task*> m_tasks;
+
+    int m_num_generations;
+    int m_num_failures;
+    double m_load_time;
+    double m_swap_time;
+    double m_drain_time;
+
+public:
+    model_registry(const option& opt, loader_type loader, int num_workers)
+        : m_opt(opt), m_loader(loader), m_num_workers(num_workers),
+        m_current(NULL), m_num_generations(0), m_num_failures(0),
+        m_load_time(0.), m_swap_time(0.), m_drain_time(0.)
+    {
+    }
+
+    virtual ~model_registry()
+    {
+        close();
+    }
+
+    /**
+     * Acquires the current generation (for a worker).
+     *  @return model_generation*   The current generation, or \c NULL if
+     *                              no model has been published.
+     */
+    model_generation* acquire()
+    {
+        classias::scoped_lock lock(m_mutex);
+        if (m_current != NULL) {
+            ++m_current->readers;
+        }
+        return m_current;
+    }
+
+    /**
+     * Releases a generation (for a worker).
+     *  @param  g           The generation acquired by acquire().
+     */
+    void release(model_generation* g)
+    {
+        classias::scoped_lock lock(m_mutex);
+        if (--g->readers == 0 && g != m_current) {
+            m_changed.broadcast();
+        }
+    }
+
+    /**
+     * Loads a model, and waits until it is published.
+     *  @param  path        The path to the model file.
+     *  @param  message     The string receiving the report of the loading
+     *                      or the error message.
+     *  @retval bool        \c true if the model has been published.
+     */
+    bool load(const std::string& path, std::string& message)
+    {
+        load_task* t = start(path, true);
+
+        classias::scoped_lock lock(m_mutex);
+        while (!t->published && !t->done) {
+            m_changed.wait(m_mutex);
+        }
+        t->waiting = false;
+
+        if (!t->published) {
+            message = t->error;
+            return false;
+        }
+
+        message = t->report;
+        return true;
+    }
+
+    /**
+     * Returns the path to the model file of the current generation.
+     *  @return std::string The path, or the path given by the options if no
+     *                      model has been published.
+     */
+    std::string current_path()
+    {
+        classias::scoped_lock lock(m_mutex);
+        return (m_current != NULL) ? m_current->path : m_opt.model;
+    }
+
+    /**
+     * Loads a model in the background.
+     *  @param  path        The path to the model file.
+     */
+    void reload(const std::string& path)
+    {
+        start(path, false);
+    }
+
+    /**
+     * Publishes the tagger of a model (for a loader thread).
+     *  This function returns when the generation of the model retires.
+     *  @param  opt         The options of the load task.
+     *  @param  tagger      The tagger.
+     *  @return int         The exit code.
+     */
+    template <class tagger_type>
+    int publish(option& opt, const tagger_type& tagger)
+    {
+        model_generation_impl<tagger_type> g(tagger, m_num_workers);
+        std::ostringstream ss;
+
+        {
+            classias::scoped_lock lock(m_mutex);
+            load_task* t = find(opt);
+            g.id = ++m_num_generations;
+            g.path = opt.model;
+
+            // Replace the current generation.
+            const double begin = classias::monotonic_time();
+            model_generation* old = m_current;
+            m_current = &g;
+            if (old != NULL) {
+                old->retired = begin;
+            }
+            m_swap_time = classias::monotonic_time() - begin;
+
+            m_load_time = begin - t->begin;
+            ss << "Model: " << g.path << " (generation " << g.id << ")" << std::endl;
+            ss << "Load time: " << m_load_time << " [s]" << std::endl;
+            ss << "Swap time: " << m_swap_time * 1e6 << " [us]" << std::endl;
+            t->report = ss.str();
+            t->published = true;
+            m_changed.broadcast();
+            if (t->waiting) {
+                // The thread waiting for the model writes the report.
+                ss.str("");
+            }
+        }
+        m_opt.es << ss.str();
+        ss.str("");
+
+        // Wait until a newer generation is published and the last worker
+        // using this generation leaves.
+        {
+            classias::scoped_lock lock(m_mutex);
+            while (m_current == &g || 0 < g.readers) {
+                m_changed.wait(m_mutex);
+            }
+            if (0. < g.retired) {
+                m_drain_time = classias::monotonic_time() - g.retired;
+                ss << "Released the model: " << g.path << " (generation " << g.id << ") ";
+                ss << m_drain_time * 1000 << " [ms] after the swap" << std::endl;
+            }
+        }
+
+        m_opt.es << ss.str();
+        return 0;
+    }
+
+    /**
+     * Joins the loader threads that have finished.
+     *  @param  all         Join all loader threads (after close()).
+     */
+    void reap(bool all)
+    {
+        std::vector<load_task*> finished, alive;
+        {
+            classias::scoped_lock lock(m_mutex);
+            for (size_t i = 0;i < m_tasks.size();++i) {
+                load_task* t = m_tasks[i];
+                if (all || (t->done && !t->waiting)) {
+                    finished.push_back(t);
+                } else {
+                    alive.push_back(t);
+                }
+            }
+            m_tasks.swap(alive);
+        }
+
+        for (size_t i = 0;i < finished.size();++i) {
+            finished[i]->thread.join();
+            delete finished[i];
+        }
+    }
+
+    /**
+     * Retires the current generation, and joins the loader threads.
+     *  Call this function after all workers have stopped.
+     */
+    void close()
+    {
+        {
+            classias::scoped_lock lock(m_mutex);
+            m_current = NULL;
+            m_changed.broadcast();
+        }
+        reap(true);
+    }
+
+    /**
+     * Outputs the statistics of the models.
+     *  @param  os          The output stream.
+     */
+    void output(std::ostream& os)
+    {
+        classias::scoped_lock lock(m_mutex);
+        if (m_current != NULL) {
+            os << "Model: " << m_current->path << " (generation " << m_current->id << ")" << std::endl;
+        }
+        os << "Reloads: " << m_num_generations - 1;
+        os << " (" << m_num_failures << " failed)" << std::endl;
+        os << "Last load time: " << m_load_time << " [s]" << std::endl;
+        os << "Last swap time: " << m_swap_time * 1e6 << " [us]" << std::endl;
+        os << "Last release time: " << m_drain_time * 1000 << " [ms]" << std::endl;
+    }
+
+protected:
+    load_task* start(const std::string& path, bool waiting)
+    {
+        load_task* t = new load_task(this, m_opt);
+        t->opt.model = path;
+        t->opt.registry = this;
+        t->begin = classias::monotonic_time();
+        t->waiting = waiting;
+        {
+            classias::scoped_lock lock(m_mutex);
+            m_tasks.push_back(t);
+        }
+        t->thread.start(run_load, t);
+        return t;
+    }
+
+    load_task* find(const option& opt)
+    {
+        for (size_t i = 0;i < m_tasks.size();++i) {
+            if (&m_tasks[i]->opt == &opt) {
+                return m_tasks[i];
+            }
+        }
+        throw std::logic_error("unknown load task");
+    }
+
+    static void run_load(void *arg)
+    {
+        load_task* t = reinterpret_cast<load_task*>(arg);
+        model_registry* r = t->owner;
+        std::string error;
+
+        try {
+            if (r->m_loader(t->opt) != 0) {
+                error = "failed to load the model: " + t->opt.model;
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+
+        {
+            classias::scoped_lock lock(r->m_mutex);
+            if (!t->published) {
+                ++r->m_num_failures;
+                if (error.empty()) {
+                    error = "no model has been published: " + t->opt.model;
+                }
+                t->error = error;
+                if (!t->waiting) {
+                    r->m_opt.es << "ERROR: " << error << std::endl;
+                }
+            }
+            t->done = true;
+            r->m_changed.broadcast();
+        }
+    }
+};
+
+/**
+ * Whether the server has been interrupted by a signal.
+ */
+static volatile sig_atomic_t g_server_interrupted = 0;
+
+/**
+ * Whether the server has been requested to reload the model by a signal.
+ */
+static volatile sig_atomic_t g_server_reload = 0;
+
+static void server_interrupt(int)
+{
+    g_server_interrupted = 1;
+}
+
+static void server_reload(int)
+{
+    g_server_reload = 1;
+}
+
+/**
+ * A persistent tagging server.
+ *
+ *  The server keeps the model in memory, and serves requests over a Unix
+ *  domain socket or the standard input and output (see serving.h for the
+ *  protocol). A connection thread per client reads a request, queues it to
+ *  the \ref request_queue, and writes the response when a worker has
+ *  tagged the request. The statistics of the requests are written to the
+ *  error stream when the server stops at the end of the standard input,
+ *  or by SIGINT or SIGTERM.
+ *
+ *  The model is replaced by a "@reload" request (optionally followed by a
+ *  tab character and the path to a new model file) or by SIGHUP, without
+ *  dropping requests (see \ref model_registry). A request without a path
+ *  and SIGHUP reload the model file of the current generation.
+ */
+class tagging_server
+{
+protected:
+    /// A worker thread.
+    struct worker_type
+    {
+        tagging_server* owner;
+        int index;
+        classias::thread thread;
+
+        worker_type(tagging_server* _owner, int _index)
+            : owner(_owner), index(_index)
+        {
+        }
+    };
+
+    /// A connection.
+    struct connection_type
+    {
+        tagging_server* owner;
+        int fd;
+        volatile int finished;
+        classias::thread thread;
+
+        connection_type(tagging_server* _owner, int _fd)
+            : owner(_owner), fd(_fd), finished(0)
+        {
+        }
+    };
+
+    const option& m_opt;
+    request_queue m_queue;
+    model_registry m_models;
+    std::vector<worker_type*> m_workers;
+    std::vector<connection_type*> m_connections;
+    volatile int m_stopped;
+    classias::thread m_control;
+
+public:
+    tagging_server(const option& opt, model_registry::loader_type loader)
+        : m_opt(opt), m_models(opt, loader, opt.threads), m_stopped(0)
+    {
+        for (int i = 0;i < opt.threads;++i) {
+            m_workers.push_back(new worker_type(this, i));
+        }
+    }
+
+    virtual ~tagging_server()
+    {
+        for (size_t i = 0;i < m_workers.size();++i) {
+            delete m_workers[i];
+        }
+    }
+
+    /**
+     * Serves requests until the end of the input or an interruption.
+     *  @return int         The exit code.
+     */
+    int run()
+    {
+        // Load the initial model.
+        std::string message;
+        if (!m_models.load(m_opt.model, message)) {
+            m_opt.es << "ERROR: " << message << std::endl;
+            m_models.close();
+            return 1;
+        }
+        m_opt.es << message;
+
+        for (size_t i = 0;i < m_workers.size();++i) {
+            m_workers[i]->thread.start(work, m_workers[i]);
+        }
+        m_control.start(control, this);
+
+        signal(SIGINT, server_interrupt);
+        signal(SIGTERM, server_interrupt);
+#ifndef _WIN32
+        signal(SIGHUP, server_reload);
+        signal(SIGPIPE, SIG_IGN);
+#endif/*_WIN32*/
+
+        try {
+            if (m_opt.server == "-") {
+                serve(0, 1);
+            } else {
+                listen();
+            }
+        } catch (const serving_error& e) {
+            m_opt.es << "ERROR: " << e.what() << std::endl;
+        }
+
+        // Stop the workers, and then release the model.
+        classias::store_release(m_stopped, 1);
+        m_control.join();
+        m_queue.close();
+        for (size_t i = 0;i < m_workers.size();++i) {
+            m_workers[i]->thread.join();
+        }
+        m_models.close();
+
+        m_queue.output(m_opt.es);
+        return 0;
+    }
+
+protected:
+    void listen()
+    {
+#ifdef  _WIN32
+        throw serving_error("Unix domain sockets are unavailable; use '--server=-'");
+#else
+        int fd = listen_socket(m_opt.server);
+        m_opt.es << "Listening at " << m_opt.server << std::endl;
+
+        while (!g_server_interrupted) {
+            // Wait for a connection.
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (poll(&pfd, 1, 200) == 1) {
+                int cfd = accept(fd, NULL, NULL);
+                if (cfd != -1) {
+                    connection_type* c = new connection_type(this, cfd);
+                    m_connections.push_back(c);
+                    c->thread.start(connect, c);
+                }
+            }
+
+            // Release the connections closed.
+            reap(false);
+        }
+
+        ::close(fd);
+        unlink(m_opt.server.c_str());
+        reap(true);
+#endif/*_WIN32*/
+    }
+
+    void reap(bool all)
+    {
+#ifndef _WIN32
+        std::vector<connection_type*> alive;
+        for (size_t i = 0;i < m_connections.size();++i) {
+            connection_type* c = m_connections[i];
+            if (all && !classias::load_acquire(c->finished)) {
+                // Unblock the connection waiting for a request.
+                shutdown(c->fd, SHUT_RDWR);
+            }
+            if (all || classias::load_acquire(c->finished)) {
+                c->thread.join();
+                ::close(c->fd);
+                delete c;
+            } else {
+                alive.push_back(c);
+            }
+        }
+        m_connections.swap(alive);
+#endif/*_WIN32*/
+    }
+
+    static void connect(void *arg)
+    {
+        connection_type* c = reinterpret_cast<connection_type*>(arg);
+        try {
+            c->owner->serve(c->fd, c->fd);
+        } catch (const serving_error&) {
+            // The client has closed the connection abruptly.
+        }
+        classias::store_release(c->finished, 1);
+    }
+
+    static void control(void *arg)
+    {
+        tagging_server* s = reinterpret_cast<tagging_server*>(arg);
+        while (!classias::load_acquire(s->m_stopped)) {
+            if (g_server_reload) {
+                g_server_reload = 0;
+                const std::string path = s->m_models.current_path();
+                s->m_opt.es << "Reloading the model: " << path << std::endl;
+                s->m_models.reload(path);
+            }
+
+            // Join the loader threads of the models released.
+            s->m_models.reap(false);
+            classias::thread::sleep(100);
+        }
+    }
+
+    void serve(int in, int out)
+    {
+        frame_reader reader(in);
+        server_request r;
+        while (!g_server_interrupted && reader.read(r.input)) {
+            // Strip a newline at the end of a command.
+            std::string command = r.input;
+            if (!command.empty() && command[command.size()-1] == '\n') {
+                command.erase(command.size()-1);
+            }
+
+            if (command == "@stats") {
+                std::ostringstream ss;
+                m_queue.output(ss);
+                m_models.output(ss);
+                write_frame(out, ss.str());
+                continue;
+            } else if (command == "@reload" || command.compare(0, 8, "@reload\t") == 0) {
+                std::string path = (command.size() <= 8) ? m_models.current_path() : command.substr(8);
+                std::string message;
+                if (m_models.load(path, message)) {
+                    m_opt.es << message;
+                    write_frame(out, message);
+                } else {
+                    write_frame(out, "@error\t" + message + "\n");
+                }
+                continue;
+            }
+
+            m_queue.push(&r);
+            m_queue.wait(&r);
+            write_frame(out, r.output);
+        }
+    }
+
+    static void work(void *arg)
+    {
+        worker_type* w = reinterpret_cast<worker_type*>(arg);
+        request_queue& queue = w->owner->m_queue;
+        model_registry& models = w->owner->m_models;
+        const option& opt = w->owner->m_opt;
+        std::vector<server_request*> batch;
+        std::ostringstream os;
+        std::string line;
+
+        while (queue.pop(batch, opt.batch_size, opt.batch_wait)) {
+            // Use the same generation of the model for the batch.
+            model_generation* g = models.acquire();
+            served_tagger& tagger = g->tagger(w->index);
+
+            for (size_t i = 0;i < batch.size();++i) {
+                server_request* r = batch[i];
+                tagger.reset();
+                try {
+                    // Tag the lines in the request.
+                    int lines = 0;
+                    size_t begin = 0;
+                    while (begin < r->input.size()) {
+                        size_t end = r->input.find('\n', begin);
+                        if (end == std::string::npos) {
+                            end = r->input.size();
+                        }
+                        line.assign(r->input, begin, end - begin);
+                        tagger.process(line, ++lines, os);
+                        begin = end + 1;
+                    }
+                    r->output = os.str();
+                } catch (const std::exception& e) {
+                    r->output = std::string("@error\t") + e.what() + "\n";
+                }
+                os.str("");
+            }
+
+            models.release(g);
+            queue.complete(batch);
+        }
+    }
+};
+
+/**
+ * Publishes a tagger to the server (for the loader thread of a model).
+ *  @param  opt         The options of the load task.
+ *  @param  tagger      The tagger.
+ *  @return int         The exit code.
+ */
+template <class tagger_type>
+static int run_server(option& opt, const tagger_type& tagger)
+{
+    return opt.registry->publish(opt, tagger);
+}
+
+#endif/*__SERVER_H__*/
@@ -0,0 +1,382 @@
+/*
+ *		Running taggers on multiple threads.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifndef __TAGGER_H__
+#define __TAGGER_H__
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <classias/thread.h>
+#include <classias/stream.h>
+
+#include "option.h"
+#include <util.h>
+#include "server.h"
+
+/**
+ * Reads a line from the input stream.
+ *  @param  is          The input stream.
+ *  @param  line        The string receiving the line.
+ *  @retval bool        \c false at the end of the input.
+ */
+static inline bool read_line(std::istream& is, std::string& line)
+{
+    std::getline(is, line);
+    return !is.eof();
+}
+
+/**
+ * A block of input lines and the tagging output of the lines.
+ */
+struct tagger_block
+{
+    /// The line number of the first line in the block.
+    int first;
+    /// The number of lines in the block.
+    size_t size;
+    /// The lines (only the first size elements are in the block).
+    std::vector<std::string> lines;
+    /// The tagging output.
+    std::string output;
+    /// The error message if the tagger has failed.
+    std::string error;
+    /// Whether the tagger has failed.
+    bool failed;
+
+    tagger_block() : first(0), size(0), failed(false)
+    {
+    }
+
+    void swap(tagger_block& x)
+    {
+        std::swap(first, x.first);
+        std::swap(size, x.size);
+        lines.swap(x.lines);
+        output.swap(x.output);
+        error.swap(x.error);
+        std::swap(failed, x.failed);
+    }
+};
+
+/**
+ * A tagger running on multiple threads in input order.
+ *
+ *  A reader thread splits the input into blocks of lines, and hands the
+ *  blocks to the worker threads in a round-robin manner through their
+ *  input ring buffers. Every worker tags its blocks with its own copy of
+ *  the tagger (sharing the read-only model), and publishes the output to
+ *  its output ring buffer. The calling thread collects the output from
+ *  the workers in the same round-robin order, which restores the input
+ *  order without sorting, and finally merges the performance counters of
+ *  the workers.
+ *
+ *  A tagger class (tagger_type) implements:
+ *      - process(line, lines, os): tags a line.
+ *      - boundary(line): tests if a block may end after the line (e.g.,
+ *        not in the middle of an instance spanning multiple lines).
+ *      - reset(): discards the state of an incomplete instance (used by
+ *        the server between requests).
+ *      - merge(tagger): adds the performance counters of another tagger.
+ *      - finish(os): outputs the performance.
+ *
+ *  @param  tagger_type     The type of a tagger.
+ */
+template <class tagger_type>
+class parallel_tagger
+{
+protected:
+    /// A worker thread.
+    struct worker_type
+    {
+        /// The owner.
+        parallel_tagger* owner;
+        /// The tagger.
+        tagger_type tagger;
+        /// The blocks to be tagged.
+        classias::ring_buffer<tagger_block> input;
+        /// The blocks tagged.
+        classias::ring_buffer<tagger_block> output;
+        /// The thread.
+        classias::thread thread;
+
+        worker_type(parallel_tagger* _owner, const tagger_type& _tagger, size_t capacity)
+            : owner(_owner), tagger(_tagger), input(capacity), output(capacity)
+        {
+        }
+    };
+
+    /// The workers.
+    std::vector<worker_type*> m_workers;
+    /// The input stream.
+    std::istream& m_is;
+    /// The maximum number of lines in a block.
+    size_t m_block_size;
+    /// The number of blocks read.
+    volatile int m_num_blocks;
+    /// Whether the reader thread has finished.
+    volatile int m_closed;
+    /// Whether the tagging has been cancelled.
+    volatile int m_cancelled;
+    /// The reader thread.
+    classias::thread m_reader;
+
+public:
+    /**
+     * Constructs the object.
+     *  @param  tagger      The tagger copied to the workers.
+     *  @param  is          The input stream.
+     *  @param  num_threads The number of worker threads.
+     *  @param  block_size  The maximum number of lines in a block.
+     */
+    parallel_tagger(
+        const tagger_type& tagger,
+        std::istream& is,
+        int num_threads,
+        size_t block_size = 256
+        )
+        : m_is(is), m_block_size(block_size),
+        m_num_blocks(0), m_closed(0), m_cancelled(0)
+    {
+        for (int i = 0;i < num_threads;++i) {
+            m_workers.push_back(new worker_type(this, tagger, 4));
+        }
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~parallel_tagger()
+    {
+        stop();
+        for (size_t i = 0;i < m_workers.size();++i) {
+            delete m_workers[i];
+        }
+    }
+
+    /**
+     * Tags the input, and writes the output in the input order.
+     *  @param  os          The output stream.
+     *  @throws invalid_data    If a tagger fails.
+     */
+    void run(std::ostream& os)
+    {
+        const int n = (int)m_workers.size();
+
+        // Start the reader and workers.
+        for (int i = 0;i < n;++i) {
+            m_workers[i]->thread.start(work, m_workers[i]);
+        }
+        m_reader.start(read, this);
+
+        // Collect the output in the round-robin order.
+        for (int k = 0;;++k) {
+            worker_type& w = *m_workers[k % n];
+            tagger_block* b = NULL;
+            int retries = 0;
+            while ((b = w.output.front()) == NULL) {
+                if (classias::load_acquire(m_closed) && k == classias::load_acquire(m_num_blocks)) {
+                    break;
+                }
+                classias::ring_buffer<tagger_block>::backoff(retries);
+            }
+            if (b == NULL) {
+                break;
+            }
+
+            os << b->output;
+            if (b->failed) {
+                std::string error = b->error;
+                w.output.pop();
+                stop();
+                throw invalid_data(error);
+            }
+            w.output.pop();
+        }
+        stop();
+
+        // Merge the performance counters of the workers.
+        os.flush();
+        for (int i = 1;i < n;++i) {
+            m_workers[0]->tagger.merge(m_workers[i]->tagger);
+        }
+        m_workers[0]->tagger.finish(os);
+    }
+
+protected:
+    void stop()
+    {
+        classias::store_release(m_cancelled, 1);
+        m_reader.join();
+        for (size_t i = 0;i < m_workers.size();++i) {
+            m_workers[i]->thread.join();
+        }
+    }
+
+    static void read(void *arg)
+    {
+        parallel_tagger* pt = reinterpret_cast<parallel_tagger*>(arg);
+        const int n = (int)pt->m_workers.size();
+        int lines = 0;
+        bool eof = false;
+
+        for (int k = 0;!eof;++k) {
+            // Obtain a free slot of the worker.
+            worker_type& w = *pt->m_workers[k % n];
+            tagger_block* b = NULL;
+            int retries = 0;
+            while ((b = w.input.acquire()) == NULL) {
+                if (classias::load_acquire(pt->m_cancelled)) {
+                    return;
+                }
+                classias::ring_buffer<tagger_block>::backoff(retries);
+            }
+
+            // Read lines until the block is full at a boundary.
+            b->first = lines + 1;
+            b->size = 0;
+            for (;;) {
+                if (b->lines.size() <= b->size) {
+                    b->lines.resize(b->size + 1);
+                }
+                std::string& line = b->lines[b->size];
+                if (!read_line(pt->m_is, line)) {
+                    eof = true;
+                    break;
+                }
+                ++lines;
+                ++b->size;
+                if (pt->m_block_size <= b->size && tagger_type::boundary(line)) {
+                    break;
+                }
+            }
+
+            if (b->size == 0) {
+                break;
+            }
+            w.input.commit();
+            classias::store_release(pt->m_num_blocks, k + 1);
+        }
+
+        classias::store_release(pt->m_closed, 1);
+    }
+
+    static void work(void *arg)
+    {
+        worker_type& w = *reinterpret_cast<worker_type*>(arg);
+        parallel_tagger* pt = w.owner;
+        std::ostringstream os;
+
+        for (;;) {
+            // Wait for a block.
+            tagger_block* in = NULL;
+            int retries = 0;
+            while ((in = w.input.front()) == NULL) {
+                if (classias::load_acquire(pt->m_cancelled)) {
+                    return;
+                }
+                if (classias::load_acquire(pt->m_closed)) {
+                    in = w.input.front();
+                    if (in == NULL) {
+                        return;
+                    }
+                    break;
+                }
+                classias::ring_buffer<tagger_block>::backoff(retries);
+            }
+
+            // Wait for a free slot for the output.
+            tagger_block* out = NULL;
+            retries = 0;
+            while ((out = w.output.acquire()) == NULL) {
+                if (classias::load_acquire(pt->m_cancelled)) {
+                    return;
+                }
+                classias::ring_buffer<tagger_block>::backoff(retries);
+            }
+
+            // Move the block to the output slot, and tag the lines.
+            out->swap(*in);
+            w.input.pop();
+            out->failed = false;
+            try {
+                for (size_t i = 0;i < out->size;++i) {
+                    w.tagger.process(out->lines[i], out->first + (int)i, os);
+                }
+            } catch (const std::exception& e) {
+                out->failed = true;
+                out->error = e.what();
+            }
+            out->output = os.str();
+            os.str("");
+            w.output.commit();
+
+            if (out->failed) {
+                return;
+            }
+        }
+    }
+};
+
+/**
+ * Tags the input with a tagger.
+ *  @param  opt         The options (e.g., the number of threads).
+ *  @param  tagger      The tagger.
+ *  @return int         The exit code.
+ */
+template <class tagger_type>
+static int run_tagger(option& opt, const tagger_type& tagger)
+{
+    if (opt.registry != NULL) {
+        return run_server(opt, tagger);
+    }
+
+    if (1 < opt.threads) {
+        parallel_tagger<tagger_type> pt(tagger, opt.is, opt.threads);
+        pt.run(opt.os);
+        return 0;
+    }
+
+    int lines = 0;
+    std::string line;
+    tagger_type t(tagger);
+    while (read_line(opt.is, line)) {
+        t.process(line, ++lines, opt.os);
+    }
+    t.finish(opt.os);
+    return 0;
+}
+
+#endif/*__TAGGER_H__*/
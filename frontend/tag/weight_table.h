@@ -0,0 +1,422 @@
+/*
+ *		Hash tables of feature weights.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifndef __WEIGHT_TABLE_H__
+#define __WEIGHT_TABLE_H__
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <classias/model_file.h>
+
+/**
+ * A hash table numbering strings.
+ *
+ *  This class stores strings in a single arena of characters and looks
+ *  them up with an open-addressing hash table (with linear probing) of
+ *  string numbers, using the same hash function as the binary model files.
+ *  A lookup thus computes a hash value and compares (usually) one string
+ *  in contiguous memory, instead of comparing strings at every node of a
+ *  tree allocated per string.
+ */
+class string_index
+{
+protected:
+    /// The location of a string in the arena.
+    struct entry_type
+    {
+        /// The offset from the beginning of the arena.
+        size_t offset;
+        /// The length of the string.
+        unsigned int length;
+        /// The hash value of the string.
+        unsigned int hash;
+    };
+
+    /// The arena of strings.
+    std::vector<char> m_strings;
+    /// The locations of strings.
+    std::vector<entry_type> m_entries;
+    /// The hash index storing string numbers plus one (zero if empty).
+    std::vector<unsigned int> m_index;
+    /// The mask for bucket numbers.
+    unsigned int m_mask;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    string_index() : m_index(16, 0), m_mask(15)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~string_index()
+    {
+    }
+
+    /**
+     * Returns the number of strings.
+     *  @return int         The number of strings.
+     */
+    inline int size() const
+    {
+        return (int)m_entries.size();
+    }
+
+    /**
+     * Numbers a string.
+     *  @param  str         The pointer to the string.
+     *  @param  length      The length of the string.
+     *  @return int         The string number, which is assigned in the
+     *                      order of insertion.
+     */
+    int insert(const char* str, size_t length)
+    {
+        const unsigned int h = classias::model_file_format::hash(str, length);
+        int i = find(str, length, h);
+        if (0 <= i) {
+            return i;
+        }
+
+        // Append the string to the arena.
+        entry_type entry;
+        entry.offset = m_strings.size();
+        entry.length = (unsigned int)length;
+        entry.hash = h;
+        m_strings.insert(m_strings.end(), str, str + length);
+        m_entries.push_back(entry);
+
+        // Keep the load factor of the hash index no greater than 0.5.
+        i = (int)m_entries.size() - 1;
+        if (m_index.size() < 2 * m_entries.size()) {
+            rehash(2 * m_index.size());
+        } else {
+            put((unsigned int)i);
+        }
+        return i;
+    }
+
+    /**
+     * Finds a string.
+     *  @param  str         The pointer to the string.
+     *  @param  length      The length of the string.
+     *  @return int         The string number, or -1 if the string has not
+     *                      been inserted.
+     */
+    inline int find(const char* str, size_t length) const
+    {
+        return find(str, length, classias::model_file_format::hash(str, length));
+    }
+
+protected:
+    inline int find(const char* str, size_t length, unsigned int h) const
+    {
+        for (unsigned int b = h & m_mask;m_index[b] != 0;b = (b + 1) & m_mask) {
+            const entry_type& entry = m_entries[m_index[b]-1];
+            if (entry.hash == h && entry.length == length &&
+                std::memcmp(&m_strings[entry.offset], str, length) == 0) {
+                return (int)(m_index[b] - 1);
+            }
+        }
+        return -1;
+    }
+
+    void put(unsigned int i)
+    {
+        unsigned int b = m_entries[i].hash & m_mask;
+        while (m_index[b] != 0) {
+            b = (b + 1) & m_mask;
+        }
+        m_index[b] = i + 1;
+    }
+
+    void rehash(size_t num_buckets)
+    {
+        m_index.assign(num_buckets, 0);
+        m_mask = (unsigned int)num_buckets - 1;
+        for (unsigned int i = 0;i < (unsigned int)m_entries.size();++i) {
+            put(i);
+        }
+    }
+};
+
+
+
+/**
+ * A hash table of feature weights.
+ */
+class weight_table : public string_index
+{
+public:
+    /// The type of a feature weight.
+    typedef double value_type;
+
+protected:
+    /// The feature weights.
+    std::vector<double> m_weights;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    weight_table()
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~weight_table()
+    {
+    }
+
+    /**
+     * Sets the weight of a feature.
+     *  @param  name        The pointer to the feature name.
+     *  @param  length      The length of the feature name.
+     *  @param  weight      The feature weight.
+     */
+    void insert(const char* name, size_t length, double weight)
+    {
+        int i = string_index::insert(name, length);
+        if ((int)m_weights.size() <= i) {
+            m_weights.resize(i+1);
+        }
+        m_weights[i] = weight;
+    }
+
+    /**
+     * Sets the weight of a feature.
+     *  @param  name        The feature name.
+     *  @param  weight      The feature weight.
+     */
+    inline void insert(const std::string& name, double weight)
+    {
+        insert(name.c_str(), name.size(), weight);
+    }
+
+    /**
+     * Returns the weight of a feature.
+     *  @param  i           The feature number.
+     *  @return double      The feature weight.
+     */
+    inline double weight(int i) const
+    {
+        return m_weights[i];
+    }
+
+    /**
+     * Returns the weight of a feature.
+     *  @param  name        The feature name.
+     *  @return double      The feature weight, or zero if the table does
+     *                      not have the feature.
+     */
+    inline double operator[](const std::string& name) const
+    {
+        int i = find(name.c_str(), name.size());
+        return (0 <= i ? m_weights[i] : 0.);
+    }
+};
+
+
+
+/**
+ * A hash table of rows of attribute-label feature weights.
+ *
+ *  This class maps an attribute to the row of the (label number, weight)
+ *  pairs of the features of the attribute, so that a tagger accumulates
+ *  the scores of all labels for an attribute with a single lookup. The
+ *  rows are stored in consecutive feature numbers, and accessed with the
+ *  same functions as the rows of a \ref classias::model_file. Insert the
+ *  feature weights, and call finalize() before accessing the rows.
+ */
+class row_table
+{
+public:
+    /// The type of a feature weight.
+    typedef double value_type;
+
+protected:
+    /// The attributes.
+    string_index m_attributes;
+    /// The first feature numbers of the rows (and the end of the last).
+    std::vector<int> m_rows;
+    /// The label numbers of the features.
+    std::vector<int> m_labels;
+    /// The feature weights.
+    std::vector<double> m_weights;
+    /// The attribute numbers of the features inserted.
+    std::vector<int> m_inserted;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    row_table()
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~row_table()
+    {
+    }
+
+    /**
+     * Inserts the weight of a feature.
+     *  @param  attribute   The pointer to the attribute name.
+     *  @param  length      The length of the attribute name.
+     *  @param  label       The label number.
+     *  @param  weight      The feature weight.
+     */
+    void insert(const char* attribute, size_t length, int label, double weight)
+    {
+        m_inserted.push_back(m_attributes.insert(attribute, length));
+        m_labels.push_back(label);
+        m_weights.push_back(weight);
+    }
+
+    /**
+     * Arranges the features inserted into rows.
+     */
+    void finalize()
+    {
+        const int n = (int)m_inserted.size();
+        const int num_attributes = m_attributes.size();
+
+        // Arrange the features by a stable counting sort on attributes.
+        m_rows.assign(num_attributes + 1, 0);
+        for (int i = 0;i < n;++i) {
+            ++m_rows[m_inserted[i]+1];
+        }
+        for (int a = 0;a < num_attributes;++a) {
+            m_rows[a+1] += m_rows[a];
+        }
+
+        std::vector<int> next(m_rows.begin(), m_rows.end() - 1);
+        std::vector<int> labels(n);
+        std::vector<double> weights(n);
+        for (int i = 0;i < n;++i) {
+            int j = next[m_inserted[i]]++;
+            labels[j] = m_labels[i];
+            weights[j] = m_weights[i];
+        }
+
+        m_labels.swap(labels);
+        m_weights.swap(weights);
+        std::vector<int>().swap(m_inserted);
+    }
+
+    /**
+     * Returns the number of attributes.
+     *  @return int         The number of attributes.
+     */
+    inline int num_attributes() const
+    {
+        return m_attributes.size();
+    }
+
+    /**
+     * Finds the row of an attribute.
+     *  @param  name        The pointer to the attribute name.
+     *  @param  length      The length of the attribute name.
+     *  @return int         The attribute number, or -1 if the table does
+     *                      not have the attribute.
+     */
+    inline int find_attribute(const char* name, size_t length) const
+    {
+        return m_attributes.find(name, length);
+    }
+
+    /**
+     * Returns the first feature number in the row of an attribute.
+     *  @param  a           The attribute number.
+     *  @return int         The feature number.
+     */
+    inline int row_begin(int a) const
+    {
+        return m_rows[a];
+    }
+
+    /**
+     * Returns the feature number just beyond the row of an attribute.
+     *  @param  a           The attribute number.
+     *  @return int         The feature number.
+     */
+    inline int row_end(int a) const
+    {
+        return m_rows[a+1];
+    }
+
+    /**
+     * Returns the label number of a feature in a row.
+     *  @param  i           The feature number.
+     *  @return int         The label number.
+     */
+    inline int feature_label(int i) const
+    {
+        return m_labels[i];
+    }
+
+    /**
+     * Returns the weight of a feature in a row.
+     *  @param  i           The feature number.
+     *  @return double      The feature weight.
+     */
+    inline double weight(int i) const
+    {
+        return m_weights[i];
+    }
+
+    /**
+     * Adds the weights in the row of an attribute to the label scores.
+     *  @param  scores      The label scores, which implement
+     *                      add(int label, double value).
+     *  @param  a           The attribute number.
+     *  @param  value       The attribute value.
+     */
+    template <class scores_type>
+    inline void add_row(scores_type& scores, int a, double value) const
+    {
+        for (int i = m_rows[a];i < m_rows[a+1];++i) {
+            scores.add(m_labels[i], m_weights[i] * value);
+        }
+    }
+};
+
+#endif/*__WEIGHT_TABLE_H__*/
@@ -43,6 +43,9 @@
 #include <classias/train/averaged_perceptron.h>
 #include <classias/train/pegasos.h>
 #include <classias/train/truncated_gradient.h>
+#include <classias/train/saga.h>
+#include <classias/train/ftrl.h>
+#include <classias/train/adagrad.h>
 #include <classias/train/online_scheduler.h>
 
 #include "option.h"
@@ -179,7 +182,34 @@ finalize_data(
     const option& opt
     )
 {
-    // Nothing to do.
+    // Remove rare attributes if necessary.
+    if (1 < opt.min_count) {
+        int removed = classias::remove_rare_attributes(
+            data, opt.min_count, data.get_user_feature_start());
+        *opt.os << "Number of rare attributes removed: " << removed << std::endl;
+    }
+
+    // Renumber attributes by their frequencies if necessary.
+    if (opt.renumber) {
+        classias::renumber_attributes(data, data.get_user_feature_start());
+    }
+}
+
+template <
+    class trainer_type,
+    class data_type,
+    class instance_type
+>
+static void
+update_online(
+    trainer_type& trainer,
+    data_type& data,
+    const instance_type* inst,
+    const option& opt
+    )
+{
+    // Update the model with the instance.
+    trainer.update(inst);
 }
 
 template <
@@ -198,11 +228,30 @@ output_model(
     const attributes_quark_type& attributes = data.attributes;
     typedef typename model_type::value_type value_type;
 
+    const char *type = "@classias\tlinear\tbinary";
+
+    // Store the feature weights in the binary format.
+    if (opt.binary_model) {
+        classias::model_writer writer(type);
+        for (aid_type i = 0;i < attributes.size();++i) {
+            value_type w = model[i];
+            if (w != 0.) {
+                const std::string& attr = attributes.to_item(i);
+                if (attr == "__BIAS__") {
+                    w *= opt.bias;
+                }
+                writer.insert(attr, w);
+            }
+        }
+        writer.save(opt.model);
+        return;
+    }
+
     // Open a model file for writing.
     std::ofstream os(opt.model.c_str());
 
     // Output a model type.
-    os << "@classias\tlinear\tbinary" << std::endl;
+    os << type << std::endl;
 
     // Store the feature weights.
     for (aid_type i = 0;i < attributes.size();++i) {
@@ -217,61 +266,116 @@ output_model(
     }
 }
 
-int binary_train(option& opt)
+template <
+    class data_type,
+    class model_type
+>
+static int
+train_algorithm(option& opt)
 {
     // Branches for training algorithms.
     if (opt.algorithm == "lbfgs.logistic") {
         return train<
-            classias::bsdata,
-            classias::train::lbfgs_logistic_binary<classias::bsdata>
+            data_type,
+            classias::train::lbfgs_logistic_binary<data_type>
         >(opt);
     } else if (opt.algorithm == "averaged_perceptron") {
         return train<
-            classias::bsdata,
+            data_type,
             classias::train::online_scheduler_binary<
-                classias::bsdata,
+                data_type,
                 classias::train::averaged_perceptron_binary<
-                    classias::classify::linear_binary<classias::weight_vector>
+                    classias::classify::linear_binary<model_type>
                     >
                 >
             >(opt);
     } else if (opt.algorithm == "pegasos.logistic") {
         return train<
-            classias::bsdata,
+            data_type,
             classias::train::online_scheduler_binary<
-                classias::bsdata,
+                data_type,
                 classias::train::pegasos_binary<
-                    classias::classify::linear_binary_logistic<classias::weight_vector>
+                    classias::classify::linear_binary_logistic<model_type>
                     >
                 >
             >(opt);
     } else if (opt.algorithm == "pegasos.hinge") {
         return train<
-            classias::bsdata,
+            data_type,
             classias::train::online_scheduler_binary<
-                classias::bsdata,
+                data_type,
                 classias::train::pegasos_binary<
-                    classias::classify::linear_binary_hinge<classias::weight_vector>
+                    classias::classify::linear_binary_hinge<model_type>
                     >
                 >
             >(opt);
     } else if (opt.algorithm == "truncated_gradient.logistic") {
         return train<
-            classias::bsdata,
+            data_type,
             classias::train::online_scheduler_binary<
-                classias::bsdata,
+                data_type,
                 classias::train::truncated_gradient_binary<
-                    classias::classify::linear_binary_logistic<classias::weight_vector>
+                    classias::classify::linear_binary_logistic<model_type>
                     >
                 >
             >(opt);
     } else if (opt.algorithm == "truncated_gradient.hinge") {
         return train<
-            classias::bsdata,
+            data_type,
             classias::train::online_scheduler_binary<
-                classias::bsdata,
+                data_type,
                 classias::train::truncated_gradient_binary<
-                    classias::classify::linear_binary_hinge<classias::weight_vector>
+                    classias::classify::linear_binary_hinge<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "saga.logistic") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_binary<
+                data_type,
+                classias::train::saga_binary<
+                    classias::classify::linear_binary_logistic<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "ftrl.logistic") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_binary<
+                data_type,
+                classias::train::ftrl_binary<
+                    classias::classify::linear_binary_logistic<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "ftrl.hinge") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_binary<
+                data_type,
+                classias::train::ftrl_binary<
+                    classias::classify::linear_binary_hinge<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "adagrad.logistic") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_binary<
+                data_type,
+                classias::train::adagrad_binary<
+                    classias::classify::linear_binary_logistic<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "adagrad.hinge") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_binary<
+                data_type,
+                classias::train::adagrad_binary<
+                    classias::classify::linear_binary_hinge<model_type>
                     >
                 >
             >(opt);
@@ -279,3 +383,41 @@ int binary_train(option& opt)
         throw invalid_algorithm(opt.algorithm);
     }
 }
+
+int binary_train(option& opt)
+{
+    // Branches for the storage of instances and the precision of weights.
+    if (opt.online) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::bsdata, classias::paged_float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::bsdata, classias::paged_weight_vector>(opt);
+        }
+    } else if (!opt.shards.empty()) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::sharded_data<classias::bsdata>, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::sharded_data<classias::bsdata>, classias::weight_vector>(opt);
+        }
+    } else if (opt.compress) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::compressed_bsdata, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::compressed_bsdata, classias::weight_vector>(opt);
+        }
+    } else {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::bsdata, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::bsdata, classias::weight_vector>(opt);
+        }
+    }
+}
@@ -43,6 +43,9 @@
 #include <classias/train/averaged_perceptron.h>
 #include <classias/train/pegasos.h>
 #include <classias/train/truncated_gradient.h>
+#include <classias/train/saga.h>
+#include <classias/train/ftrl.h>
+#include <classias/train/adagrad.h>
 #include <classias/train/online_scheduler.h>
 
 #include "option.h"
@@ -215,6 +218,18 @@ finalize_data(
 {
     typedef int int_t;
 
+    // Remove rare attributes if necessary (keeping unregularized ones).
+    if (1 < opt.min_count) {
+        int removed = classias::remove_rare_attributes(
+            data, opt.min_count, data.get_user_feature_start());
+        *opt.os << "Number of rare attributes removed: " << removed << std::endl;
+    }
+
+    // Renumber attributes by their frequencies if necessary.
+    if (opt.renumber) {
+        classias::renumber_attributes(data, data.get_user_feature_start());
+    }
+
     // Set positive labels.
     for (int l = 0;l < data.num_labels();++l) {
         if (opt.negative_labels.find(data.labels.to_item(l)) == opt.negative_labels.end()) {
@@ -223,6 +238,23 @@ finalize_data(
     }
 }
 
+template <
+    class trainer_type,
+    class data_type,
+    class instance_type
+>
+static void
+update_online(
+    trainer_type& trainer,
+    data_type& data,
+    const instance_type* inst,
+    const option& opt
+    )
+{
+    // Update the model with the instance.
+    trainer.update(inst, data.feature_generator);
+}
+
 template <
     class data_type,
     class model_type
@@ -237,11 +269,26 @@ output_model(
     typedef int int_t;
     typedef typename model_type::value_type value_type;
 
+    const char *type = "@classias\tlinear\tcandidate";
+
+    // Store the feature weights in the binary format.
+    if (opt.binary_model) {
+        classias::model_writer writer(type);
+        for (int i = 0;i < (int)data.attributes.size();++i) {
+            value_type w = model[i];
+            if (w != 0.) {
+                writer.insert(data.attributes.to_item(i), w);
+            }
+        }
+        writer.save(opt.model);
+        return;
+    }
+
     // Open a model file for writing.
     std::ofstream os(opt.model.c_str());
 
     // Output a model type.
-    os << "@classias\tlinear\tcandidate" << std::endl;
+    os << type << std::endl;
 
     // Store the feature weights.
     for (int i = 0;i < (int)data.attributes.size();++i) {
@@ -254,41 +301,76 @@ output_model(
     }
 }
 
-int candidate_train(option& opt)
+template <
+    class data_type,
+    class model_type
+>
+static int
+train_algorithm(option& opt)
 {
     // Branches for training algorithms.
     if (opt.algorithm == "lbfgs.logistic") {
         return train<
-            classias::csdata,
-            classias::train::lbfgs_logistic_multi<classias::csdata>
+            data_type,
+            classias::train::lbfgs_logistic_multi<data_type>
         >(opt);
     } else if (opt.algorithm == "averaged_perceptron") {
         return train<
-            classias::csdata,
+            data_type,
             classias::train::online_scheduler_multi<
-                classias::csdata,
+                data_type,
                 classias::train::averaged_perceptron_multi<
-                    classias::classify::linear_multi<classias::weight_vector>
+                    classias::classify::linear_multi<model_type>
                     >
                 >
             >(opt);
     } else if (opt.algorithm == "pegasos.logistic") {
         return train<
-            classias::csdata,
+            data_type,
             classias::train::online_scheduler_multi<
-                classias::csdata,
+                data_type,
                 classias::train::pegasos_multi<
-                    classias::classify::linear_multi_logistic<classias::weight_vector>
+                    classias::classify::linear_multi_logistic<model_type>
                     >
                 >
             >(opt);
     } else if (opt.algorithm == "truncated_gradient.logistic") {
         return train<
-            classias::csdata,
+            data_type,
             classias::train::online_scheduler_multi<
-                classias::csdata,
+                data_type,
                 classias::train::truncated_gradient_multi<
-                    classias::classify::linear_multi_logistic<classias::weight_vector>
+                    classias::classify::linear_multi_logistic<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "saga.logistic") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_multi<
+                data_type,
+                classias::train::saga_multi<
+                    classias::classify::linear_multi_logistic<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "ftrl.logistic") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_multi<
+                data_type,
+                classias::train::ftrl_multi<
+                    classias::classify::linear_multi_logistic<model_type>
+                    >
+                >
+            >(opt);
+    } else if (opt.algorithm == "adagrad.logistic") {
+        return train<
+            data_type,
+            classias::train::online_scheduler_multi<
+                data_type,
+                classias::train::adagrad_multi<
+                    classias::classify::linear_multi_logistic<model_type>
                     >
                 >
             >(opt);
@@ -296,3 +378,41 @@ int candidate_train(option& opt)
 
     throw invalid_algorithm(opt.algorithm);
 }
+
+int candidate_train(option& opt)
+{
+    // Branches for the storage of instances and the precision of weights.
+    if (opt.online) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::csdata, classias::paged_float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::csdata, classias::paged_weight_vector>(opt);
+        }
+    } else if (!opt.shards.empty()) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::sharded_data<classias::csdata>, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::sharded_data<classias::csdata>, classias::weight_vector>(opt);
+        }
+    } else if (opt.compress) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::compressed_csdata, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::compressed_csdata, classias::weight_vector>(opt);
+        }
+    } else {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::csdata, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::csdata, classias::weight_vector>(opt);
+        }
+    }
+}
@@ -40,6 +40,7 @@
 #include <map>
 #include <string>
 #include <typeinfo>
+#include <classias/allocator.h>
 #include <classias/version.h>
 #include <optparse.h>
 #include <tokenize.h>
@@ -76,6 +77,13 @@ public:
         m_algorithms["truncated_gradient.hinge"]    = "truncated_gradient.hinge";
         m_algorithms["tg.hinge"]                    = "truncated_gradient.hinge";
         m_algorithms["tg.svm"]                      = "truncated_gradient.hinge";
+        m_algorithms["saga.logistic"]               = "saga.logistic";
+        m_algorithms["ftrl.logistic"]               = "ftrl.logistic";
+        m_algorithms["ftrl.hinge"]                  = "ftrl.hinge";
+        m_algorithms["ftrl.svm"]                    = "ftrl.hinge";
+        m_algorithms["adagrad.logistic"]            = "adagrad.logistic";
+        m_algorithms["adagrad.hinge"]               = "adagrad.hinge";
+        m_algorithms["adagrad.svm"]                 = "adagrad.hinge";
     }
 
     BEGIN_OPTION_MAP_INLINE()
@@ -104,6 +112,57 @@ public:
                 throw invalid_value(ss.str());
             }
 
+        ON_OPTION_WITH_ARG(SHORTOPT('P') || LONGOPT("precision"))
+            if (strcmp(arg, "double") == 0 || strcmp(arg, "d") == 0) {
+                precision = PRECISION_DOUBLE;
+            } else if (strcmp(arg, "single") == 0 || strcmp(arg, "s") == 0) {
+                precision = PRECISION_SINGLE;
+            } else {
+                std::stringstream ss;
+                ss << "unknown precision specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(LONGOPT("huge-pages"))
+            if (strcmp(arg, "none") == 0) {
+                pages = PAGES_NONE;
+            } else if (strcmp(arg, "transparent") == 0) {
+                pages = PAGES_TRANSPARENT;
+            } else if (strcmp(arg, "2mb") == 0) {
+                pages = PAGES_2MB;
+            } else if (strcmp(arg, "1gb") == 0) {
+                pages = PAGES_1GB;
+            } else {
+                std::stringstream ss;
+                ss << "unknown page policy specified: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(LONGOPT("compress"))
+            compress = true;
+
+        ON_OPTION(LONGOPT("online"))
+            online = true;
+
+        ON_OPTION_WITH_ARG(LONGOPT("online-size"))
+            online_size = atoi(arg);
+            if (online_size < 1) {
+                std::stringstream ss;
+                ss << "the number of instances must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION_WITH_ARG(LONGOPT("shards"))
+            shards = arg;
+
+        ON_OPTION_WITH_ARG(LONGOPT("shard-size"))
+            shard_size = atoi(arg);
+            if (shard_size < 1) {
+                std::stringstream ss;
+                ss << "the shard size must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
         ON_OPTION_WITH_ARG(SHORTOPT('p') || LONGOPT("set"))
             params.push_back(arg);
 
@@ -116,6 +175,9 @@ public:
         ON_OPTION_WITH_ARG(SHORTOPT('m') || LONGOPT("model"))
             model = arg;
 
+        ON_OPTION(LONGOPT("binary-model"))
+            binary_model = true;
+
         ON_OPTION_WITH_ARG(SHORTOPT('g') || LONGOPT("split"))
             split = atoi(arg);
 
@@ -125,6 +187,20 @@ public:
         ON_OPTION(SHORTOPT('x') || LONGOPT("cross-validate"))
             cross_validation = true;
 
+        ON_OPTION_WITH_ARG(LONGOPT("min-count"))
+            min_count = atoi(arg);
+            if (min_count < 1) {
+                std::stringstream ss;
+                ss << "the minimum count must be a positive integer: " << arg;
+                throw invalid_value(ss.str());
+            }
+
+        ON_OPTION(LONGOPT("renumber"))
+            renumber = true;
+
+        ON_OPTION(LONGOPT("canonicalize"))
+            canonicalize = true;
+
 #if defined(HAVE_REGEX) || defined(HAVE_BOOST_REGEX_HPP)
         ON_OPTION_WITH_ARG(SHORTOPT('F') || LONGOPT("filter"))
             filter = arg;
@@ -212,6 +288,56 @@ static void usage(std::ostream& os, const char *argv0)
     os << "                            L1-regularized LR by Truncated Gradient" << std::endl;
     os << "      truncated_gradient.hinge" << std::endl;
     os << "                            L1-regularized L1-loss SVM by Truncated Gradient" << std::endl;
+    os << "      saga.logistic         L2-regularized LR by SAGA" << std::endl;
+    os << "      ftrl.logistic         L1/L2-regularized LR by FTRL-Proximal" << std::endl;
+    os << "      ftrl.hinge            L1/L2-regularized L1-loss SVM by FTRL-Proximal" << std::endl;
+    os << "      adagrad.logistic      L1-regularized LR by AdaGrad" << std::endl;
+    os << "      adagrad.hinge         L1-regularized L1-loss SVM by AdaGrad" << std::endl;
+    os << "  -P, --precision=TYPE  specify the precision of feature weights (DEFAULT='double'):" << std::endl;
+    os << "      d, double             store feature weights in double precision" << std::endl;
+    os << "      s, single             store feature weights (and auxiliary arrays of online" << std::endl;
+    os << "                            algorithms) in single precision to halve the memory;" << std::endl;
+    os << "                            scores, losses, and updates are still computed in" << std::endl;
+    os << "                            double precision; feature weights differ from those" << std::endl;
+    os << "                            of 'double' by less than 1e-4 times the largest" << std::endl;
+    os << "                            absolute weight (a little more for the frequent" << std::endl;
+    os << "                            features with AdaGrad; L-BFGS always uses double" << std::endl;
+    os << "                            precision)" << std::endl;
+    os << "  --huge-pages=POLICY   specify the pages backing feature weights" << std::endl;
+    os << "                        (DEFAULT='transparent'):" << std::endl;
+    os << "      none                  regular pages" << std::endl;
+    os << "      transparent           transparent huge pages (madvise) for large vectors" << std::endl;
+    os << "      2mb                   explicit 2MB huge pages reserved in advance (e.g.," << std::endl;
+    os << "                            /proc/sys/vm/nr_hugepages)" << std::endl;
+    os << "      1gb                   explicit 1GB huge pages for vectors of 1GB or larger" << std::endl;
+    os << "                            (and 2MB pages otherwise); an unavailable page size" << std::endl;
+    os << "                            falls back to a smaller one" << std::endl;
+    os << "  --compress            store the attributes of instances compressed (as delta-" << std::endl;
+    os << "                        encoded variable-length integers, omitting values of 1)" << std::endl;
+    os << "                        and decode them on the fly; this reduces the memory for" << std::endl;
+    os << "                        a data set, more so with '--renumber'" << std::endl;
+    os << "  --online              train on the instances as they are read (e.g., from a" << std::endl;
+    os << "                        pipe) without storing them: a reader thread parses the" << std::endl;
+    os << "                        data into a ring buffer, from which the training" << std::endl;
+    os << "                        algorithm updates the model in a single pass; the model" << std::endl;
+    os << "                        and attributes grow as they appear; multi-dense is" << std::endl;
+    os << "                        trained as multi-sparse; the same restrictions as" << std::endl;
+    os << "                        '--shards' apply (and '-g', '-e')" << std::endl;
+    os << "  --online-size=N       assume N instances in the data stream of '--online'; the" << std::endl;
+    os << "                        regularization coefficient c is divided by N as in" << std::endl;
+    os << "                        training on the data in memory, but is applied as is" << std::endl;
+    os << "                        (i.e., as if the data had a single instance) unless N" << std::endl;
+    os << "                        (or '-p n=N') is given" << std::endl;
+    os << "  --shards=DIR          train out of core: spill the instances to shard files" << std::endl;
+    os << "                        in the directory DIR while reading the data, and read" << std::endl;
+    os << "                        the shards back (ahead, in a background thread) in" << std::endl;
+    os << "                        every iteration; the sampling method 'shuffle' shuffles" << std::endl;
+    os << "                        the shards and the instances in every shard; holdout" << std::endl;
+    os << "                        instances stay in memory; available for the online" << std::endl;
+    os << "                        training algorithms except for 'saga.logistic', and" << std::endl;
+    os << "                        unavailable with '-x', '-f', '--compress'," << std::endl;
+    os << "                        '--min-count', '--renumber', and '--canonicalize'" << std::endl;
+    os << "  --shard-size=N        store at most N instances in a shard (DEFAULT=100000)" << std::endl;
     os << "  -p, --set=NAME=VALUE  set the algorithm-specific parameter NAME to VALUE;" << std::endl;
     os << "                        use '-H' or '--help-parameters' with the algorithm name" << std::endl;
     os << "                        specified by '-a' or '--algorithm' and the task type" << std::endl;
@@ -221,12 +347,30 @@ static void usage(std::ostream& os, const char *argv0)
     os << "  -b, --bias=VALUE      insert bias features with their values VALUE" << std::endl;
     os << "  -m, --model=FILE      store the model to FILE (DEFAULT=''); if the value is" << std::endl;
     os << "                        empty, this utility does not store the model" << std::endl;
+    os << "  --binary-model        store the model in the binary format, which the tagger" << std::endl;
+    os << "                        maps into memory without parsing (and shares among" << std::endl;
+    os << "                        processes) instead of reading the text format" << std::endl;
     os << "  -g, --split=N         split the instances into N groups; this option is" << std::endl;
     os << "                        useful for holdout evaluation and cross validation" << std::endl;
     os << "  -e, --holdout=M       use the M-th data for holdout evaluation and the rest" << std::endl;
     os << "                        for training" << std::endl;
     os << "  -x, --cross-validate  repeat holdout evaluations for #i in {1, ..., N}" << std::endl;
     os << "                        (N-fold cross validation)" << std::endl;
+    os << "  --min-count=N         remove attributes occurring less than N times in the" << std::endl;
+    os << "                        data (and, for multi-sparse, attribute-label pairs" << std::endl;
+    os << "                        occurring less than N times) before training" << std::endl;
+    os << "  --renumber            renumber attributes in descending order of their" << std::endl;
+    os << "                        frequencies and sort the attributes of every instance," << std::endl;
+    os << "                        which improves the memory locality of weight accesses" << std::endl;
+    os << "  --canonicalize        sum the values of duplicate attributes in an instance," << std::endl;
+    os << "                        and merge identical instances (with the same label," << std::endl;
+    os << "                        group, and attributes) into one instance weighted by" << std::endl;
+    os << "                        the sum of their weights; holdout evaluations count" << std::endl;
+    os << "                        a merged instance only once; the online training" << std::endl;
+    os << "                        algorithms divide the regularization coefficient c by" << std::endl;
+    os << "                        the number of instances after merging, which keeps" << std::endl;
+    os << "                        the balance of the loss and regularization (use the" << std::endl;
+    os << "                        same c as without '--canonicalize')" << std::endl;
     os << "  -l, --log-to-file     write the training log to a file instead of to STDOUT;" << std::endl;
     os << "                        The filename is determined automatically by the training" << std::endl;
     os << "                        algorithm, parameters, and source files" << std::endl;
@@ -296,6 +440,40 @@ int main(int argc, char *argv[])
         opt.files.push_back(argv[i]);
     }
 
+    // Check the options for out-of-core and online training, which never
+    // store the whole data set in memory.
+    if (!opt.shards.empty() || opt.online) {
+        const char *conflict = NULL;
+        if (opt.algorithm == "lbfgs.logistic" || opt.algorithm == "saga.logistic") {
+            conflict = opt.algorithm.c_str();
+        } else if (opt.cross_validation) {
+            conflict = "--cross-validate";
+        } else if (opt.shuffle) {
+            conflict = "--shuffle";
+        } else if (opt.compress) {
+            conflict = "--compress";
+        } else if (1 < opt.min_count) {
+            conflict = "--min-count";
+        } else if (opt.renumber) {
+            conflict = "--renumber";
+        } else if (opt.canonicalize) {
+            conflict = "--canonicalize";
+        } else if (opt.online && !opt.shards.empty()) {
+            conflict = "--shards";
+        } else if (opt.online && (0 < opt.split || 0 < opt.holdout)) {
+            conflict = "holdout evaluation";
+        }
+        if (conflict != NULL) {
+            es << "ERROR: " << conflict << " is unavailable for ";
+            if (opt.online) {
+                es << "online training (--online)" << std::endl;
+            } else {
+                es << "out-of-core training (--shards)" << std::endl;
+            }
+            return 1;
+        }
+    }
+
     // Open a log file if necessary.
     if (opt.logfile) {
         // Generate a filename for the log file.
@@ -324,6 +502,22 @@ int main(int argc, char *argv[])
         opt.os = &ofs;
     }
 
+    // Set the pages backing feature weights.
+    switch (opt.pages) {
+    case option::PAGES_NONE:
+        classias::huge_pages::policy() = classias::huge_pages::NONE;
+        break;
+    case option::PAGES_TRANSPARENT:
+        classias::huge_pages::policy() = classias::huge_pages::TRANSPARENT;
+        break;
+    case option::PAGES_2MB:
+        classias::huge_pages::policy() = classias::huge_pages::EXPLICIT_2MB;
+        break;
+    case option::PAGES_1GB:
+        classias::huge_pages::policy() = classias::huge_pages::EXPLICIT_1GB;
+        break;
+    }
+
     // Branch for tasks.
     try {
         switch (opt.type) {
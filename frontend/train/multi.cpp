@@ -43,6 +43,9 @@
 #include <classias/train/averaged_perceptron.h>
 #include <classias/train/pegasos.h>
 #include <classias/train/truncated_gradient.h>
+#include <classias/train/saga.h>
+#include <classias/train/ftrl.h>
+#include <classias/train/adagrad.h>
 #include <classias/train/online_scheduler.h>
 
 #include "option.h"
@@ -176,6 +179,18 @@ finalize_data(
 {
     typedef int int_t;
 
+    // Remove rare attributes if necessary (keeping the bias attribute #0).
+    if (1 < opt.min_count) {
+        int removed = classias::remove_rare_attributes(
+            data, opt.min_count, (opt.bias != 0. ? 1 : 0));
+        *opt.os << "Number of rare attributes removed: " << removed << std::endl;
+    }
+
+    // Renumber attributes by their frequencies if necessary.
+    if (opt.renumber) {
+        classias::renumber_attributes(data, (opt.bias != 0. ? 1 : 0));
+    }
+
     // If necessary, reserve early feature numbers for bias features.
     if (opt.bias != 0.) {
         int_t aid = (int_t)data.attributes("__BIAS__");
@@ -186,7 +201,10 @@ finalize_data(
     }
 
     // Generate features that associate attributes and labels.
-    data.generate_features();
+    int removed = data.generate_features(opt.min_count);
+    if (opt.type == option::TYPE_MULTI_SPARSE && 1 < opt.min_count) {
+        *opt.os << "Number of rare features removed: " << removed << std::endl;
+    }
 
     // Set positive labels.
     for (int_t l = 0;l < data.num_labels();++l) {
@@ -196,6 +214,40 @@ finalize_data(
     }
 }
 
+template <
+    class trainer_type,
+    class data_type,
+    class instance_type
+>
+static void
+update_online(
+    trainer_type& trainer,
+    data_type& data,
+    const instance_type* inst,
+    const option& opt
+    )
+{
+    typedef typename data_type::feature_generator_type feature_generator_type;
+    feature_generator_type& fgen = data.feature_generator;
+
+    // Extend the set of labels with the label of the instance. Note that
+    // the training thread must not access the label quark, which grows in
+    // the reader thread.
+    const int l = inst->get_label();
+    if ((int)fgen.num_labels() <= l) {
+        fgen.set_num_labels(l+1);
+    }
+
+    // Register the features for the attributes and label of the instance.
+    typename instance_type::const_iterator it;
+    for (it = inst->begin();it != inst->end();++it) {
+        fgen.regist(it->first, l);
+    }
+
+    // Update the model with the instance.
+    trainer.update(inst, fgen);
+}
+
 template <
     class data_type,
     class model_type
@@ -214,12 +266,37 @@ output_model(
     typedef typename labels_quark_type::item_type label_type;
     typedef typename model_type::value_type value_type;
 
+    const std::string type =
+        std::string("@classias\tlinear\tmulti\t") + data.feature_generator.name();
+
+    // Store the labels and feature weights (in rows of attributes) in the
+    // binary format.
+    if (opt.binary_model) {
+        classias::model_writer writer(type);
+        for (int_t l = 0;l < data.num_labels();++l) {
+            writer.add_label(data.labels.to_item(l));
+        }
+        for (int_t i = 0;i < data.num_features();++i) {
+            value_type w = model[i];
+            if (w != 0.) {
+                int_t a, l;
+                data.feature_generator.backward(i, a, l);
+                const std::string& attr = data.attributes.to_item(a);
+                if (attr == "__BIAS__") {
+                    w *= opt.bias;
+                }
+                writer.insert(attr, l, w);
+            }
+        }
+        writer.save(opt.model);
+        return;
+    }
+
     // Open a model file for writing.
     std::ofstream os(opt.model.c_str());
 
     // Output a model type.
-    os << "@classias\tlinear\tmulti\t";
-    os << data.feature_generator.name() << std::endl;
+    os << type << std::endl;
 
     // Output a set of labels.
     for (int_t l = 0;l < data.num_labels();++l) {
@@ -242,39 +319,45 @@ output_model(
     }
 }
 
-int multi_train(option& opt)
+template <
+    class msdata_type,
+    class nsdata_type,
+    class model_type
+>
+static int
+train_algorithm(option& opt)
 {
     // Branches for training algorithms.
     if (opt.algorithm == "lbfgs.logistic") {
         if (opt.type == option::TYPE_MULTI_SPARSE) {
             return train<
-                classias::nsdata,
-                classias::train::lbfgs_logistic_multi<classias::nsdata>
+                nsdata_type,
+                classias::train::lbfgs_logistic_multi<nsdata_type>
             >(opt);
         } else if (opt.type == option::TYPE_MULTI_DENSE) {
             return train<
-                classias::msdata,
-                classias::train::lbfgs_logistic_multi<classias::msdata>
+                msdata_type,
+                classias::train::lbfgs_logistic_multi<msdata_type>
             >(opt);
         }
     } else if (opt.algorithm == "averaged_perceptron") {
         if (opt.type == option::TYPE_MULTI_SPARSE) {
             return train<
-                classias::nsdata,
+                nsdata_type,
                 classias::train::online_scheduler_multi<
-                    classias::nsdata,
+                    nsdata_type,
                     classias::train::averaged_perceptron_multi<
-                        classias::classify::linear_multi<classias::weight_vector>
+                        classias::classify::linear_multi<model_type>
                         >
                     >
                 >(opt);
         } else if (opt.type == option::TYPE_MULTI_DENSE) {
             return train<
-                classias::msdata,
+                msdata_type,
                 classias::train::online_scheduler_multi<
-                    classias::msdata,
+                    msdata_type,
                     classias::train::averaged_perceptron_multi<
-                        classias::classify::linear_multi<classias::weight_vector>
+                        classias::classify::linear_multi<model_type>
                         >
                     >
                 >(opt);
@@ -282,21 +365,21 @@ int multi_train(option& opt)
     } else if (opt.algorithm == "pegasos.logistic") {
         if (opt.type == option::TYPE_MULTI_SPARSE) {
             return train<
-                classias::nsdata,
+                nsdata_type,
                 classias::train::online_scheduler_multi<
-                    classias::nsdata,
+                    nsdata_type,
                     classias::train::pegasos_multi<
-                        classias::classify::linear_multi_logistic<classias::weight_vector>
+                        classias::classify::linear_multi_logistic<model_type>
                         >
                     >
                 >(opt);
         } else if (opt.type == option::TYPE_MULTI_DENSE) {
             return train<
-                classias::msdata,
+                msdata_type,
                 classias::train::online_scheduler_multi<
-                    classias::msdata,
+                    msdata_type,
                     classias::train::pegasos_multi<
-                        classias::classify::linear_multi_logistic<classias::weight_vector>
+                        classias::classify::linear_multi_logistic<model_type>
                         >
                     >
                 >(opt);
@@ -304,21 +387,87 @@ int multi_train(option& opt)
     } else if (opt.algorithm == "truncated_gradient.logistic") {
         if (opt.type == option::TYPE_MULTI_SPARSE) {
             return train<
-                classias::nsdata,
+                nsdata_type,
                 classias::train::online_scheduler_multi<
-                    classias::nsdata,
+                    nsdata_type,
                     classias::train::truncated_gradient_multi<
-                        classias::classify::linear_multi_logistic<classias::weight_vector>
+                        classias::classify::linear_multi_logistic<model_type>
                         >
                     >
                 >(opt);
         } else if (opt.type == option::TYPE_MULTI_DENSE) {
             return train<
-                classias::msdata,
+                msdata_type,
                 classias::train::online_scheduler_multi<
-                    classias::msdata,
+                    msdata_type,
                     classias::train::truncated_gradient_multi<
-                        classias::classify::linear_multi_logistic<classias::weight_vector>
+                        classias::classify::linear_multi_logistic<model_type>
+                        >
+                    >
+                >(opt);
+        }
+    } else if (opt.algorithm == "saga.logistic") {
+        if (opt.type == option::TYPE_MULTI_SPARSE) {
+            return train<
+                nsdata_type,
+                classias::train::online_scheduler_multi<
+                    nsdata_type,
+                    classias::train::saga_multi<
+                        classias::classify::linear_multi_logistic<model_type>
+                        >
+                    >
+                >(opt);
+        } else if (opt.type == option::TYPE_MULTI_DENSE) {
+            return train<
+                msdata_type,
+                classias::train::online_scheduler_multi<
+                    msdata_type,
+                    classias::train::saga_multi<
+                        classias::classify::linear_multi_logistic<model_type>
+                        >
+                    >
+                >(opt);
+        }
+    } else if (opt.algorithm == "ftrl.logistic") {
+        if (opt.type == option::TYPE_MULTI_SPARSE) {
+            return train<
+                nsdata_type,
+                classias::train::online_scheduler_multi<
+                    nsdata_type,
+                    classias::train::ftrl_multi<
+                        classias::classify::linear_multi_logistic<model_type>
+                        >
+                    >
+                >(opt);
+        } else if (opt.type == option::TYPE_MULTI_DENSE) {
+            return train<
+                msdata_type,
+                classias::train::online_scheduler_multi<
+                    msdata_type,
+                    classias::train::ftrl_multi<
+                        classias::classify::linear_multi_logistic<model_type>
+                        >
+                    >
+                >(opt);
+        }
+    } else if (opt.algorithm == "adagrad.logistic") {
+        if (opt.type == option::TYPE_MULTI_SPARSE) {
+            return train<
+                nsdata_type,
+                classias::train::online_scheduler_multi<
+                    nsdata_type,
+                    classias::train::adagrad_multi<
+                        classias::classify::linear_multi_logistic<model_type>
+                        >
+                    >
+                >(opt);
+        } else if (opt.type == option::TYPE_MULTI_DENSE) {
+            return train<
+                msdata_type,
+                classias::train::online_scheduler_multi<
+                    msdata_type,
+                    classias::train::adagrad_multi<
+                        classias::classify::linear_multi_logistic<model_type>
                         >
                     >
                 >(opt);
@@ -326,3 +475,43 @@ int multi_train(option& opt)
     }
     throw invalid_algorithm(opt.algorithm);
 }
+
+int multi_train(option& opt)
+{
+    // Branches for the storage of instances and the precision of weights.
+    if (opt.online) {
+        // Labels appear during online training, which requires the sparse
+        // feature generator for both multi-sparse and multi-dense.
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::nsdata, classias::nsdata, classias::paged_float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::nsdata, classias::nsdata, classias::paged_weight_vector>(opt);
+        }
+    } else if (!opt.shards.empty()) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::sharded_data<classias::msdata>, classias::sharded_data<classias::nsdata>, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::sharded_data<classias::msdata>, classias::sharded_data<classias::nsdata>, classias::weight_vector>(opt);
+        }
+    } else if (opt.compress) {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::compressed_msdata, classias::compressed_nsdata, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::compressed_msdata, classias::compressed_nsdata, classias::weight_vector>(opt);
+        }
+    } else {
+        if (opt.precision == option::PRECISION_SINGLE) {
+            return train_algorithm<
+                classias::msdata, classias::nsdata, classias::float_weight_vector>(opt);
+        } else {
+            return train_algorithm<
+                classias::msdata, classias::nsdata, classias::weight_vector>(opt);
+        }
+    }
+}
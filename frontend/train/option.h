@@ -86,6 +86,18 @@ public:
         TYPE_CANDIDATE,     /// Multi-candidate ranker.
     };
 
+    enum {
+        PRECISION_DOUBLE = 0,   /// Double-precision feature weights.
+        PRECISION_SINGLE,       /// Single-precision feature weights.
+    };
+
+    enum {
+        PAGES_NONE = 0,         /// Regular pages.
+        PAGES_TRANSPARENT,      /// Transparent huge pages.
+        PAGES_2MB,              /// Explicit 2MB huge pages.
+        PAGES_1GB,              /// Explicit 1GB huge pages.
+    };
+
     std::istream*   is;
     std::ostream*   os;
     std::ostream*   es;
@@ -94,13 +106,24 @@ public:
 
     int         mode;
     int         type;
+    int         precision;
+    int         pages;
+    bool        compress;
+    bool        online;
+    int         online_size;
+    std::string shards;
+    int         shard_size;
     std::string algorithm;
     params_type params;
     std::string model;
+    bool        binary_model;
     bool        shuffle;
     double      bias;
     int         split;
     int         holdout;
+    int         min_count;
+    bool        renumber;
+    bool        canonicalize;
     REGEX       filter;
     std::string filter_string;
     bool        cross_validation;
@@ -117,10 +140,13 @@ public:
         std::ostream* _es = &std::cerr
         ) :
         is(_is), os(_os), es(_es),
-        mode(MODE_NORMAL), type(TYPE_MULTI_DENSE), model(""),
+        mode(MODE_NORMAL), type(TYPE_MULTI_DENSE), precision(PRECISION_DOUBLE),
+        pages(PAGES_TRANSPARENT), compress(false), online(false), online_size(0), shards(""), shard_size(100000),
+        model(""), binary_model(false),
         algorithm("lbfgs.logistic"),        
         shuffle(false), bias(1.),
-        split(0), holdout(-1), cross_validation(false),
+        split(0), holdout(-1), min_count(1), renumber(false), canonicalize(false),
+        cross_validation(false),
         logfile(false), logbase(""),
         token_separator(' '), value_separator(':')
     {
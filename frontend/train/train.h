@@ -168,6 +168,17 @@ read_dataset(
     // Finalize the data.
     finalize_data(data, opt);
 
+    // Merge duplicate attributes and instances if necessary.
+    if (opt.canonicalize) {
+        size_t merged = data.canonicalize();
+        *opt.os << "Number of duplicate instances merged: " << merged << std::endl;
+    }
+
+    // Release the memory reserved for compressed instances while reading.
+    if (opt.compress) {
+        data.shrink();
+    }
+
     // Shuffle instances if necessary.
     if (opt.shuffle) {
         std::random_shuffle(data.begin(), data.end());
@@ -182,6 +193,189 @@ read_dataset(
     }
 }
 
+template <class data_type>
+static int
+read_dataset(
+    classias::sharded_data<data_type>& data,
+    const option& opt
+    )
+{
+    // Spill the training instances to shards while reading the data.
+    data.set_storage(opt.shards, opt.shard_size);
+    data.set_split(opt.split);
+    data.set_holdout(0 < opt.holdout ? (opt.holdout-1) : -1);
+    read_data(data, opt);
+    data.flush();
+    *opt.os << "Number of shards: " << data.num_shards() << std::endl;
+
+    // Finalize the data.
+    finalize_data(data, opt);
+
+    if (0 < opt.split) {
+        return opt.split;
+    } else {
+        return (int)opt.files.size();
+    }
+}
+
+template <class data_type>
+class stream_reader
+{
+protected:
+    classias::streaming_data<data_type>& m_data;
+    const option& m_opt;
+    bool m_failed;
+    std::string m_message;
+    classias::thread m_thread;
+
+public:
+    stream_reader(classias::streaming_data<data_type>& data, const option& opt)
+        : m_data(data), m_opt(opt), m_failed(false)
+    {
+    }
+
+    virtual ~stream_reader()
+    {
+        m_data.cancel();
+        m_thread.join();
+    }
+
+    void start()
+    {
+        if (!m_thread.start(__read, this)) {
+            throw std::runtime_error("Failed to start a reader thread");
+        }
+    }
+
+    void join()
+    {
+        m_thread.join();
+        if (m_failed) {
+            throw invalid_data(m_message);
+        }
+    }
+
+protected:
+    static void __read(void *arg)
+    {
+        stream_reader* pt = reinterpret_cast<stream_reader*>(arg);
+        try {
+            read_data(pt->m_data, pt->m_opt);
+        } catch (const std::exception& e) {
+            pt->m_failed = true;
+            pt->m_message = e.what();
+        }
+        pt->m_data.close();
+    }
+};
+
+template <
+    class data_type,
+    class trainer_type
+>
+static int
+train_stream(option& opt)
+{
+    stopwatch sw;
+    classias::streaming_data<data_type> data;
+    std::ostream& os = *opt.os;
+
+    // Set training parameters.
+    trainer_type trainer;
+    set_parameters(trainer, data, opt);
+
+    // The regularization (c / n) needs the number of instances, which is
+    // unknown until the end of the stream.
+    if (0 < opt.online_size) {
+        trainer.params().set("n", (double)opt.online_size, false);
+    } else if (trainer.params().get_stamp("n") <= 0) {
+        *opt.es << "WARNING: the number of instances is not given (--online-size)," << std::endl;
+        *opt.es << "  so the regularization coefficient c is not divided by it" << std::endl;
+    }
+
+    // Show the algorithm name and parameters.
+    trainer.copyright(os);
+    trainer.params().show(os);
+    os << std::endl;
+
+    // Train the model on the instances while a reader thread parses them.
+    os << "Training on the data stream from " << opt.files.size() << " files" << std::endl;
+    sw.start();
+    trainer.start();
+    {
+        stream_reader<data_type> reader(data, opt);
+        reader.start();
+
+        const typename data_type::instance_type* inst = NULL;
+        while ((inst = data.front()) != NULL) {
+            update_online(trainer, data, inst, opt);
+            data.pop();
+        }
+        reader.join();
+    }
+    trainer.discontinue();
+    sw.stop();
+    os << "Number of instances: " << data.size() << std::endl;
+    os << "Number of attributes: " << data.num_attributes() << std::endl;
+    os << "Number of labels: " << data.num_labels() << std::endl;
+    trainer.report(os);
+    os << "Seconds required: " << sw.get() << std::endl;
+    os << std::endl;
+
+    // Finalize the training procedure.
+    trainer.finish();
+
+    // Store the model.
+    if (!opt.model.empty()) {
+        output_model(data, trainer.model(), opt);
+    }
+
+	// Report the finish time.
+    os << "Finish time: " << timestamp << std::endl;
+    os << std::endl;
+
+    return 0;
+}
+
+template <
+    class data_type,
+    class trainer_type
+>
+static int
+train_online(option& opt, const trainer_type*)
+{
+    // Batch training algorithms need the whole data set.
+    throw invalid_algorithm(opt.algorithm);
+}
+
+template <
+    class data_type,
+    class scheduler_data_type,
+    class trainer_type
+>
+static int
+train_online(
+    option& opt,
+    const classias::train::online_scheduler_binary<scheduler_data_type, trainer_type>*
+    )
+{
+    return train_stream<data_type, trainer_type>(opt);
+}
+
+template <
+    class data_type,
+    class scheduler_data_type,
+    class trainer_type
+>
+static int
+train_online(
+    option& opt,
+    const classias::train::online_scheduler_multi<scheduler_data_type, trainer_type>*
+    )
+{
+    return train_stream<data_type, trainer_type>(opt);
+}
+
 template <
     class data_type,
     class trainer_type
@@ -211,16 +405,44 @@ train(option& opt)
     }
     os << std::endl;
     os << "Training algorithm: " << opt.algorithm << std::endl;
+    os << "Weight precision: ";
+    switch (opt.precision) {
+    case option::PRECISION_DOUBLE:  os << "double";         break;
+    case option::PRECISION_SINGLE:  os << "single";         break;
+    }
+    os << std::endl;
+    os << "Compressed instances: " << std::boolalpha << opt.compress << std::endl;
+    os << "Online training: " << std::boolalpha << opt.online << std::endl;
+    os << "Online data size: " << opt.online_size << std::endl;
+    os << "Out-of-core shards: " << opt.shards << std::endl;
+    os << "Shard size: " << opt.shard_size << std::endl;
+    os << "Huge pages: ";
+    switch (opt.pages) {
+    case option::PAGES_NONE:        os << "none";           break;
+    case option::PAGES_TRANSPARENT: os << "transparent";    break;
+    case option::PAGES_2MB:         os << "2mb";            break;
+    case option::PAGES_1GB:         os << "1gb";            break;
+    }
+    os << std::endl;
     os << "Instance shuffle: " << std::boolalpha << opt.shuffle << std::endl;
     os << "Bias feature value: " << opt.bias << std::endl;
     os << "Model file: " << opt.model << std::endl;
+    os << "Binary model: " << std::boolalpha << opt.binary_model << std::endl;
     os << "Instance splitting: " << opt.split << std::endl;
     os << "Holdout group: " << opt.holdout << std::endl;
     os << "Cross validation: " << std::boolalpha << opt.cross_validation << std::endl;
     os << "Attribute filter: " << opt.filter_string << std::endl;
+    os << "Minimum attribute count: " << opt.min_count << std::endl;
+    os << "Attribute renumbering: " << std::boolalpha << opt.renumber << std::endl;
+    os << "Data canonicalization: " << std::boolalpha << opt.canonicalize << std::endl;
     os << "Start time: " << timestamp << std::endl;
     os << std::endl;
 
+    // Train the model while reading the data if necessary.
+    if (opt.online) {
+        return train_online<data_type>(opt, (const trainer_type*)NULL);
+    }
+
     // Read the source data.
     os << "Reading the data set from " << opt.files.size() << " files" << std::endl;
     sw.start();
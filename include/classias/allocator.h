@@ -0,0 +1,329 @@
+/*
+ *		Memory allocator for weight vectors.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_ALLOCATOR_H__
+#define __CLASSIAS_ALLOCATOR_H__
+
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#ifdef  _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif/*_WIN32*/
+
+namespace classias
+{
+
+/**
+ * Allocation of memory blocks backed by huge pages.
+ *
+ *  Training algorithms access weight vectors randomly through sparse
+ *  feature identifiers, which causes a TLB miss on almost every access to
+ *  a large weight vector with regular (4KB) pages. This class allocates
+ *  memory blocks aligned to 64-byte (cache line) boundaries, and backs
+ *  large blocks (no smaller than 2MB) with huge pages according to the
+ *  policy:
+ *      - NONE: regular pages.
+ *      - TRANSPARENT: advise the kernel to use transparent huge pages
+ *        (madvise(MADV_HUGEPAGE)) for blocks aligned to 2MB boundaries.
+ *        This is the default policy.
+ *      - EXPLICIT_2MB: map explicit 2MB huge pages (MAP_HUGETLB), which
+ *        must be reserved by the system administrator in advance.
+ *      - EXPLICIT_1GB: map explicit 1GB huge pages for blocks no smaller
+ *        than 1GB, and explicit 2MB huge pages for the other large blocks.
+ *
+ *  An allocation falls back gracefully from 1GB pages to 2MB pages, then
+ *  to transparent huge pages, and then to regular pages when huge pages
+ *  are unavailable (e.g., on platforms other than Linux, or when no huge
+ *  page is reserved). The policy is a process-wide setting; change it
+ *  before allocating weight vectors.
+ */
+class huge_pages
+{
+public:
+    /// Page policies.
+    enum {
+        NONE = 0,           ///< Regular pages.
+        TRANSPARENT,        ///< Transparent huge pages.
+        EXPLICIT_2MB,       ///< Explicit 2MB huge pages.
+        EXPLICIT_1GB,       ///< Explicit 1GB huge pages.
+    };
+
+    /// Memory blocks actually used for allocations.
+    enum {
+        BLOCK_ALIGNED = 0,  ///< An aligned block from the heap.
+        BLOCK_MAPPED,       ///< A block mapped with explicit huge pages.
+    };
+
+    /// The alignment of memory blocks (size of a cache line).
+    static const size_t alignment = 64;
+    /// The size of a (2MB) huge page.
+    static const size_t huge_page_size = (size_t)1 << 21;
+
+protected:
+    /// The header stored just before a memory block.
+    struct header
+    {
+        int     type;       ///< The type of the block (BLOCK_*).
+        size_t  size;       ///< The size of the mapped/allocated region.
+    };
+
+public:
+    /**
+     * Obtains the process-wide page policy.
+     *  @return int&        The reference to the page policy.
+     */
+    static int& policy()
+    {
+        static int value = TRANSPARENT;
+        return value;
+    }
+
+    /**
+     * Allocates a memory block.
+     *  @param  size        The size of the memory block in bytes.
+     *  @return void*       The pointer to the memory block aligned to a
+     *                      64-byte boundary, or \c NULL if the allocation
+     *                      fails.
+     */
+    static void* allocate(size_t size)
+    {
+        char* base = NULL;
+        const size_t total = size + alignment;
+        const int pol = policy();
+
+#if     !defined(_WIN32) && defined(MAP_HUGETLB)
+        // Try explicit huge pages for a large block.
+        if (huge_page_size <= total) {
+            if (pol == EXPLICIT_1GB && ((size_t)1 << 30) <= total) {
+                base = map(total, (size_t)1 << 30, 30);
+            }
+            if (base == NULL && (pol == EXPLICIT_1GB || pol == EXPLICIT_2MB)) {
+                base = map(total, huge_page_size, 21);
+            }
+        }
+#endif/*!defined(_WIN32) && defined(MAP_HUGETLB)*/
+
+        // Allocate an aligned block from the heap.
+        if (base == NULL) {
+            const bool huge = (pol != NONE && huge_page_size <= total);
+            base = aligned(total, huge ? (size_t)huge_page_size : (size_t)alignment);
+            if (base == NULL) {
+                return NULL;
+            }
+#if     !defined(_WIN32) && defined(MADV_HUGEPAGE)
+            if (huge) {
+                // The result of the advice is ignored; the kernel may
+                // not support transparent huge pages.
+                madvise(base, total - total % huge_page_size, MADV_HUGEPAGE);
+            }
+#endif/*!defined(_WIN32) && defined(MADV_HUGEPAGE)*/
+            header* h = reinterpret_cast<header*>(base);
+            h->type = BLOCK_ALIGNED;
+            h->size = total;
+        }
+
+        return base + alignment;
+    }
+
+    /**
+     * Deallocates a memory block.
+     *  @param  p           The pointer to the memory block returned by
+     *                      allocate().
+     */
+    static void deallocate(void* p)
+    {
+        if (p == NULL) {
+            return;
+        }
+
+        char* base = reinterpret_cast<char*>(p) - alignment;
+        header* h = reinterpret_cast<header*>(base);
+#if     !defined(_WIN32) && defined(MAP_HUGETLB)
+        if (h->type == BLOCK_MAPPED) {
+            munmap(base, h->size);
+            return;
+        }
+#endif/*!defined(_WIN32) && defined(MAP_HUGETLB)*/
+#ifdef  _WIN32
+        _aligned_free(base);
+#else
+        std::free(base);
+#endif/*_WIN32*/
+    }
+
+protected:
+    static char* aligned(size_t size, size_t align)
+    {
+#ifdef  _WIN32
+        return reinterpret_cast<char*>(_aligned_malloc(size, align));
+#else
+        void* p = NULL;
+        if (posix_memalign(&p, align, size) != 0) {
+            return NULL;
+        }
+        return reinterpret_cast<char*>(p);
+#endif/*_WIN32*/
+    }
+
+#if     !defined(_WIN32) && defined(MAP_HUGETLB)
+    static char* map(size_t size, size_t page, int shift)
+    {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#ifdef  MAP_HUGE_SHIFT
+        flags |= (shift << MAP_HUGE_SHIFT);
+#else
+        if (page != huge_page_size) {
+            // The page size cannot be specified.
+            return NULL;
+        }
+#endif/*MAP_HUGE_SHIFT*/
+
+        size = (size + page - 1) / page * page;
+        void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p == MAP_FAILED) {
+            return NULL;
+        }
+
+        header* h = reinterpret_cast<header*>(p);
+        h->type = BLOCK_MAPPED;
+        h->size = size;
+        return reinterpret_cast<char*>(p);
+    }
+#endif/*!defined(_WIN32) && defined(MAP_HUGETLB)*/
+};
+
+
+
+/**
+ * An STL allocator for weight vectors.
+ *
+ *  This allocator obtains memory blocks from huge_pages so that weight
+ *  vectors are aligned to cache lines and backed by huge pages. Use this
+ *  allocator with containers (e.g., \c std::vector) of feature weights.
+ *
+ *  @param  type        The type of elements.
+ */
+template <class type>
+class huge_page_allocator
+{
+public:
+    typedef type                value_type;
+    typedef type*               pointer;
+    typedef const type*         const_pointer;
+    typedef type&               reference;
+    typedef const type&         const_reference;
+    typedef std::size_t         size_type;
+    typedef std::ptrdiff_t      difference_type;
+
+    template <class other_type>
+    struct rebind
+    {
+        typedef huge_page_allocator<other_type> other;
+    };
+
+public:
+    huge_page_allocator()
+    {
+    }
+
+    huge_page_allocator(const huge_page_allocator&)
+    {
+    }
+
+    template <class other_type>
+    huge_page_allocator(const huge_page_allocator<other_type>&)
+    {
+    }
+
+    pointer address(reference x) const
+    {
+        return &x;
+    }
+
+    const_pointer address(const_reference x) const
+    {
+        return &x;
+    }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+        if (max_size() < n) {
+            throw std::bad_alloc();
+        }
+        void* p = huge_pages::allocate(n * sizeof(type));
+        if (p == NULL) {
+            throw std::bad_alloc();
+        }
+        return reinterpret_cast<pointer>(p);
+    }
+
+    void deallocate(pointer p, size_type)
+    {
+        huge_pages::deallocate(p);
+    }
+
+    size_type max_size() const
+    {
+        return (std::numeric_limits<size_type>::max() - huge_pages::alignment) / sizeof(type);
+    }
+
+    void construct(pointer p, const type& value)
+    {
+        new(p) type(value);
+    }
+
+    void destroy(pointer p)
+    {
+        p->~type();
+    }
+};
+
+template <class type1, class type2>
+inline bool operator==(const huge_page_allocator<type1>&, const huge_page_allocator<type2>&)
+{
+    return true;
+}
+
+template <class type1, class type2>
+inline bool operator!=(const huge_page_allocator<type1>&, const huge_page_allocator<type2>&)
+{
+    return false;
+}
+
+};
+
+#endif/*__CLASSIAS_ALLOCATOR_H__*/
@@ -0,0 +1,169 @@
+/*
+ *		C API of the predictors.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_CAPI_H__
+#define __CLASSIAS_CAPI_H__
+
+#include <stddef.h>
+
+#ifdef  __cplusplus
+extern "C" {
+#endif/*__cplusplus*/
+
+/**
+ * \addtogroup classias_capi C API
+ *  The C API wraps classias::predictor (libclassias) for programs in C or
+ *  in languages with a foreign function interface. A predictor handle is
+ *  reused across calls, and the prediction functions allocate no memory;
+ *  multiple threads may share a handle for prediction.
+ *  @{
+ */
+
+/** A predictor handle. */
+typedef struct tag_classias_predictor classias_predictor_t;
+
+/** Model types. */
+enum {
+    CLASSIAS_TYPE_NONE = 0,
+    CLASSIAS_TYPE_BINARY,
+    CLASSIAS_TYPE_MULTI,
+    CLASSIAS_TYPE_CANDIDATE
+};
+
+/**
+ * Loads a model file (in the text or binary format).
+ *  @param  filename    The file name.
+ *  @param  error       The buffer receiving an error message, or \c NULL.
+ *  @param  size        The size of the buffer.
+ *  @return classias_predictor_t*   The predictor, or \c NULL on failure.
+ */
+classias_predictor_t* classias_predictor_open(const char *filename, char *error, size_t size);
+
+/**
+ * Releases a predictor.
+ *  @param  p           The predictor.
+ */
+void classias_predictor_close(classias_predictor_t* p);
+
+/**
+ * Returns the model type (CLASSIAS_TYPE_*).
+ */
+int classias_predictor_type(const classias_predictor_t* p);
+
+/**
+ * Returns the number of labels (multi).
+ */
+int classias_predictor_num_labels(const classias_predictor_t* p);
+
+/**
+ * Returns a label (multi).
+ *  @param  p           The predictor.
+ *  @param  i           The label number.
+ *  @param  length      The pointer receiving the length of the label.
+ *  @return const char* The label, which is not terminated by a null
+ *                      character.
+ */
+const char* classias_predictor_label(const classias_predictor_t* p, int i, size_t *length);
+
+/**
+ * Interns a feature (an attribute for a multi model).
+ *  @return int         The feature number, or -1 if the model does not
+ *                      have the feature.
+ */
+int classias_predictor_feature(const classias_predictor_t* p, const char *name, size_t length);
+
+/**
+ * Computes the score of an instance (binary) or a candidate (candidate).
+ *  @param  p           The predictor.
+ *  @param  features    The array of feature numbers (negative ones are
+ *                      ignored).
+ *  @param  values      The array of feature values, or \c NULL for 1.0.
+ *  @param  n           The number of features.
+ *  @return double      The score.
+ */
+double classias_predictor_score(const classias_predictor_t* p, const int *features, const double *values, size_t n);
+
+/**
+ * Computes the score of an instance (binary) or a candidate (candidate)
+ * with null-terminated feature names.
+ */
+double classias_predictor_score_names(const classias_predictor_t* p, const char * const *names, const double *values, size_t n);
+
+/**
+ * Computes the scores of the labels for an instance (multi).
+ *  @param  p           The predictor.
+ *  @param  attributes  The array of attribute numbers (negative ones are
+ *                      ignored).
+ *  @param  values      The array of attribute values, or \c NULL for 1.0.
+ *  @param  n           The number of attributes.
+ *  @param  scores      The array receiving the scores of the labels.
+ *  @return int         The label number of the highest score, or -1.
+ */
+int classias_predictor_score_labels(const classias_predictor_t* p, const int *attributes, const double *values, size_t n, double *scores);
+
+/**
+ * Computes the scores of the labels for an instance with null-terminated
+ * attribute names (multi).
+ */
+int classias_predictor_score_labels_names(const classias_predictor_t* p, const char * const *attributes, const double *values, size_t n, double *scores);
+
+/**
+ * Computes the scores of the candidates of an instance (candidate).
+ *  @param  p           The predictor.
+ *  @param  features    The array of feature numbers of all candidates.
+ *  @param  values      The array of feature values, or \c NULL for 1.0.
+ *  @param  offsets     The offsets of the candidates in features
+ *                      (num_candidates + 1 elements).
+ *  @param  num_candidates  The number of candidates.
+ *  @param  scores      The array receiving the scores of the candidates.
+ *  @return int         The candidate number of the highest score, or -1.
+ */
+int classias_predictor_score_candidates(const classias_predictor_t* p, const int *features, const double *values, const size_t *offsets, size_t num_candidates, double *scores);
+
+/**
+ * Converts a score into a probability (binary).
+ */
+double classias_logistic(double score);
+
+/**
+ * Converts scores into probabilities in place (multi and candidate).
+ */
+void classias_softmax(double *scores, int n);
+
+/** @} */
+
+#ifdef  __cplusplus
+}
+#endif/*__cplusplus*/
+
+#endif/*__CLASSIAS_CAPI_H__*/
@@ -34,16 +34,24 @@
 #define __CLASSIAS_CLASSIAS_H__
 
 #include <vector>
+#include "allocator.h"
 #include "types.h"
 #include "feature_generator.h"
 #include "instance.h"
 #include "data.h"
+#include "shard.h"
+#include "stream.h"
+#include "model_file.h"
 
 namespace classias
 {
 
-typedef std::vector<double> weight_vector;
-typedef default_vector<double> expandable_weight_vector;
+typedef std::vector<double, huge_page_allocator<double> > weight_vector;
+typedef default_vector<double, huge_page_allocator<double> > expandable_weight_vector;
+typedef paged_vector<double, huge_page_allocator<double> > paged_weight_vector;
+typedef std::vector<float, huge_page_allocator<float> > float_weight_vector;
+typedef default_vector<float, huge_page_allocator<float> > expandable_float_weight_vector;
+typedef paged_vector<float, huge_page_allocator<float> > paged_float_weight_vector;
 
 typedef dense_feature_generator_base<int, int, int> dense_feature_generator;
 typedef sparse_feature_generator_base<int, int, int> sparse_feature_generator;
@@ -67,6 +75,18 @@ typedef multi_instance_base<sparse_attributes> ninstance;
 typedef multi_data_base<ninstance, sparse_feature_generator> ndata;
 typedef multi_data_with_quark_base<ninstance, quark, quark, sparse_feature_generator> nsdata;
 
+typedef compressed_sparse_vector_base<int, double> compressed_attributes;
+
+typedef binary_instance_base<compressed_attributes> compressed_binstance;
+typedef binary_data_with_quark_base<compressed_binstance, quark> compressed_bsdata;
+
+typedef candidate_instance_base<compressed_attributes> compressed_cinstance;
+typedef candidate_data_with_quark_base<compressed_cinstance, quark, quark, thru_feature_generator> compressed_csdata;
+
+typedef multi_instance_base<compressed_attributes> compressed_minstance;
+typedef multi_data_with_quark_base<compressed_minstance, quark, quark, dense_feature_generator> compressed_msdata;
+typedef multi_data_with_quark_base<compressed_minstance, quark, quark, sparse_feature_generator> compressed_nsdata;
+
 };
 
 /**
@@ -138,6 +158,18 @@ typedef multi_data_with_quark_base<ninstance, quark, quark, sparse_feature_gener
         \ref classias::train::truncated_gradient_binary
     - Truncated gradient for multi/candidate classification:
         \ref classias::train::truncated_gradient_multi
+    - SAGA for binary classification:
+        \ref classias::train::saga_binary
+    - SAGA for multi/candidate classification:
+        \ref classias::train::saga_multi
+    - FTRL-Proximal for binary classification:
+        \ref classias::train::ftrl_binary
+    - FTRL-Proximal for multi/candidate classification:
+        \ref classias::train::ftrl_multi
+    - AdaGrad for binary classification:
+        \ref classias::train::adagrad_binary
+    - AdaGrad for multi/candidate classification:
+        \ref classias::train::adagrad_multi
 - Basic data types
     - Instance weight:
         \ref classias::weight_base
@@ -145,6 +177,8 @@ typedef multi_data_with_quark_base<ninstance, quark, quark, sparse_feature_gener
         \ref classias::group_base
     - Sparse vector:
         \ref classias::sparse_vector_base
+    - Compressed sparse vector:
+        \ref classias::compressed_sparse_vector_base
     - Quark with one item (item-to-integer mapping):
         \ref classias::quark_base
     - Quark with two items (item-pair-to-integer mapping):
@@ -34,6 +34,7 @@
 #define __CLASSIAS_CLASSIFY_LINEAR_BINARY_H__
 
 #include <cmath>
+#include <classias/types.h>
 
 namespace classias
 {
@@ -69,7 +70,7 @@ public:
     /// The type of a model.
     typedef model_tmpl model_type;
     /// The type of a feature weight.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
 
 protected:
     /// The model.
@@ -199,7 +200,7 @@ public:
     /// The type of a model.
     typedef model_tmpl model_type;
     /// The type of a feature weight.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// Tne type of the base class.
     typedef linear_binary<model_tmpl> base_type;
 
@@ -306,7 +307,7 @@ public:
     /// The type of a model.
     typedef model_tmpl model_type;
     /// The type of a feature weight.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// Tne type of the base class.
     typedef linear_binary<model_tmpl> base_type;
 
@@ -34,6 +34,7 @@
 #define __CLASSIAS_CLASSIFY_LINEAR_MULTI_H__
 
 #include <cmath>
+#include <classias/types.h>
 
 namespace classias
 {
@@ -72,7 +73,7 @@ public:
     /// The type of a model.
     typedef model_tmpl model_type;
     /// The type of a feature weight.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
 
 protected:
     /// The type representing an array of scores.
@@ -164,6 +165,16 @@ public:
         m_scores[i] *= scale;
     }
 
+    /**
+     * Adds a value to the score of a candidate.
+     *  @param  i           The index for the candidate.
+     *  @param  value       The value added to the score.
+     */
+    inline void add(int i, const value_type& value)
+    {
+        m_scores[i] += value;
+    }
+
     /**
      * Sets an attribute for a candidate.
      *
@@ -290,7 +301,7 @@ public:
     /// The type of a model.
     typedef model_tmpl model_type;
     /// The type of a feature weight.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// The type of the base class.
     typedef linear_multi<model_tmpl> base_type;
 
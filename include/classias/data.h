@@ -33,11 +33,188 @@
 #ifndef __CLASSIAS_DATA_H__
 #define __CLASSIAS_DATA_H__
 
+#include <algorithm>
 #include <vector>
+#include "quark.h"
 
 namespace classias
 {
 
+/**
+ * Builds a map for removing rare attributes.
+ *  This function receives the number of occurrences of every attribute in
+ *  the map, and overwrites the map with new attribute identifiers: an
+ *  attribute occurring no less than min_count times (or reserved) obtains
+ *  a compact identifier with the order of attributes kept, and the other
+ *  attributes obtain -1.
+ *  @param  map         The number of occurrences of attributes (in), and
+ *                      the map from old identifiers to new ones (out).
+ *  @param  min_count   The minimum number of occurrences of an attribute.
+ *  @param  reserved    The number of early attributes kept regardless of
+ *                      their occurrences.
+ *  @return int         The number of the removed attributes.
+ */
+inline int build_cutoff_map(std::vector<int>& map, int min_count, int reserved)
+{
+    int n = 0;
+    for (int i = 0;i < (int)map.size();++i) {
+        map[i] = (i < reserved || min_count <= map[i]) ? n++ : -1;
+    }
+    return (int)map.size() - n;
+}
+
+/**
+ * Builds a map for renumbering attributes by their frequencies.
+ *  This function receives the number of occurrences of every attribute in
+ *  the map, and overwrites the map with new attribute identifiers assigned
+ *  in descending order of the occurrences (ties are broken by the current
+ *  identifiers). Early attributes (e.g., bias and unregularized attributes)
+ *  keep their identifiers.
+ *  @param  map         The number of occurrences of attributes (in), and
+ *                      the map from old identifiers to new ones (out).
+ *  @param  reserved    The number of early attributes keeping their
+ *                      identifiers.
+ */
+inline void build_frequency_map(std::vector<int>& map, int reserved)
+{
+    std::vector<std::pair<int, int> > order;
+    for (int i = reserved;i < (int)map.size();++i) {
+        order.push_back(std::pair<int, int>(-map[i], i));
+    }
+    std::sort(order.begin(), order.end());
+
+    for (int i = 0;i < reserved && i < (int)map.size();++i) {
+        map[i] = i;
+    }
+    for (int i = 0;i < (int)order.size();++i) {
+        map[order[i].second] = reserved + i;
+    }
+}
+
+/**
+ * A function object counting the occurrences of attributes.
+ */
+struct attribute_counter
+{
+    /// The vector [A] receiving the counts.
+    std::vector<int>& counts;
+
+    attribute_counter(std::vector<int>& _counts) : counts(_counts)
+    {
+    }
+
+    template <class attributes_type>
+    void operator()(const attributes_type& v)
+    {
+        typename attributes_type::const_iterator it;
+        for (it = v.begin();it != v.end();++it) {
+            ++counts[it->first];
+        }
+    }
+};
+
+/**
+ * A function object replacing attribute identifiers.
+ */
+struct attribute_remapper
+{
+    /// The map from old identifiers to new ones.
+    const std::vector<int>& map;
+    /// Whether to sort the attributes by their new identifiers.
+    bool sort;
+
+    attribute_remapper(const std::vector<int>& _map, bool _sort)
+        : map(_map), sort(_sort)
+    {
+    }
+
+    template <class attributes_type>
+    void operator()(attributes_type& v)
+    {
+        v.remap(map);
+        if (sort) {
+            v.sort();
+        }
+    }
+};
+
+/**
+ * Counts the occurrences of attributes in a data set.
+ *  @param  data        The data set with a quark, which implements
+ *                      for_each_attribute_vector().
+ *  @param  counts      The vector [A] receiving the counts.
+ */
+template <class data_type>
+inline void count_attributes(data_type& data, std::vector<int>& counts)
+{
+    counts.assign(data.attributes.size(), 0);
+    attribute_counter counter(counts);
+    data.for_each_attribute_vector(counter);
+}
+
+/**
+ * Replaces the attribute identifiers in a data set and its quark.
+ *  @param  data        The data set with a quark, which implements
+ *                      for_each_attribute_vector().
+ *  @param  map         The map from old identifiers to new ones.
+ *  @param  sort        \c true to sort the attributes of every vector by
+ *                      their new identifiers.
+ */
+template <class data_type>
+inline void remap_attributes(data_type& data, const std::vector<int>& map, bool sort)
+{
+    attribute_remapper remapper(map, sort);
+    data.for_each_attribute_vector(remapper);
+    data.attributes.remap(map);
+}
+
+/**
+ * Removes attributes occurring rarely in a data set.
+ *  This function counts the occurrences of attributes in the instances,
+ *  removes the attributes occurring less than min_count times from the
+ *  instances and the quark, and assigns compact identifiers to the
+ *  remaining attributes. Call this function before generating features.
+ *  @param  data        The data set with a quark.
+ *  @param  min_count   The minimum number of occurrences of an attribute.
+ *  @param  reserved    The number of early attributes (e.g., bias and
+ *                      unregularized attributes) kept regardless of
+ *                      their occurrences.
+ *  @return int         The number of the removed attributes.
+ */
+template <class data_type>
+inline int remove_rare_attributes(data_type& data, int min_count, int reserved = 0)
+{
+    std::vector<int> map;
+    count_attributes(data, map);
+    int removed = build_cutoff_map(map, min_count, reserved);
+    if (0 < removed) {
+        remap_attributes(data, map, false);
+    }
+    return removed;
+}
+
+/**
+ * Renumbers attributes in a data set in descending order of their
+ * frequencies.
+ *  This function assigns smaller identifiers to attributes occurring more
+ *  frequently in the instances, and sorts the attributes of every instance
+ *  by their new identifiers. Frequent attributes thus share cache lines
+ *  and pages of a weight vector, and training algorithms access a weight
+ *  vector more sequentially. Call this function before generating
+ *  features.
+ *  @param  data        The data set with a quark.
+ *  @param  reserved    The number of early attributes (e.g., bias and
+ *                      unregularized attributes) whose identifiers are
+ *                      kept.
+ */
+template <class data_type>
+inline void renumber_attributes(data_type& data, int reserved = 0)
+{
+    std::vector<int> map;
+    count_attributes(data, map);
+    build_frequency_map(map, reserved);
+    remap_attributes(data, map, true);
+}
 
 /**
  * A template class for a collection of binary-classification instances.
@@ -202,6 +379,93 @@ public:
         return this->back();
     }
 
+    /**
+     * Releases the memory reserved but not occupied by the instances.
+     */
+    void shrink()
+    {
+        for (iterator it = instances.begin();it != instances.end();++it) {
+            it->shrink();
+        }
+        if (instances.size() < instances.capacity()) {
+            instances_type(instances).swap(instances);
+        }
+    }
+
+    /**
+     * Canonicalizes the instances.
+     *  This function merges attributes with the same identifier in every
+     *  instance by summing their values, and then merges identical instances
+     *  (with the same label, group number, and attributes) into the first
+     *  one, whose weight becomes the sum of their weights. The remaining
+     *  instances keep their order.
+     *  @return size_type   The number of instances removed by merging.
+     */
+    size_type canonicalize()
+    {
+        const size_type n = instances.size();
+
+        // Merge duplicate attributes in every instance.
+        for (iterator it = instances.begin();it != instances.end();++it) {
+            it->canonicalize();
+        }
+
+        // Sort the instances by their hash values (and positions).
+        std::vector<std::pair<size_t, size_type> > order(n);
+        for (size_type i = 0;i < n;++i) {
+            order[i].first = instances[i].hash();
+            order[i].second = i;
+        }
+        std::sort(order.begin(), order.end());
+
+        // Find the first occurrence of every instance among the instances
+        // with the same hash value.
+        std::vector<size_type> first(n);
+        for (size_type i = 0;i < n;++i) {
+            first[i] = i;
+        }
+        for (size_type i = 0;i < n;) {
+            size_type j = i+1;
+            while (j < n && order[j].first == order[i].first) {
+                ++j;
+            }
+            for (size_type a = i;a < j;++a) {
+                const size_type x = order[a].second;
+                if (first[x] != x) {
+                    continue;
+                }
+                for (size_type b = a+1;b < j;++b) {
+                    const size_type y = order[b].second;
+                    if (first[y] == y && instances[x].equals(instances[y])) {
+                        first[y] = x;
+                    }
+                }
+            }
+            i = j;
+        }
+
+        // Accumulate the weights of duplicates to their first occurrences.
+        for (size_type i = 0;i < n;++i) {
+            if (first[i] != i) {
+                instance_type& inst = instances[first[i]];
+                inst.set_weight(inst.get_weight() + instances[i].get_weight());
+            }
+        }
+
+        // Remove the duplicates.
+        size_type m = 0;
+        for (size_type i = 0;i < n;++i) {
+            if (first[i] == i) {
+                if (m != i) {
+                    std::swap(instances[m], instances[i]);
+                }
+                ++m;
+            }
+        }
+        instances.erase(instances.begin() + m, instances.end());
+        return n - m;
+    }
+
     /**
      * Sets the start index of user features.
      *  @param  index       The start index of user features.
@@ -340,6 +604,19 @@ public:
     {
         return attributes.size();
     }
+
+    /**
+     * Applies a function object to the attribute vectors of the instances.
+     *  @param  f           The function object receiving an instance.
+     */
+    template <class function_type>
+    void for_each_attribute_vector(function_type& f)
+    {
+        iterator iti;
+        for (iti = this->begin();iti != this->end();++iti) {
+            f(*iti);
+        }
+    }
 };
 
 
@@ -541,6 +818,22 @@ public:
     {
         return attributes.size();
     }
+
+    /**
+     * Applies a function object to the attribute vectors of the candidates.
+     *  @param  f           The function object receiving a candidate.
+     */
+    template <class function_type>
+    void for_each_attribute_vector(function_type& f)
+    {
+        iterator iti;
+        for (iti = this->begin();iti != this->end();++iti) {
+            typename instance_type::iterator itc;
+            for (itc = iti->begin();itc != iti->end();++itc) {
+                f(*itc);
+            }
+        }
+    }
 };
 
 
@@ -665,21 +958,55 @@ public:
     /**
      * Finalize the data set.
      *  This function generates features for pairs of attributes and labels.
+     *  If the feature generator requires registration, this function
+     *  generates features only for the pairs occurring no less than
+     *  min_count times in the data set.
+     *  @param  min_count   The minimum number of occurrences of a pair of
+     *                      an attribute and label.
+     *  @return int         The number of the pairs removed.
      */
-    void generate_features()
+    int generate_features(int min_count = 1)
     {
+        int removed = 0;
         this->feature_generator.set_num_labels(this->labels.size());
         this->feature_generator.set_num_attributes(this->attributes.size());
 
         if (this->feature_generator.needs_registration()) {
             iterator iti;
+            quark2_base<attribute_type, int> pairs;
+            std::vector<int> counts;
+
+            // Count the occurrences of pairs of attributes and labels.
+            if (1 < min_count) {
+                for (iti = this->begin();iti != this->end();++iti) {
+                    typename instance_type::iterator it;
+                    for (it = iti->begin();it != iti->end();++it) {
+                        size_t v = pairs(it->first, iti->get_label());
+                        if (counts.size() <= v) {
+                            counts.push_back(0);
+                        }
+                        ++counts[v];
+                    }
+                }
+                for (size_t v = 0;v < counts.size();++v) {
+                    if (counts[v] < min_count) {
+                        ++removed;
+                    }
+                }
+            }
+
             for (iti = this->begin();iti != this->end();++iti) {
                 typename instance_type::iterator it;
                 for (it = iti->begin();it != iti->end();++it) {
-                    this->feature_generator.regist(it->first, iti->get_label());
+                    if (counts.empty() ||
+                        min_count <= counts[pairs.to_value(it->first, iti->get_label())]) {
+                        this->feature_generator.regist(it->first, iti->get_label());
+                    }
                 }
             }
         }
+
+        return removed;
     }
 };
 
@@ -777,6 +1104,19 @@ public:
         return this->feature_generator.num_features();
     }
 
+    /**
+     * Applies a function object to the attribute vectors of the instances.
+     *  @param  f           The function object receiving an instance.
+     */
+    template <class function_type>
+    void for_each_attribute_vector(function_type& f)
+    {
+        iterator iti;
+        for (iti = this->begin();iti != this->end();++iti) {
+            f(*iti);
+        }
+    }
+
     /**
      * Reserves bias features for all of possible labels.
      *  @param  a           The attribute identifier for the bias feature.
@@ -800,21 +1140,55 @@ public:
     /**
      * Finalize the data set.
      *  This function generates features for pairs of attributes and labels.
+     *  If the feature generator requires registration, this function
+     *  generates features only for the pairs occurring no less than
+     *  min_count times in the data set.
+     *  @param  min_count   The minimum number of occurrences of a pair of
+     *                      an attribute and label.
+     *  @return int         The number of the pairs removed.
      */
-    void generate_features()
+    int generate_features(int min_count = 1)
     {
+        int removed = 0;
         this->feature_generator.set_num_labels(this->labels.size());
         this->feature_generator.set_num_attributes(this->attributes.size());
 
         if (this->feature_generator.needs_registration()) {
             iterator iti;
+            quark2_base<attribute_type, int> pairs;
+            std::vector<int> counts;
+
+            // Count the occurrences of pairs of attributes and labels.
+            if (1 < min_count) {
+                for (iti = this->begin();iti != this->end();++iti) {
+                    typename instance_type::iterator it;
+                    for (it = iti->begin();it != iti->end();++it) {
+                        size_t v = pairs(it->first, iti->get_label());
+                        if (counts.size() <= v) {
+                            counts.push_back(0);
+                        }
+                        ++counts[v];
+                    }
+                }
+                for (size_t v = 0;v < counts.size();++v) {
+                    if (counts[v] < min_count) {
+                        ++removed;
+                    }
+                }
+            }
+
             for (iti = this->begin();iti != this->end();++iti) {
                 typename instance_type::iterator it;
                 for (it = iti->begin();it != iti->end();++it) {
-                    this->feature_generator.regist(it->first, iti->get_label());
+                    if (counts.empty() ||
+                        min_count <= counts[pairs.to_value(it->first, iti->get_label())]) {
+                        this->feature_generator.regist(it->first, iti->get_label());
+                    }
                 }
             }
         }
+
+        return removed;
     }
 };
 
@@ -34,7 +34,9 @@
 #define __CLASSIAS_EVALUATION_H__
 
 #include <iomanip>
+#include <string>
 #include <vector>
+#include <classias/parameters.h>
 
 namespace classias
 {
@@ -77,6 +79,16 @@ public:
         ++m_n;
     }
 
+    /**
+     * Adds the counts of another counter.
+     *  @param  other       The counter (e.g., of another thread).
+     */
+    inline void merge(const accuracy& other)
+    {
+        m_m += other.m_m;
+        m_n += other.m_n;
+    }
+
     /**
      * Gets the accuracy.
      *  @return double      The accuracy.
@@ -162,6 +174,23 @@ public:
         if (r == p) m_stat[p].num_match++;
     }
 
+    /**
+     * Adds the counts of another counter.
+     *  @param  other       The counter (e.g., of another thread) that
+     *                      numbers the labels in the same manner.
+     */
+    void merge(const precall& other)
+    {
+        if (m_stat.size() < other.m_stat.size()) {
+            m_stat.resize(other.m_stat.size());
+        }
+        for (size_t i = 0;i < other.m_stat.size();++i) {
+            m_stat[i].num_match += other.m_stat[i].num_match;
+            m_stat[i].num_reference += other.m_stat[i].num_reference;
+            m_stat[i].num_prediction += other.m_stat[i].num_prediction;
+        }
+    }
+
     template <class labels_type, class positive_iterator_type>
     void output_labelwise(
         std::ostream& os,
@@ -186,6 +215,64 @@ public:
         }
     }
 
+    /**
+     * Computes the micro-average F1 score.
+     *  @param  pb          The iterator for the first element of the
+     *                      positive labels.
+     *  @param  pe          The iterator just beyond the last element
+     *                      of the positive labels.
+     *  @return double      The micro-average F1 score.
+     */
+    template <class positive_iterator_type>
+    double micro_f1(
+        positive_iterator_type pb,
+        positive_iterator_type pe
+        ) const
+    {
+        int num_match = 0;
+        int num_reference = 0;
+        int num_prediction = 0;
+
+        for (positive_iterator_type it = pb;it != pe;++it) {
+            num_match += m_stat[*it].num_match;
+            num_reference += m_stat[*it].num_reference;
+            num_prediction += m_stat[*it].num_prediction;
+        }
+
+        double precision = divide(num_match, num_prediction);
+        double recall = divide(num_match, num_reference);
+        return divide(2 * precision * recall, precision + recall);
+    }
+
+    /**
+     * Computes the macro-average F1 score.
+     *  @param  pb          The iterator for the first element of the
+     *                      positive labels.
+     *  @param  pe          The iterator just beyond the last element
+     *                      of the positive labels.
+     *  @return double      The macro-average F1 score.
+     */
+    template <class positive_iterator_type>
+    double macro_f1(
+        positive_iterator_type pb,
+        positive_iterator_type pe
+        ) const
+    {
+        int n = 0;
+        double f1 = 0.;
+
+        for (positive_iterator_type it = pb;it != pe;++it) {
+            if (0 < m_stat[*it].num_prediction || 0 < m_stat[*it].num_reference) {
+                double p = divide(m_stat[*it].num_match, m_stat[*it].num_prediction);
+                double r = divide(m_stat[*it].num_match, m_stat[*it].num_reference);
+                f1 += divide(2 * p * r, p + r);
+                ++n;
+            }
+        }
+
+        return (0 < n ? f1 / n : 0.);
+    }
+
     /**
      * Outputs micro-average precision, recall, F1 scores.
      *  @param  os          The output stream.
@@ -281,6 +368,59 @@ private:
 
 
 
+/**
+ * Scores of a holdout evaluation.
+ */
+struct holdout_scores
+{
+    double accuracy;    ///< The accuracy.
+    double micro_f1;    ///< The micro-average F1 score.
+    double macro_f1;    ///< The macro-average F1 score.
+
+    /**
+     * Constructs an object.
+     */
+    holdout_scores() : accuracy(0.), micro_f1(0.), macro_f1(0.)
+    {
+    }
+
+    /**
+     * Tests whether a metric name is known.
+     *  @param  metric      The name of a metric, \c "accuracy",
+     *                      \c "micro_f1", or \c "macro_f1".
+     *  @return bool        \c true if the metric is known.
+     */
+    static bool known(const std::string& metric)
+    {
+        return (
+            metric == "accuracy" ||
+            metric == "micro_f1" ||
+            metric == "macro_f1"
+            );
+    }
+
+    /**
+     * Obtains the score of a metric.
+     *  @param  metric      The name of a metric, \c "accuracy",
+     *                      \c "micro_f1", or \c "macro_f1".
+     *  @return double      The score.
+     *  @throw  invalid_parameter   The metric is unknown.
+     */
+    double get(const std::string& metric) const
+    {
+        if (metric == "accuracy") {
+            return accuracy;
+        } else if (metric == "micro_f1") {
+            return micro_f1;
+        } else if (metric == "macro_f1") {
+            return macro_f1;
+        }
+        throw invalid_parameter("Unknown metric for holdout evaluation");
+    }
+};
+
+
+
 /**
  * Hold-out evaluation for binary classification.
  *  @param  os              The output stream.
@@ -290,12 +430,14 @@ private:
  *                          of the dataset.
  *  @param  cls             The classifier object.
  *  @param  holdout         The group number for holdout evaluation.
+ *  @return holdout_scores  The scores of the evaluation. The F1 scores
+ *                          are computed for the positive label.
  */
 template <
     class iterator_type,
     class classifier_type
 >
-static void holdout_evaluation_binary(
+static holdout_scores holdout_evaluation_binary(
     std::ostream& os,
     iterator_type first,
     iterator_type last,
@@ -326,6 +468,12 @@ static void holdout_evaluation_binary(
 
     acc.output(os);
     pr.output_micro(os, positive_labels, positive_labels+1);
+
+    holdout_scores scores;
+    scores.accuracy = acc;
+    scores.micro_f1 = pr.micro_f1(positive_labels, positive_labels+1);
+    scores.macro_f1 = pr.macro_f1(positive_labels, positive_labels+1);
+    return scores;
 }
 
 
@@ -344,6 +492,8 @@ static void holdout_evaluation_binary(
  *                          set of positive labels.
  *  @param  label_last      The iterator pointing just beyond the last element
  *                          of the set of positive labels.
+ *  @return holdout_scores  The scores of the evaluation. The F1 scores are
+ *                          zero if \a acconly is \c true.
  */
 template <
     class iterator_type,
@@ -352,7 +502,7 @@ template <
     class labels_type,
     class label_iterator_type
 >
-static void holdout_evaluation_multi(
+static holdout_scores holdout_evaluation_multi(
     std::ostream& os,
     iterator_type first,
     iterator_type last,
@@ -404,6 +554,14 @@ static void holdout_evaluation_multi(
         pr.output_micro(os, label_first, label_last);
         pr.output_macro(os, label_first, label_last);
     }
+
+    holdout_scores scores;
+    scores.accuracy = acc;
+    if (!acconly) {
+        scores.micro_f1 = pr.micro_f1(label_first, label_last);
+        scores.macro_f1 = pr.macro_f1(label_first, label_last);
+    }
+    return scores;
 }
 
 };
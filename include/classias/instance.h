@@ -115,6 +115,34 @@ public:
     {
         return m_label;
     }
+
+    /**
+     * Computes a hash value of the instance.
+     *  @return size_t      The hash value computed from the label, group
+     *                      number, and features of the instance.
+     */
+    inline size_t hash() const
+    {
+        size_t h = features_type::hash();
+        h = h * 31 + static_cast<size_t>(m_label);
+        h = h * 31 + static_cast<size_t>(this->get_group());
+        return h;
+    }
+
+    /**
+     * Tests if two instances have the same label, group, and features.
+     *  Instance weights are not compared.
+     *  @param  x           The instance compared with this instance.
+     *  @retval bool        \c true if the instances are identical.
+     */
+    inline bool equals(const binary_instance_base& x) const
+    {
+        return (
+            m_label == x.m_label &&
+            this->get_group() == x.get_group() &&
+            features_type::equals(x)
+            );
+    }
 };
 
 
@@ -233,6 +261,34 @@ public:
     {
         return *this;
     }
+
+    /**
+     * Computes a hash value of the instance.
+     *  @return size_t      The hash value computed from the label, group
+     *                      number, and attributes of the instance.
+     */
+    inline size_t hash() const
+    {
+        size_t h = attributes_type::hash();
+        h = h * 31 + static_cast<size_t>(m_index);
+        h = h * 31 + static_cast<size_t>(this->get_group());
+        return h;
+    }
+
+    /**
+     * Tests if two instances have the same label, group, and attributes.
+     *  Instance weights are not compared.
+     *  @param  x           The instance compared with this instance.
+     *  @retval bool        \c true if the instances are identical.
+     */
+    inline bool equals(const multi_instance_base& x) const
+    {
+        return (
+            m_index == x.m_index &&
+            this->get_group() == x.get_group() &&
+            attributes_type::equals(x)
+            );
+    }
 };
 
 
@@ -444,6 +500,66 @@ public:
     {
         return this->candidates[i];
     }
+
+    /**
+     * Releases the memory reserved but not occupied by the candidates.
+     */
+    inline void shrink()
+    {
+        for (iterator it = candidates.begin();it != candidates.end();++it) {
+            it->shrink();
+        }
+        if (candidates.size() < candidates.capacity()) {
+            candidates_type(candidates).swap(candidates);
+        }
+    }
+
+    /**
+     * Merges attributes with the same identifier in every candidate.
+     */
+    inline void canonicalize()
+    {
+        for (iterator it = candidates.begin();it != candidates.end();++it) {
+            it->canonicalize();
+        }
+    }
+
+    /**
+     * Computes a hash value of the instance.
+     *  @return size_t      The hash value computed from the label, group
+     *                      number, and candidates of the instance.
+     */
+    inline size_t hash() const
+    {
+        size_t h = candidates.size();
+        for (const_iterator it = candidates.begin();it != candidates.end();++it) {
+            h = h * 31 + it->hash();
+        }
+        h = h * 31 + static_cast<size_t>(m_label);
+        h = h * 31 + static_cast<size_t>(this->get_group());
+        return h;
+    }
+
+    /**
+     * Tests if two instances have the same label, group, and candidates.
+     *  Instance weights are not compared.
+     *  @param  x           The instance compared with this instance.
+     *  @retval bool        \c true if the instances are identical.
+     */
+    inline bool equals(const candidate_instance_base& x) const
+    {
+        if (m_label != x.m_label ||
+            this->get_group() != x.get_group() ||
+            candidates.size() != x.candidates.size()) {
+            return false;
+        }
+        for (size_type i = 0;i < candidates.size();++i) {
+            if (!candidates[i].equals(x.candidates[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
 };
 
 };
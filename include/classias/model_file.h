@@ -0,0 +1,1377 @@
+/*
+ *		Binary model files mapped into memory.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_MODEL_FILE_H__
+#define __CLASSIAS_MODEL_FILE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef  _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif/*_WIN32*/
+
+namespace classias
+{
+
+/**
+ * Exception class for \ref model_file and \ref model_writer.
+ */
+class model_file_error : public std::runtime_error
+{
+public:
+    /**
+     * Constructs an exception object.
+     *  @param  msg         The error message.
+     */
+    explicit model_file_error(const std::string& msg)
+        : std::runtime_error(msg)
+    {
+    }
+};
+
+
+
+/**
+ * The layout of a binary model file.
+ *
+ *  A binary model file stores a linear model in the native byte order so
+ *  that a tagger can map the file into its memory and look up feature
+ *  weights without parsing the file. The file consists of the following
+ *  regions, each of which starts at the offset written in the header:
+ *      - header: the magic string, the numbers of labels and features, and
+ *        the offsets of the regions.
+ *      - entries: the locations of strings (the model type, labels,
+ *        feature names, and attribute names, in this order) in the string
+ *        table, with the hash values of the strings.
+ *      - index: an open-addressing hash table (with linear probing) whose
+ *        buckets store the feature numbers plus one (zero for an empty
+ *        bucket).
+ *      - weights: the array of feature weights, in double precision
+ *        unless the weights are quantized.
+ *      - strings: the string table.
+ *
+ *  A model of attribute-label features (multi) also has rows, so that a
+ *  tagger finds the weights of all labels for an attribute with a single
+ *  lookup. The features of an attribute are stored in consecutive
+ *  numbers (a row), and the following regions locate the rows:
+ *      - attribute index: an open-addressing hash table whose buckets
+ *        store the attribute numbers plus one.
+ *      - rows: the array of the first feature numbers of the rows (with
+ *        the end of the last row appended).
+ *      - feature labels: the array of the label numbers of the features.
+ *
+ *  The weights of a model may be quantized to make the file smaller and
+ *  the weights denser in the cache. The version of such a file is
+ *  MODEL_VERSION_QUANTIZED, which older readers reject, and the features
+ *  in a row are sorted by the labels in the file, so that a tagger adds
+ *  the weights of a row with all labels to the label scores in sequence:
+ *      - float16: the weights in half precision (IEEE 754 binary16).
+ *      - int8: the weights in signed 8-bit integers, multiplied by scales
+ *        in single precision. A scale is shared by the features in a
+ *        block of consecutive feature numbers (whose size is a power of
+ *        two), or by the features of a label in a model with rows. The
+ *        following region stores the scales:
+ *          - scales: the array of the scales of the blocks or labels.
+ */
+struct model_file_format
+{
+    /// The magic string at the beginning of a binary model file.
+    static const char* magic()
+    {
+        return "CLSSBMDL";
+    }
+
+    /// The version of the format.
+    enum {
+        MODEL_VERSION = 1,
+        MODEL_VERSION_QUANTIZED = 2,
+        BYTE_ORDER_MARK = 0x01020304,
+    };
+
+    /// The formats of the feature weights.
+    enum {
+        WEIGHT_DOUBLE = 0,
+        WEIGHT_FLOAT16,
+        WEIGHT_INT8,
+    };
+
+    /// The header of a binary model file.
+    struct header_type
+    {
+        /// The magic string.
+        char magic[8];
+        /// The version of the format.
+        unsigned int version;
+        /// The byte-order mark for detecting a foreign byte order.
+        unsigned int byte_order;
+        /// The number of labels.
+        unsigned int num_labels;
+        /// The number of features.
+        unsigned int num_features;
+        /// The number of buckets in the hash index (a power of two).
+        unsigned int num_buckets;
+        /// The number of attributes (zero if the model has no row).
+        unsigned int num_attributes;
+        /// The offset of the entries.
+        unsigned long long entries;
+        /// The offset of the hash index.
+        unsigned long long index;
+        /// The offset of the weights.
+        unsigned long long weights;
+        /// The offset of the string table.
+        unsigned long long strings;
+        /// The size of the file.
+        unsigned long long size;
+        /// The offset of the attribute index.
+        unsigned long long attribute_index;
+        /// The offset of the rows.
+        unsigned long long rows;
+        /// The offset of the feature labels.
+        unsigned long long feature_labels;
+        /// The number of buckets in the attribute index (a power of two).
+        unsigned int attribute_buckets;
+        /// The format of the feature weights (WEIGHT_*).
+        unsigned int weight_format;
+        /// The offset of the scales of int8 weights.
+        unsigned long long scales;
+        /// The number of features sharing a scale of int8 weights (zero
+        /// for the scales of the labels).
+        unsigned int scale_block;
+        /// Reserved.
+        unsigned int reserved;
+    };
+
+    /// The location of a string in the string table.
+    struct entry_type
+    {
+        /// The offset from the beginning of the string table.
+        unsigned long long offset;
+        /// The length of the string.
+        unsigned int length;
+        /// The hash value of the string.
+        unsigned int hash;
+    };
+
+    /**
+     * Computes the hash value of a string (FNV-1a).
+     *  @param  str         The pointer to the string.
+     *  @param  length      The length of the string.
+     *  @return unsigned int    The hash value.
+     */
+    static inline unsigned int hash(const char* str, size_t length)
+    {
+        unsigned int h = 2166136261U;
+        for (size_t i = 0;i < length;++i) {
+            h = (h ^ (unsigned char)str[i]) * 16777619U;
+        }
+        return h;
+    }
+
+    /**
+     * Computes the number of buckets for a hash index.
+     *  @param  n           The number of elements.
+     *  @return unsigned int    The smallest power of two no smaller than
+     *                          2n, which keeps the load factor no greater
+     *                          than 0.5.
+     */
+    static inline unsigned int buckets(size_t n)
+    {
+        unsigned int num_buckets = 1;
+        while (num_buckets < 2 * n) {
+            num_buckets <<= 1;
+        }
+        return num_buckets;
+    }
+
+    /**
+     * Converts a weight into half precision.
+     *  The value is rounded to the nearest (even) number, and a value out
+     *  of the range is clamped to the largest finite number.
+     *  @param  value       The weight.
+     *  @return unsigned short  The weight in half precision.
+     */
+    static inline unsigned short to_half(double value)
+    {
+        const float f = (float)value;
+        unsigned int bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+
+        const unsigned int sign = (bits >> 16) & 0x8000;
+        const int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+        unsigned int mantissa = bits & 0x007FFFFF;
+        if (31 <= exponent) {
+            // Infinity, NaN, or a value too large.
+            return (unsigned short)(sign | 0x7BFF);
+        } else if (exponent <= 0) {
+            // A subnormal number (or zero).
+            if (exponent < -10) {
+                return (unsigned short)sign;
+            }
+            mantissa |= 0x00800000;
+            const int shift = 14 - exponent;
+            unsigned int half = mantissa >> shift;
+            const unsigned int rest = mantissa & ((1U << shift) - 1);
+            const unsigned int midpoint = 1U << (shift - 1);
+            if (midpoint < rest || (rest == midpoint && (half & 1))) {
+                ++half;
+            }
+            return (unsigned short)(sign | half);
+        } else {
+            // A normal number, where a carry of the rounding moves to the
+            // exponent.
+            unsigned int half = ((unsigned int)exponent << 10) | (mantissa >> 13);
+            const unsigned int rest = mantissa & 0x1FFF;
+            if (0x1000 < rest || (rest == 0x1000 && (half & 1))) {
+                ++half;
+            }
+            if (0x7C00 <= half) {
+                half = 0x7BFF;
+            }
+            return (unsigned short)(sign | half);
+        }
+    }
+
+    /**
+     * Converts a weight in half precision into single precision.
+     *  This function has no branch so that a loop of conversions is
+     *  vectorized; it does not handle infinity and NaN, which to_half()
+     *  never produces.
+     *  @param  half        The weight in half precision.
+     *  @return float       The weight.
+     */
+    static inline float from_half(unsigned short half)
+    {
+        // Move the exponent and mantissa to the positions of single
+        // precision, and rebias the exponent (by 2^(127-15)), which also
+        // normalizes a subnormal number.
+        const unsigned int bits =
+            ((unsigned int)(half & 0x7FFF) << 13) |
+            ((unsigned int)(half & 0x8000) << 16);
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f * 5.192296858534828e+33f;
+    }
+};
+
+
+
+/**
+ * A writer of binary model files.
+ *
+ *  Insert labels and feature weights to an instance of this class, and
+ *  call save() to write a binary model file that \ref model_file maps into
+ *  memory. The feature names must be unique. Insert the weights of
+ *  attribute-label features with the attributes and label numbers to
+ *  write the rows of the model (the feature name is then the attribute
+ *  and label separated by a TAB character). Call quantize() before save()
+ *  to store the weights in a quantized format.
+ */
+class model_writer : public model_file_format
+{
+protected:
+    /// The model type (e.g., "@classias\tlinear\tbinary").
+    std::string m_type;
+    /// The labels.
+    std::vector<std::string> m_labels;
+    /// The feature names.
+    std::vector<std::string> m_names;
+    /// The feature weights.
+    std::vector<double> m_weights;
+    /// The attributes.
+    std::vector<std::string> m_attributes;
+    /// The attribute numbers of the attribute names.
+    std::map<std::string, int> m_attribute_numbers;
+    /// The attribute numbers of the features.
+    std::vector<int> m_feature_attributes;
+    /// The label numbers of the features.
+    std::vector<int> m_feature_labels;
+    /// The format of the weights.
+    int m_format;
+    /// The number of features sharing a scale of int8 weights.
+    unsigned int m_scale_block;
+
+public:
+    /**
+     * Constructs the object.
+     *  @param  type        The model type, which is identical to the first
+     *                      line of the model file in the text format.
+     */
+    model_writer(const std::string& type)
+        : m_type(type), m_format(WEIGHT_DOUBLE), m_scale_block(0)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~model_writer()
+    {
+    }
+
+    /**
+     * Appends a label.
+     *  @param  label       The label.
+     */
+    void add_label(const std::string& label)
+    {
+        m_labels.push_back(label);
+    }
+
+    /**
+     * Appends a feature weight.
+     *  @param  name        The feature name.
+     *  @param  weight      The feature weight.
+     */
+    void insert(const std::string& name, double weight)
+    {
+        m_names.push_back(name);
+        m_weights.push_back(weight);
+    }
+
+    /**
+     * Appends the weight of an attribute-label feature.
+     *  @param  attribute   The attribute.
+     *  @param  label       The label number (the order of add_label()).
+     *  @param  weight      The feature weight.
+     */
+    void insert(const std::string& attribute, int label, double weight)
+    {
+        std::map<std::string, int>::const_iterator it =
+            m_attribute_numbers.find(attribute);
+        int a = (int)m_attributes.size();
+        if (it != m_attribute_numbers.end()) {
+            a = it->second;
+        } else {
+            m_attribute_numbers.insert(std::make_pair(attribute, a));
+            m_attributes.push_back(attribute);
+        }
+
+        m_feature_attributes.resize(m_names.size(), -1);
+        m_feature_labels.resize(m_names.size(), -1);
+        insert(attribute + '\t' + m_labels[label], weight);
+        m_feature_attributes.push_back(a);
+        m_feature_labels.push_back(label);
+    }
+
+    /**
+     * Sets the format of the weights.
+     *  @param  format      The format of the weights (WEIGHT_*).
+     *  @param  block       The number of features sharing a scale of int8
+     *                      weights (a power of two), or zero to share a
+     *                      scale by the features of a label (the model
+     *                      must have rows).
+     *  @throws model_file_error    If the block size is not a power of two.
+     */
+    void quantize(int format, unsigned int block = 64)
+    {
+        if (format == WEIGHT_INT8 && (block & (block - 1)) != 0) {
+            throw model_file_error("The block size of the scales must be a power of two");
+        }
+        m_format = format;
+        m_scale_block = (format == WEIGHT_INT8 ? block : 0);
+    }
+
+    /**
+     * Writes the model to a file.
+     *  @param  filename    The file name.
+     *  @throws model_file_error    If the file is not writable.
+     */
+    void save(const std::string& filename) const
+    {
+        std::ofstream ofs(filename.c_str(), std::ios::binary);
+        if (ofs.fail()) {
+            throw model_file_error("Failed to open a model file for writing: " + filename);
+        }
+        write(ofs);
+        if (ofs.fail()) {
+            throw model_file_error("Failed to write a model file: " + filename);
+        }
+    }
+
+    /**
+     * Writes the model to a stream.
+     *  @param  os          The output stream (in binary mode), which must
+     *                      be at the beginning.
+     */
+    void write(std::ostream& os) const
+    {
+        const bool rows = !m_attributes.empty();
+        if (rows && (m_feature_attributes.size() != m_names.size() ||
+            std::find(m_feature_attributes.begin(), m_feature_attributes.end(), -1) !=
+            m_feature_attributes.end())) {
+            throw model_file_error("Features without attributes in a model with rows");
+        }
+        if (m_format == WEIGHT_INT8 && m_scale_block == 0 && !rows) {
+            throw model_file_error("The scales of labels require a model with rows");
+        }
+
+        header_type header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, magic(), sizeof(header.magic));
+        header.version = (m_format == WEIGHT_DOUBLE ? MODEL_VERSION : MODEL_VERSION_QUANTIZED);
+        header.byte_order = BYTE_ORDER_MARK;
+        header.num_labels = (unsigned int)m_labels.size();
+        header.num_features = (unsigned int)m_names.size();
+        header.num_buckets = buckets(m_names.size());
+        header.num_attributes = (unsigned int)m_attributes.size();
+        header.attribute_buckets = rows ? buckets(m_attributes.size()) : 0;
+        header.weight_format = (unsigned int)m_format;
+        header.scale_block = m_scale_block;
+
+        // Number the features so that the features of an attribute are
+        // consecutive and sorted by the labels (by stable counting sorts on
+        // the labels and then the attributes).
+        std::vector<unsigned int> row_offsets(m_attributes.size() + 1, 0);
+        std::vector<size_t> order(m_names.size());
+        if (rows) {
+            std::vector<unsigned int> label_offsets(m_labels.size() + 1, 0);
+            for (size_t i = 0;i < m_names.size();++i) {
+                ++label_offsets[m_feature_labels[i]+1];
+                ++row_offsets[m_feature_attributes[i]+1];
+            }
+            for (size_t l = 0;l < m_labels.size();++l) {
+                label_offsets[l+1] += label_offsets[l];
+            }
+            for (size_t a = 0;a < m_attributes.size();++a) {
+                row_offsets[a+1] += row_offsets[a];
+            }
+            std::vector<size_t> by_label(m_names.size());
+            std::vector<unsigned int> next(label_offsets.begin(), label_offsets.end() - 1);
+            for (size_t i = 0;i < m_names.size();++i) {
+                by_label[next[m_feature_labels[i]]++] = i;
+            }
+            next.assign(row_offsets.begin(), row_offsets.end() - 1);
+            for (size_t j = 0;j < m_names.size();++j) {
+                const size_t i = by_label[j];
+                order[next[m_feature_attributes[i]]++] = i;
+            }
+        } else {
+            for (size_t i = 0;i < m_names.size();++i) {
+                order[i] = i;
+            }
+        }
+
+        // Locate the strings.
+        std::vector<entry_type> entries;
+        unsigned long long offset = 0;
+        append_entry(entries, offset, m_type);
+        for (size_t i = 0;i < m_labels.size();++i) {
+            append_entry(entries, offset, m_labels[i]);
+        }
+        for (size_t i = 0;i < m_names.size();++i) {
+            append_entry(entries, offset, m_names[order[i]]);
+        }
+        for (size_t i = 0;i < m_attributes.size();++i) {
+            append_entry(entries, offset, m_attributes[i]);
+        }
+
+        // Build the hash indices of the feature and attribute names.
+        const size_t base = 1 + m_labels.size();
+        std::vector<unsigned int> index =
+            build_index(&entries[0] + base, m_names.size(), header.num_buckets);
+        std::vector<unsigned int> attribute_index =
+            build_index(&entries[0] + base + m_names.size(), m_attributes.size(), header.attribute_buckets);
+
+        // Arrange the weights and labels of the features.
+        std::vector<double> weights(m_names.size());
+        std::vector<unsigned int> labels(rows ? m_names.size() : 0);
+        for (size_t i = 0;i < m_names.size();++i) {
+            weights[i] = m_weights[order[i]];
+            if (rows) {
+                labels[i] = (unsigned int)m_feature_labels[order[i]];
+            }
+        }
+
+        // Quantize the weights.
+        std::vector<unsigned short> halfs;
+        std::vector<signed char> quants;
+        std::vector<float> scales;
+        size_t weight_size = sizeof(double) * weights.size();
+        if (m_format == WEIGHT_FLOAT16) {
+            halfs.resize(weights.size());
+            for (size_t i = 0;i < weights.size();++i) {
+                halfs[i] = to_half(weights[i]);
+            }
+            weight_size = sizeof(unsigned short) * halfs.size();
+        } else if (m_format == WEIGHT_INT8) {
+            quantize_int8(weights, labels, quants, scales);
+            weight_size = sizeof(signed char) * quants.size();
+        }
+
+        // Compute the offsets of the regions.
+        header.entries = align(sizeof(header));
+        header.index = align(header.entries + sizeof(entry_type) * entries.size());
+        header.weights = align(header.index + sizeof(unsigned int) * index.size());
+        header.attribute_index = align(header.weights + weight_size);
+        header.rows = align(header.attribute_index + sizeof(unsigned int) * attribute_index.size());
+        header.feature_labels = align(header.rows + (rows ? sizeof(unsigned int) * row_offsets.size() : 0));
+        unsigned long long end = header.feature_labels + sizeof(unsigned int) * labels.size();
+        if (m_format == WEIGHT_INT8) {
+            header.scales = align(end);
+            end = header.scales + sizeof(float) * scales.size();
+        }
+        header.strings = align(end);
+        header.size = header.strings + offset;
+
+        write_region(os, 0, &header, sizeof(header));
+        write_region(os, header.entries, entries);
+        write_region(os, header.index, index);
+        if (m_format == WEIGHT_FLOAT16) {
+            write_region(os, header.weights, halfs);
+        } else if (m_format == WEIGHT_INT8) {
+            write_region(os, header.weights, quants);
+        } else {
+            write_region(os, header.weights, weights);
+        }
+        if (rows) {
+            write_region(os, header.attribute_index, attribute_index);
+            write_region(os, header.rows, row_offsets);
+            write_region(os, header.feature_labels, labels);
+        }
+        if (m_format == WEIGHT_INT8) {
+            write_region(os, header.scales, scales);
+        }
+        pad(os, header.strings);
+        os << m_type;
+        for (size_t i = 0;i < m_labels.size();++i) {
+            os << m_labels[i];
+        }
+        for (size_t i = 0;i < m_names.size();++i) {
+            os << m_names[order[i]];
+        }
+        for (size_t i = 0;i < m_attributes.size();++i) {
+            os << m_attributes[i];
+        }
+    }
+
+protected:
+    void quantize_int8(
+        const std::vector<double>& weights,
+        const std::vector<unsigned int>& labels,
+        std::vector<signed char>& quants,
+        std::vector<float>& scales
+        ) const
+    {
+        // Find the largest magnitude of the weights sharing a scale.
+        if (m_scale_block == 0) {
+            scales.assign(m_labels.size(), 0.f);
+        } else {
+            scales.assign((weights.size() + m_scale_block - 1) / m_scale_block, 0.f);
+        }
+        std::vector<double> maxima(scales.size(), 0.);
+        for (size_t i = 0;i < weights.size();++i) {
+            const size_t s = (m_scale_block == 0 ? labels[i] : i / m_scale_block);
+            const double w = (weights[i] < 0. ? -weights[i] : weights[i]);
+            if (maxima[s] < w) {
+                maxima[s] = w;
+            }
+        }
+
+        // Map the largest magnitude to 127, and round the weights.
+        for (size_t s = 0;s < scales.size();++s) {
+            scales[s] = (float)(maxima[s] / 127.);
+        }
+        quants.resize(weights.size());
+        for (size_t i = 0;i < weights.size();++i) {
+            const size_t s = (m_scale_block == 0 ? labels[i] : i / m_scale_block);
+            double q = (0.f < scales[s] ? weights[i] / scales[s] : 0.);
+            q = (q < 0. ? q - 0.5 : q + 0.5);
+            if (127. < q) {
+                q = 127.;
+            } else if (q < -127.) {
+                q = -127.;
+            }
+            quants[i] = (signed char)(int)q;
+        }
+    }
+
+    static void append_entry(
+        std::vector<entry_type>& entries,
+        unsigned long long& offset,
+        const std::string& str
+        )
+    {
+        entry_type entry;
+        entry.offset = offset;
+        entry.length = (unsigned int)str.size();
+        entry.hash = hash(str.c_str(), str.size());
+        entries.push_back(entry);
+        offset += str.size();
+    }
+
+    static std::vector<unsigned int> build_index(
+        const entry_type* entries,
+        size_t n,
+        unsigned int num_buckets
+        )
+    {
+        std::vector<unsigned int> index(num_buckets, 0);
+        const unsigned int mask = num_buckets - 1;
+        for (size_t i = 0;i < n;++i) {
+            unsigned int b = entries[i].hash & mask;
+            while (index[b] != 0) {
+                b = (b + 1) & mask;
+            }
+            index[b] = (unsigned int)(i + 1);
+        }
+        return index;
+    }
+
+    static unsigned long long align(unsigned long long offset)
+    {
+        // Align the regions to 64-byte (cache line) boundaries.
+        return (offset + 63) & ~63ULL;
+    }
+
+    static void pad(std::ostream& os, unsigned long long offset)
+    {
+        while ((unsigned long long)os.tellp() < offset) {
+            os.put('\0');
+        }
+    }
+
+    static void write_region(
+        std::ostream& os,
+        unsigned long long offset,
+        const void* data,
+        size_t size
+        )
+    {
+        pad(os, offset);
+        os.write(reinterpret_cast<const char*>(data), size);
+    }
+
+    template <class value_type>
+    static void write_region(
+        std::ostream& os,
+        unsigned long long offset,
+        const std::vector<value_type>& values
+        )
+    {
+        if (!values.empty()) {
+            write_region(os, offset, &values[0], sizeof(value_type) * values.size());
+        }
+    }
+};
+
+
+
+/**
+ * A binary model file mapped into memory.
+ *
+ *  This class maps a binary model file written by \ref model_writer into
+ *  the memory (read only and shared), and looks up feature weights with
+ *  the hash index stored in the file. Opening a model thus takes constant
+ *  time regardless of the number of features; the operating system reads
+ *  the pages of the file on demand, and processes mapping the same model
+ *  file share the pages in the page cache.
+ *
+ *  An instance of this class is usable as a model of the linear
+ *  classifiers, which look up feature weights by feature names with
+ *  operator \c []. The weights in a quantized format are decoded as they
+ *  are read.
+ */
+class model_file : public model_file_format
+{
+public:
+    /// The type of a feature weight.
+    typedef double value_type;
+
+protected:
+    /// The beginning of the memory block mapping the file.
+    const char* m_block;
+    /// The size of the memory block.
+    size_t m_size;
+    /// The header.
+    const header_type* m_header;
+    /// The entries of the strings.
+    const entry_type* m_entries;
+    /// The hash index.
+    const unsigned int* m_index;
+    /// The feature weights (in double precision).
+    const double* m_weights;
+    /// The feature weights (in half precision).
+    const unsigned short* m_halfs;
+    /// The feature weights (in 8-bit integers).
+    const signed char* m_quants;
+    /// The scales of the weights in 8-bit integers.
+    const float* m_scales;
+    /// The format of the weights.
+    unsigned int m_format;
+    /// The shift of a feature number to the number of its scale, or -1 for
+    /// the scales of the labels.
+    int m_scale_shift;
+    /// Whether the features in a row are sorted by the labels.
+    bool m_sorted_rows;
+    /// The string table.
+    const char* m_strings;
+    /// The mask for bucket numbers.
+    unsigned int m_mask;
+    /// The attribute index.
+    const unsigned int* m_attribute_index;
+    /// The rows.
+    const unsigned int* m_rows;
+    /// The feature labels.
+    const unsigned int* m_feature_labels;
+    /// The mask for bucket numbers of the attribute index.
+    unsigned int m_attribute_mask;
+    /// Whether the memory block maps a file.
+    bool m_mapped;
+#ifdef  _WIN32
+    /// The handle of the file mapping.
+    HANDLE m_mapping;
+#endif/*_WIN32*/
+
+public:
+    /**
+     * Constructs the object.
+     */
+    model_file()
+    {
+        reset();
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~model_file()
+    {
+        close();
+    }
+
+    /**
+     * Tests if a file is a binary model file.
+     *  @param  filename    The file name.
+     *  @retval bool        \c true if the file begins with the magic string.
+     */
+    static bool test(const std::string& filename)
+    {
+        char buffer[8];
+        std::ifstream ifs(filename.c_str(), std::ios::binary);
+        ifs.read(buffer, sizeof(buffer));
+        return (
+            !ifs.fail() &&
+            std::memcmp(buffer, magic(), sizeof(buffer)) == 0
+            );
+    }
+
+    /**
+     * Maps a binary model file into the memory.
+     *  @param  filename    The file name.
+     *  @throws model_file_error    If the file is not a valid model file.
+     */
+    void open(const std::string& filename)
+    {
+        close();
+
+#ifdef  _WIN32
+        HANDLE file = CreateFileA(
+            filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw model_file_error("Failed to open a model file: " + filename);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            CloseHandle(file);
+            throw model_file_error("Failed to map a model file: " + filename);
+        }
+        m_mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (m_mapping == NULL) {
+            throw model_file_error("Failed to map a model file: " + filename);
+        }
+        m_block = (const char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        if (m_block == NULL) {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+            throw model_file_error("Failed to map a model file: " + filename);
+        }
+        m_size = (size_t)size.QuadPart;
+#else
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw model_file_error("Failed to open a model file: " + filename);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            throw model_file_error("Failed to map a model file: " + filename);
+        }
+        void* block = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (block == MAP_FAILED) {
+            throw model_file_error("Failed to map a model file: " + filename);
+        }
+        m_block = (const char*)block;
+        m_size = (size_t)st.st_size;
+#endif/*_WIN32*/
+
+        m_mapped = true;
+        locate(filename);
+    }
+
+    /**
+     * Uses a binary model in the memory.
+     *  The memory block (e.g., written by model_writer::write()) must be
+     *  aligned to an 8-byte boundary, and must be kept by the caller until
+     *  this object is closed.
+     *  @param  block       The pointer to the memory block.
+     *  @param  size        The size of the memory block.
+     *  @throws model_file_error    If the block is not a valid model.
+     */
+    void open(const void* block, size_t size)
+    {
+        close();
+        m_block = (const char*)block;
+        m_size = size;
+        locate("(memory)");
+    }
+
+    /**
+     * Unmaps the model file (or releases the model in the memory).
+     */
+    void close()
+    {
+        if (m_block != NULL && m_mapped) {
+#ifdef  _WIN32
+            UnmapViewOfFile(m_block);
+            CloseHandle(m_mapping);
+#else
+            munmap((void*)m_block, m_size);
+#endif/*_WIN32*/
+        }
+        reset();
+    }
+
+    /**
+     * Tests if a model file is mapped.
+     *  @retval bool        \c true if a model file is mapped.
+     */
+    inline bool is_open() const
+    {
+        return m_block != NULL;
+    }
+
+    /**
+     * Returns the model type.
+     *  @return std::string The model type, which is identical to the first
+     *                      line of the model file in the text format.
+     */
+    std::string type() const
+    {
+        return to_string(0);
+    }
+
+    /**
+     * Returns the number of labels.
+     *  @return int         The number of labels.
+     */
+    inline int num_labels() const
+    {
+        return (int)m_header->num_labels;
+    }
+
+    /**
+     * Returns a label.
+     *  @param  i           The label number.
+     *  @return std::string The label.
+     */
+    std::string label(int i) const
+    {
+        return to_string(1 + i);
+    }
+
+    /**
+     * Returns a label without copying it.
+     *  @param  i           The label number.
+     *  @param  length      The variable receiving the length of the label.
+     *  @return const char* The pointer to the label, which is not
+     *                      terminated by a null character.
+     */
+    inline const char* label(int i, size_t& length) const
+    {
+        const entry_type& entry = m_entries[1 + i];
+        length = entry.length;
+        return m_strings + entry.offset;
+    }
+
+    /**
+     * Returns the number of features.
+     *  @return int         The number of features.
+     */
+    inline int num_features() const
+    {
+        return (int)m_header->num_features;
+    }
+
+    /**
+     * Returns the name of a feature.
+     *  @param  i           The feature number.
+     *  @return std::string The feature name.
+     */
+    std::string feature(int i) const
+    {
+        return to_string(1 + m_header->num_labels + i);
+    }
+
+    /**
+     * Returns the weight of a feature.
+     *  @param  i           The feature number.
+     *  @return double      The feature weight.
+     */
+    inline double weight(int i) const
+    {
+        switch (m_format) {
+        case WEIGHT_FLOAT16:
+            return from_half(m_halfs[i]);
+        case WEIGHT_INT8:
+            return m_quants[i] * (double)m_scales[
+                m_scale_shift < 0 ? (int)m_feature_labels[i] : (i >> m_scale_shift)];
+        default:
+            return m_weights[i];
+        }
+    }
+
+    /**
+     * Returns the format of the weights.
+     *  @return int         The format of the weights (WEIGHT_*).
+     */
+    inline int weight_format() const
+    {
+        return (int)m_format;
+    }
+
+    /**
+     * Returns the number of attributes.
+     *  @return int         The number of attributes, which is zero if the
+     *                      model has no row.
+     */
+    inline int num_attributes() const
+    {
+        return (int)m_header->num_attributes;
+    }
+
+    /**
+     * Finds the row of an attribute.
+     *  @param  name        The pointer to the attribute name.
+     *  @param  length      The length of the attribute name.
+     *  @return int         The attribute number, or -1 if the model does
+     *                      not have the attribute.
+     */
+    inline int find_attribute(const char* name, size_t length) const
+    {
+        if (m_attribute_index == NULL) {
+            return -1;
+        }
+        const unsigned int h = hash(name, length);
+        const entry_type* attributes =
+            m_entries + 1 + m_header->num_labels + m_header->num_features;
+        for (unsigned int b = h & m_attribute_mask;m_attribute_index[b] != 0;b = (b + 1) & m_attribute_mask) {
+            const entry_type& entry = attributes[m_attribute_index[b]-1];
+            if (entry.hash == h && entry.length == length &&
+                std::memcmp(m_strings + entry.offset, name, length) == 0) {
+                return (int)(m_attribute_index[b] - 1);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Returns the first feature number in the row of an attribute.
+     *  @param  a           The attribute number.
+     *  @return int         The feature number.
+     */
+    inline int row_begin(int a) const
+    {
+        return (int)m_rows[a];
+    }
+
+    /**
+     * Returns the feature number just beyond the row of an attribute.
+     *  @param  a           The attribute number.
+     *  @return int         The feature number.
+     */
+    inline int row_end(int a) const
+    {
+        return (int)m_rows[a+1];
+    }
+
+    /**
+     * Returns the label number of a feature in a row.
+     *  @param  i           The feature number.
+     *  @return int         The label number.
+     */
+    inline int feature_label(int i) const
+    {
+        return (int)m_feature_labels[i];
+    }
+
+    /**
+     * Adds the weights in the row of an attribute to the label scores.
+     *  @param  scores      The label scores, which implement
+     *                      add(int label, double value).
+     *  @param  a           The attribute number.
+     *  @param  value       The attribute value.
+     */
+    template <class scores_type>
+    inline void add_row(scores_type& scores, int a, double value) const
+    {
+        const int begin = row_begin(a);
+        const int end = row_end(a);
+        if (m_sorted_rows && end - begin == num_labels()) {
+            // The row has the weights of all labels in the order of the
+            // labels, which the compiler adds with SIMD instructions.
+            dense_labels labels = {begin};
+            add_weights(scores, labels, begin, end, value);
+        } else {
+            sparse_labels labels = {m_feature_labels};
+            add_weights(scores, labels, begin, end, value);
+        }
+    }
+
+    /**
+     * Finds a feature.
+     *  @param  name        The pointer to the feature name.
+     *  @param  length      The length of the feature name.
+     *  @return int         The feature number, or -1 if the model does not
+     *                      have the feature.
+     */
+    inline int find(const char* name, size_t length) const
+    {
+        const unsigned int h = hash(name, length);
+        const entry_type* features = m_entries + 1 + m_header->num_labels;
+        for (unsigned int b = h & m_mask;m_index[b] != 0;b = (b + 1) & m_mask) {
+            const entry_type& entry = features[m_index[b]-1];
+            if (entry.hash == h && entry.length == length &&
+                std::memcmp(m_strings + entry.offset, name, length) == 0) {
+                return (int)(m_index[b] - 1);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * Returns the weight of a feature.
+     *  @param  name        The feature name.
+     *  @return double      The feature weight, or zero if the model does
+     *                      not have the feature.
+     */
+    inline double operator[](const std::string& name) const
+    {
+        int i = find(name.c_str(), name.size());
+        return (0 <= i ? weight(i) : 0.);
+    }
+
+protected:
+    struct dense_labels
+    {
+        int begin;
+
+        inline int operator()(int i) const
+        {
+            return i - begin;
+        }
+    };
+
+    struct sparse_labels
+    {
+        const unsigned int* labels;
+
+        inline int operator()(int i) const
+        {
+            return (int)labels[i];
+        }
+    };
+
+    template <class scores_type, class labels_type>
+    inline void add_weights(
+        scores_type& scores,
+        const labels_type& labels,
+        int begin,
+        int end,
+        double value
+        ) const
+    {
+        switch (m_format) {
+        case WEIGHT_FLOAT16:
+            for (int i = begin;i < end;++i) {
+                scores.add(labels(i), from_half(m_halfs[i]) * value);
+            }
+            break;
+        case WEIGHT_INT8:
+            if (m_scale_shift < 0) {
+                for (int i = begin;i < end;++i) {
+                    scores.add(labels(i), m_quants[i] * (m_scales[labels(i)] * value));
+                }
+            } else {
+                // Multiply the integers in a block by the same scale.
+                for (int i = begin;i < end;) {
+                    const int b = i >> m_scale_shift;
+                    const int last = std::min(end, (b + 1) << m_scale_shift);
+                    const double scale = m_scales[b] * value;
+                    for (;i < last;++i) {
+                        scores.add(labels(i), m_quants[i] * scale);
+                    }
+                }
+            }
+            break;
+        default:
+            for (int i = begin;i < end;++i) {
+                scores.add(labels(i), m_weights[i] * value);
+            }
+            break;
+        }
+    }
+
+    void locate(const std::string& filename)
+    {
+        // Validate the header and locate the regions.
+        m_header = (const header_type*)m_block;
+        if (m_size < sizeof(header_type) ||
+            std::memcmp(m_header->magic, magic(), sizeof(m_header->magic)) != 0) {
+            close();
+            throw model_file_error("Not a binary model file: " + filename);
+        }
+        if ((m_header->version != MODEL_VERSION && m_header->version != MODEL_VERSION_QUANTIZED) ||
+            m_header->byte_order != BYTE_ORDER_MARK ||
+            (m_header->version == MODEL_VERSION && m_header->weight_format != WEIGHT_DOUBLE) ||
+            WEIGHT_INT8 < m_header->weight_format) {
+            close();
+            throw model_file_error("Unsupported version or byte order of a binary model file: " + filename);
+        }
+        if (m_header->size != m_size || m_size < m_header->strings ||
+            m_header->num_buckets == 0 ||
+            (m_header->num_buckets & (m_header->num_buckets - 1)) != 0 ||
+            (m_header->attribute_buckets & (m_header->attribute_buckets - 1)) != 0 ||
+            (0 < m_header->num_attributes && m_header->attribute_buckets == 0) ||
+            (m_header->scale_block & (m_header->scale_block - 1)) != 0 ||
+            (m_header->weight_format == WEIGHT_INT8 && m_header->scale_block == 0 &&
+             m_header->num_attributes == 0 && 0 < m_header->num_features) ||
+            !fits_regions()) {
+            close();
+            throw model_file_error("Broken binary model file: " + filename);
+        }
+
+        m_entries = (const entry_type*)(m_block + m_header->entries);
+        m_index = (const unsigned int*)(m_block + m_header->index);
+        m_weights = (const double*)(m_block + m_header->weights);
+        m_halfs = (const unsigned short*)(m_block + m_header->weights);
+        m_quants = (const signed char*)(m_block + m_header->weights);
+        m_scales = (const float*)(m_block + m_header->scales);
+        m_format = m_header->weight_format;
+        m_sorted_rows = (m_header->version == MODEL_VERSION_QUANTIZED);
+        m_scale_shift = -1;
+        if (0 < m_header->scale_block) {
+            m_scale_shift = 0;
+            while ((1U << m_scale_shift) < m_header->scale_block) {
+                ++m_scale_shift;
+            }
+        }
+        m_strings = m_block + m_header->strings;
+        m_mask = m_header->num_buckets - 1;
+        if (0 < m_header->num_attributes) {
+            m_attribute_index = (const unsigned int*)(m_block + m_header->attribute_index);
+            m_rows = (const unsigned int*)(m_block + m_header->rows);
+            m_feature_labels = (const unsigned int*)(m_block + m_header->feature_labels);
+            m_attribute_mask = m_header->attribute_buckets - 1;
+        }
+
+        if (!valid_contents()) {
+            close();
+            throw model_file_error("Broken binary model file: " + filename);
+        }
+    }
+
+    /**
+     * Tests if a region ends before the string table.
+     *  @param  offset      The offset of the region.
+     *  @param  n           The number of elements in the region.
+     *  @param  size        The size of an element.
+     *  @retval bool        \c true if the region fits.
+     */
+    bool fits(unsigned long long offset, unsigned long long n, size_t size) const
+    {
+        return offset <= m_header->strings && n * size <= m_header->strings - offset;
+    }
+
+    /**
+     * Tests if the regions given by the header fit in the file.
+     *  @retval bool        \c true if all regions end before the strings.
+     */
+    bool fits_regions() const
+    {
+        const header_type& h = *m_header;
+        const unsigned long long num_entries =
+            1ULL + h.num_labels + h.num_features + h.num_attributes;
+        size_t weight_size = sizeof(double);
+        if (h.weight_format == WEIGHT_FLOAT16) {
+            weight_size = sizeof(unsigned short);
+        } else if (h.weight_format == WEIGHT_INT8) {
+            weight_size = sizeof(signed char);
+        }
+
+        if (!fits(h.entries, num_entries, sizeof(entry_type)) ||
+            !fits(h.index, h.num_buckets, sizeof(unsigned int)) ||
+            !fits(h.weights, h.num_features, weight_size)) {
+            return false;
+        }
+        if (h.weight_format == WEIGHT_INT8) {
+            const unsigned long long num_scales = (h.scale_block == 0) ?
+                h.num_labels : (h.num_features + h.scale_block - 1ULL) / h.scale_block;
+            if (!fits(h.scales, num_scales, sizeof(float))) {
+                return false;
+            }
+        }
+        if (0 < h.num_attributes) {
+            if (!fits(h.attribute_index, h.attribute_buckets, sizeof(unsigned int)) ||
+                !fits(h.rows, h.num_attributes + 1ULL, sizeof(unsigned int)) ||
+                !fits(h.feature_labels, h.num_features, sizeof(unsigned int))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Tests if the values in the regions refer to valid locations.
+     *  The strings must lie in the string table, the hash indices must
+     *  store valid numbers and an empty bucket (which ends every probe),
+     *  and the rows and feature labels must be in the range.
+     *  @retval bool        \c true if the regions are valid.
+     */
+    bool valid_contents() const
+    {
+        const header_type& h = *m_header;
+        const unsigned long long num_chars = m_size - h.strings;
+        const unsigned long long num_entries =
+            1ULL + h.num_labels + h.num_features + h.num_attributes;
+        for (unsigned long long i = 0;i < num_entries;++i) {
+            const entry_type& entry = m_entries[i];
+            if (num_chars < entry.offset || num_chars - entry.offset < entry.length) {
+                return false;
+            }
+        }
+
+        if (!valid_index(m_index, h.num_buckets, h.num_features)) {
+            return false;
+        }
+        if (0 < h.num_attributes) {
+            if (!valid_index(m_attribute_index, h.attribute_buckets, h.num_attributes)) {
+                return false;
+            }
+            for (unsigned int a = 0;a < h.num_attributes;++a) {
+                if (m_rows[a+1] < m_rows[a]) {
+                    return false;
+                }
+            }
+            if (h.num_features < m_rows[h.num_attributes]) {
+                return false;
+            }
+            for (unsigned int i = 0;i < h.num_features;++i) {
+                if (h.num_labels <= m_feature_labels[i]) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static bool valid_index(
+        const unsigned int* index,
+        unsigned int num_buckets,
+        unsigned int n
+        )
+    {
+        bool empty = false;
+        for (unsigned int b = 0;b < num_buckets;++b) {
+            if (index[b] == 0) {
+                empty = true;
+            } else if (n < index[b]) {
+                return false;
+            }
+        }
+        return empty;
+    }
+
+    void reset()
+    {
+        m_block = NULL;
+        m_size = 0;
+        m_header = NULL;
+        m_entries = NULL;
+        m_index = NULL;
+        m_weights = NULL;
+        m_halfs = NULL;
+        m_quants = NULL;
+        m_scales = NULL;
+        m_format = WEIGHT_DOUBLE;
+        m_scale_shift = -1;
+        m_sorted_rows = false;
+        m_strings = NULL;
+        m_mask = 0;
+        m_attribute_index = NULL;
+        m_rows = NULL;
+        m_feature_labels = NULL;
+        m_attribute_mask = 0;
+        m_mapped = false;
+#ifdef  _WIN32
+        m_mapping = NULL;
+#endif/*_WIN32*/
+    }
+
+    std::string to_string(unsigned int i) const
+    {
+        const entry_type& entry = m_entries[i];
+        return std::string(m_strings + entry.offset, entry.length);
+    }
+
+private:
+    model_file(const model_file&);
+    model_file& operator=(const model_file&);
+};
+
+};
+
+#endif/*__CLASSIAS_MODEL_FILE_H__*/
@@ -0,0 +1,495 @@
+/*
+ *		Predictors of linear models loaded from model files.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_PREDICTOR_H__
+#define __CLASSIAS_PREDICTOR_H__
+
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "model_file.h"
+
+namespace classias
+{
+
+/**
+ * A predictor of a linear model for embedding classification in a program.
+ *
+ *  This class loads a model file written by classias-train, in either the
+ *  text or binary format; a model in the text format is converted into the
+ *  binary format in the memory. The predictor is reused across calls, and
+ *  a prediction allocates no memory: features are given by their numbers
+ *  (interned by feature()) or by their names as raw strings, the feature
+ *  values may be omitted (\c NULL for 1.0), and the scores are written to
+ *  an array prepared by the caller. The prediction functions are constant
+ *  member functions, so multiple threads may share a predictor.
+ *
+ *  The features of the models are as follows:
+ *      - binary: the attributes of an instance. The bias feature
+ *        ("__BIAS__") of the model is included in a score.
+ *      - multi: the attributes of an instance, whose weights for all labels
+ *        are looked up at a time. The bias feature is included in the
+ *        scores.
+ *      - candidate: the attributes of a candidate.
+ */
+class predictor
+{
+public:
+    /// Model types.
+    enum {
+        TYPE_NONE = 0,
+        TYPE_BINARY,
+        TYPE_MULTI,
+        TYPE_CANDIDATE,
+    };
+
+protected:
+    /// The model.
+    model_file m_model;
+    /// The memory block storing a model converted from the text format.
+    std::vector<double> m_image;
+    /// The model type.
+    int m_type;
+    /// The weight of the bias feature (binary).
+    double m_bias;
+    /// The attribute number of the bias feature (multi).
+    int m_bias_attribute;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    predictor() : m_type(TYPE_NONE), m_bias(0.), m_bias_attribute(-1)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~predictor()
+    {
+    }
+
+    /**
+     * Loads a model file.
+     *  @param  filename    The file name of a model in the text or binary
+     *                      format.
+     *  @throws model_file_error    If the model is not loaded.
+     */
+    void open(const std::string& filename)
+    {
+        close();
+
+        if (model_file::test(filename)) {
+            m_model.open(filename);
+        } else {
+            load_text(filename);
+        }
+
+        m_type = parse_type(m_model.type());
+        if (m_type == TYPE_NONE) {
+            close();
+            throw model_file_error("Unknown model type: " + filename);
+        }
+        if (m_type == TYPE_MULTI && m_model.num_attributes() == 0 && 0 < m_model.num_features()) {
+            close();
+            throw model_file_error("The model has no row of attributes: " + filename);
+        }
+
+        // Look up the bias feature in advance.
+        if (m_type == TYPE_BINARY) {
+            m_bias = m_model["__BIAS__"];
+        } else if (m_type == TYPE_MULTI) {
+            m_bias_attribute = m_model.find_attribute("__BIAS__", 8);
+        }
+    }
+
+    /**
+     * Releases the model.
+     */
+    void close()
+    {
+        m_model.close();
+        std::vector<double>().swap(m_image);
+        m_type = TYPE_NONE;
+        m_bias = 0.;
+        m_bias_attribute = -1;
+    }
+
+    /**
+     * Returns the model type.
+     *  @return int         The model type (TYPE_*).
+     */
+    inline int type() const
+    {
+        return m_type;
+    }
+
+    /**
+     * Returns the model in the binary format.
+     *  @return const model_file&   The model, e.g., for converting it
+     *                              into another format.
+     */
+    inline const model_file& model() const
+    {
+        return m_model;
+    }
+
+    /**
+     * Returns the number of labels (multi).
+     *  @return int         The number of labels.
+     */
+    inline int num_labels() const
+    {
+        return m_model.num_labels();
+    }
+
+    /**
+     * Returns a label (multi).
+     *  @param  i           The label number.
+     *  @param  length      The variable receiving the length of the label.
+     *  @return const char* The pointer to the label, which is not
+     *                      terminated by a null character.
+     */
+    inline const char* label(int i, size_t& length) const
+    {
+        return m_model.label(i, length);
+    }
+
+    /**
+     * Interns a feature.
+     *  @param  name        The pointer to the feature name (the attribute
+     *                      name for a multi model).
+     *  @param  length      The length of the feature name.
+     *  @return int         The feature number, or -1 if the model does not
+     *                      have the feature.
+     */
+    inline int feature(const char* name, size_t length) const
+    {
+        if (m_type == TYPE_MULTI) {
+            return m_model.find_attribute(name, length);
+        } else {
+            return m_model.find(name, length);
+        }
+    }
+
+    /**
+     * Computes the score of an instance (binary) or a candidate
+     * (candidate).
+     *  @param  features    The array of feature numbers, where negative
+     *                      numbers are ignored.
+     *  @param  values      The array of feature values, or \c NULL.
+     *  @param  n           The number of features.
+     *  @return double      The score.
+     */
+    inline double score(const int* features, const double* values, size_t n) const
+    {
+        double s = m_bias;
+        for (size_t i = 0;i < n;++i) {
+            if (0 <= features[i]) {
+                s += m_model.weight(features[i]) * (values != NULL ? values[i] : 1.);
+            }
+        }
+        return s;
+    }
+
+    /**
+     * Computes the score of an instance (binary) or a candidate
+     * (candidate) with feature names.
+     *  @param  names       The array of null-terminated feature names.
+     *  @param  values      The array of feature values, or \c NULL.
+     *  @param  n           The number of features.
+     *  @return double      The score.
+     */
+    inline double score(const char* const* names, const double* values, size_t n) const
+    {
+        double s = m_bias;
+        for (size_t i = 0;i < n;++i) {
+            int f = m_model.find(names[i], std::strlen(names[i]));
+            if (0 <= f) {
+                s += m_model.weight(f) * (values != NULL ? values[i] : 1.);
+            }
+        }
+        return s;
+    }
+
+    /**
+     * Computes the scores of the labels for an instance (multi).
+     *  @param  attributes  The array of attribute numbers, where negative
+     *                      numbers are ignored.
+     *  @param  values      The array of attribute values, or \c NULL.
+     *  @param  n           The number of attributes.
+     *  @param  scores      The array receiving the scores of the labels,
+     *                      whose size is num_labels().
+     *  @return int         The label number of the highest score, or -1 if
+     *                      the model has no label.
+     */
+    inline int score_labels(const int* attributes, const double* values, size_t n, double* scores) const
+    {
+        begin_labels(scores);
+        for (size_t i = 0;i < n;++i) {
+            if (0 <= attributes[i]) {
+                add_row(scores, attributes[i], values != NULL ? values[i] : 1.);
+            }
+        }
+        return argmax(scores, num_labels());
+    }
+
+    /**
+     * Computes the scores of the labels for an instance with attribute
+     * names (multi).
+     *  @param  attributes  The array of null-terminated attribute names.
+     *  @param  values      The array of attribute values, or \c NULL.
+     *  @param  n           The number of attributes.
+     *  @param  scores      The array receiving the scores of the labels,
+     *                      whose size is num_labels().
+     *  @return int         The label number of the highest score, or -1 if
+     *                      the model has no label.
+     */
+    inline int score_labels(const char* const* attributes, const double* values, size_t n, double* scores) const
+    {
+        begin_labels(scores);
+        for (size_t i = 0;i < n;++i) {
+            int a = m_model.find_attribute(attributes[i], std::strlen(attributes[i]));
+            if (0 <= a) {
+                add_row(scores, a, values != NULL ? values[i] : 1.);
+            }
+        }
+        return argmax(scores, num_labels());
+    }
+
+    /**
+     * Computes the scores of the candidates of an instance (candidate).
+     *  @param  features    The array of feature numbers of all candidates.
+     *  @param  values      The array of feature values, or \c NULL.
+     *  @param  offsets     The array of the offsets of the candidates in
+     *                      features, whose size is num_candidates + 1.
+     *  @param  num_candidates  The number of candidates.
+     *  @param  scores      The array receiving the scores of the
+     *                      candidates.
+     *  @return int         The candidate number of the highest score, or
+     *                      -1 if no candidate is given.
+     */
+    inline int score_candidates(
+        const int* features,
+        const double* values,
+        const size_t* offsets,
+        size_t num_candidates,
+        double* scores
+        ) const
+    {
+        for (size_t i = 0;i < num_candidates;++i) {
+            scores[i] = score(
+                features + offsets[i],
+                values != NULL ? values + offsets[i] : NULL,
+                offsets[i+1] - offsets[i]
+                );
+        }
+        return argmax(scores, (int)num_candidates);
+    }
+
+    /**
+     * Returns the index of the highest score.
+     *  @param  scores      The array of scores.
+     *  @param  n           The number of scores.
+     *  @return int         The index of the first highest score, or -1 if
+     *                      n is zero.
+     */
+    static inline int argmax(const double* scores, int n)
+    {
+        int k = (0 < n) ? 0 : -1;
+        for (int i = 1;i < n;++i) {
+            if (scores[k] < scores[i]) {
+                k = i;
+            }
+        }
+        return k;
+    }
+
+    /**
+     * Converts a score into a probability with the logistic function
+     * (binary).
+     *  @param  score       The score.
+     *  @return double      The probability.
+     */
+    static inline double logistic(double score)
+    {
+        return 1. / (1. + std::exp(-score));
+    }
+
+    /**
+     * Converts scores into probabilities with the softmax function (multi
+     * and candidate).
+     *  @param  scores      The array of scores, which receives the
+     *                      probabilities.
+     *  @param  n           The number of scores.
+     */
+    static inline void softmax(double* scores, int n)
+    {
+        int k = argmax(scores, n);
+        if (k < 0) {
+            return;
+        }
+        const double m = scores[k];
+        double sum = 0.;
+        for (int i = 0;i < n;++i) {
+            scores[i] = std::exp(scores[i] - m);
+            sum += scores[i];
+        }
+        for (int i = 0;i < n;++i) {
+            scores[i] /= sum;
+        }
+    }
+
+protected:
+    inline void begin_labels(double* scores) const
+    {
+        for (int l = 0;l < num_labels();++l) {
+            scores[l] = 0.;
+        }
+        if (0 <= m_bias_attribute) {
+            add_row(scores, m_bias_attribute, 1.);
+        }
+    }
+
+    struct score_array
+    {
+        double* scores;
+
+        inline void add(int l, double value)
+        {
+            scores[l] += value;
+        }
+    };
+
+    inline void add_row(double* scores, int a, double value) const
+    {
+        score_array sa = {scores};
+        m_model.add_row(sa, a, value);
+    }
+
+    static int parse_type(const std::string& type)
+    {
+        if (type == "@classias\tlinear\tbinary") {
+            return TYPE_BINARY;
+        } else if (type == "@classias\tlinear\tmulti\tsparse" ||
+            type == "@classias\tlinear\tmulti\tdense") {
+            return TYPE_MULTI;
+        } else if (type == "@classias\tlinear\tcandidate") {
+            return TYPE_CANDIDATE;
+        } else {
+            return TYPE_NONE;
+        }
+    }
+
+    void load_text(const std::string& filename)
+    {
+        std::ifstream ifs(filename.c_str());
+        if (ifs.fail()) {
+            throw model_file_error("Failed to open a model file: " + filename);
+        }
+
+        std::string line;
+        std::getline(ifs, line);
+        const int type = parse_type(line);
+        if (type == TYPE_NONE) {
+            throw model_file_error("Unknown model type: " + filename);
+        }
+
+        model_writer writer(line);
+        std::map<std::string, int> labels;
+        for (;;) {
+            std::getline(ifs, line);
+            if (ifs.eof()) {
+                break;
+            }
+
+            // Labels of a multi model.
+            if (line.compare(0, 7, "@label\t") == 0) {
+                const int l = (int)labels.size();
+                labels.insert(std::make_pair(line.substr(7), l));
+                writer.add_label(line.substr(7));
+                continue;
+            }
+            if (line.compare(0, 1, "@") == 0) {
+                continue;
+            }
+
+            std::string::size_type pos = line.find('\t');
+            if (pos == line.npos || pos + 1 == line.size()) {
+                throw model_file_error("Broken feature weight in a model file: " + line);
+            }
+            double w = std::atof(line.c_str());
+
+            if (type == TYPE_MULTI) {
+                // Split the feature name into the attribute and label.
+                std::string::size_type sep = line.rfind('\t');
+                if (sep <= pos) {
+                    throw model_file_error("Label is missing in a model file: " + line);
+                }
+                std::map<std::string, int>::const_iterator it =
+                    labels.find(line.substr(sep+1));
+                if (it == labels.end()) {
+                    // Ignore a feature of a label not listed in the model.
+                    continue;
+                }
+                writer.insert(line.substr(pos+1, sep-pos-1), it->second, w);
+            } else {
+                writer.insert(line.substr(pos+1), w);
+            }
+        }
+
+        // Convert the model into the binary format in the memory.
+        std::ostringstream oss(std::ios::binary);
+        writer.write(oss);
+        const std::string image = oss.str();
+        m_image.resize((image.size() + sizeof(double) - 1) / sizeof(double));
+        std::memcpy(&m_image[0], image.data(), image.size());
+        m_model.open(&m_image[0], image.size());
+    }
+
+private:
+    predictor(const predictor&);
+    predictor& operator=(const predictor&);
+};
+
+};
+
+#endif/*__CLASSIAS_PREDICTOR_H__*/
@@ -33,6 +33,7 @@
 #ifndef __CLASSIAS_QUARK_H__
 #define __CLASSIAS_QUARK_H__
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
@@ -282,6 +283,46 @@ public:
             throw quark_error("Unknown inverse mapping");
         }
     }
+
+    /**
+     * Reassigns the unique identifiers by using a map.
+     *  This function associates every item with the new identifier
+     *  map[v] for its current identifier v, and removes items whose
+     *  identifiers are mapped to negative values. The map must assign the
+     *  remaining items to distinct identifiers in [0, n), where n is the
+     *  number of the remaining items.
+     *  @param  map             The map from old identifiers to new ones.
+     */
+    template <class map_type>
+    void remap(const map_type& map)
+    {
+        value_type n = 0;
+        for (value_type v = 0;v < m_inv.size();++v) {
+            if (0 <= map[v]) {
+                ++n;
+            }
+        }
+
+        // Update the forward mapping in place to avoid rehashing items.
+        typename forward_map_type::iterator it = m_fwd.begin();
+        while (it != m_fwd.end()) {
+            if (0 <= map[it->second]) {
+                it->second = map[it->second];
+                ++it;
+            } else {
+                m_fwd.erase(it++);
+            }
+        }
+
+        // Move the items to their new positions in the inverse mapping.
+        inverse_map_type inv(n);
+        for (value_type v = 0;v < m_inv.size();++v) {
+            if (0 <= map[v]) {
+                std::swap(inv[map[v]], m_inv[v]);
+            }
+        }
+        m_inv.swap(inv);
+    }
 };
 
 
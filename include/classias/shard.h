@@ -0,0 +1,728 @@
+/*
+ *		Out-of-core storage of data sets.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_SHARD_H__
+#define __CLASSIAS_SHARD_H__
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef  _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif/*_WIN32*/
+
+#include "instance.h"
+#include "thread.h"
+
+namespace classias
+{
+
+/**
+ * Exception class for \ref sharded_data.
+ */
+class shard_error : public std::runtime_error
+{
+public:
+    /**
+     * Constructs an exception object.
+     *  @param  msg         The error message.
+     */
+    explicit shard_error(const std::string& msg)
+        : std::runtime_error(msg)
+    {
+    }
+};
+
+
+
+/**
+ * Writes a value in the native binary representation.
+ *  @param  os          The output stream.
+ *  @param  value       The value.
+ */
+template <class value_type>
+inline void write_value(std::ostream& os, const value_type& value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * Reads a value in the native binary representation.
+ *  @param  is          The input stream.
+ *  @param  value       The value receiving the value read.
+ */
+template <class value_type>
+inline void read_value(std::istream& is, value_type& value)
+{
+    is.read(reinterpret_cast<char*>(&value), sizeof(value));
+}
+
+/**
+ * Writes the (identifier, value) pairs of a sparse vector.
+ *  @param  os          The output stream.
+ *  @param  v           The sparse vector (either a \ref sparse_vector_base
+ *                      or a \ref compressed_sparse_vector_base).
+ */
+template <class vector_type>
+inline void write_vector(std::ostream& os, const vector_type& v)
+{
+    typedef typename vector_type::identifier_type identifier_type;
+    typedef typename vector_type::value_type value_type;
+
+    write_value(os, (unsigned int)v.size());
+    for (typename vector_type::const_iterator it = v.begin();it != v.end();++it) {
+        write_value(os, (identifier_type)it->first);
+        write_value(os, (value_type)it->second);
+    }
+}
+
+/**
+ * Reads (identifier, value) pairs and appends them to a sparse vector.
+ *  @param  is          The input stream.
+ *  @param  v           The sparse vector.
+ */
+template <class vector_type>
+inline void read_vector(std::istream& is, vector_type& v)
+{
+    unsigned int n = 0;
+    typename vector_type::identifier_type id;
+    typename vector_type::value_type value;
+
+    read_value(is, n);
+    for (unsigned int i = 0;i < n && is;++i) {
+        read_value(is, id);
+        read_value(is, value);
+        v.append(id, value);
+    }
+}
+
+/**
+ * Writes a binary instance.
+ *  @param  os          The output stream.
+ *  @param  inst        The instance.
+ */
+template <class features_tmpl, class weight_tmpl, class group_tmpl>
+inline void write_instance(
+    std::ostream& os,
+    const binary_instance_base<features_tmpl, weight_tmpl, group_tmpl>& inst
+    )
+{
+    write_value(os, (char)(inst.get_label() ? 1 : 0));
+    write_value(os, inst.get_weight());
+    write_value(os, inst.get_group());
+    write_vector(os, inst);
+}
+
+/**
+ * Reads a binary instance.
+ *  @param  is          The input stream.
+ *  @param  inst        The (empty) instance receiving the instance read.
+ */
+template <class features_tmpl, class weight_tmpl, class group_tmpl>
+inline void read_instance(
+    std::istream& is,
+    binary_instance_base<features_tmpl, weight_tmpl, group_tmpl>& inst
+    )
+{
+    char label = 0;
+    typename weight_tmpl::weight_type weight = 1.;
+    int group = 0;
+
+    read_value(is, label);
+    read_value(is, weight);
+    read_value(is, group);
+    inst.set_label(label != 0);
+    inst.set_weight(weight);
+    inst.set_group(group);
+    read_vector(is, inst);
+}
+
+/**
+ * Writes a multi-class instance.
+ *  @param  os          The output stream.
+ *  @param  inst        The instance.
+ */
+template <class attributes_tmpl, class weight_tmpl, class group_tmpl>
+inline void write_instance(
+    std::ostream& os,
+    const multi_instance_base<attributes_tmpl, weight_tmpl, group_tmpl>& inst
+    )
+{
+    write_value(os, inst.get_label());
+    write_value(os, inst.get_weight());
+    write_value(os, inst.get_group());
+    write_vector(os, inst);
+}
+
+/**
+ * Reads a multi-class instance.
+ *  @param  is          The input stream.
+ *  @param  inst        The (empty) instance receiving the instance read.
+ */
+template <class attributes_tmpl, class weight_tmpl, class group_tmpl>
+inline void read_instance(
+    std::istream& is,
+    multi_instance_base<attributes_tmpl, weight_tmpl, group_tmpl>& inst
+    )
+{
+    int label = -1;
+    typename weight_tmpl::weight_type weight = 1.;
+    int group = 0;
+
+    read_value(is, label);
+    read_value(is, weight);
+    read_value(is, group);
+    inst.set_label(label);
+    inst.set_weight(weight);
+    inst.set_group(group);
+    read_vector(is, inst);
+}
+
+/**
+ * Writes a candidate instance.
+ *  @param  os          The output stream.
+ *  @param  inst        The instance.
+ */
+template <class attributes_tmpl, class weight_tmpl, class group_tmpl>
+inline void write_instance(
+    std::ostream& os,
+    const candidate_instance_base<attributes_tmpl, weight_tmpl, group_tmpl>& inst
+    )
+{
+    typedef candidate_instance_base<attributes_tmpl, weight_tmpl, group_tmpl>
+        instance_type;
+
+    write_value(os, inst.get_label());
+    write_value(os, inst.get_weight());
+    write_value(os, inst.get_group());
+    write_value(os, (unsigned int)inst.size());
+    for (typename instance_type::const_iterator it = inst.begin();it != inst.end();++it) {
+        write_vector(os, *it);
+    }
+}
+
+/**
+ * Reads a candidate instance.
+ *  @param  is          The input stream.
+ *  @param  inst        The (empty) instance receiving the instance read.
+ */
+template <class attributes_tmpl, class weight_tmpl, class group_tmpl>
+inline void read_instance(
+    std::istream& is,
+    candidate_instance_base<attributes_tmpl, weight_tmpl, group_tmpl>& inst
+    )
+{
+    int label = -1;
+    typename weight_tmpl::weight_type weight = 1.;
+    int group = 0;
+    unsigned int n = 0;
+
+    read_value(is, label);
+    read_value(is, weight);
+    read_value(is, group);
+    read_value(is, n);
+    for (unsigned int i = 0;i < n && is;++i) {
+        read_vector(is, inst.new_element());
+    }
+    inst.set_label(label);
+    inst.set_weight(weight);
+    inst.set_group(group);
+}
+
+
+
+/**
+ * A data set whose instances are spilled to shard files on a disk.
+ *
+ *  This class extends a data set class (data_tmpl) so that a data set
+ *  larger than the main memory can be used for training. While reading the
+ *  data, new_element() writes the instances buffered in the memory to a
+ *  new shard file (in a native binary format) whenever the buffer reaches
+ *  the shard size; call flush() after reading the data to write the rest.
+ *  The quarks and the feature generator of the data set stay in the memory
+ *  as usual, and so do the instances in the holdout group so that holdout
+ *  evaluations can access them directly.
+ *
+ *  Hence, size() and empty() count all of the instances in the data set,
+ *  whereas begin() and end() iterate over the instances in the memory
+ *  (i.e., the holdout instances) only. Use \ref reader to iterate over the
+ *  instances in the shards; it reads the next shard in a background thread
+ *  while the caller processes the current one.
+ *
+ *  @param  data_tmpl       The type of a data set.
+ */
+template <
+    class data_tmpl
+>
+class sharded_data : public data_tmpl
+{
+public:
+    /// The type of the base data set.
+    typedef data_tmpl base_type;
+    /// The type of an instance.
+    typedef typename base_type::instance_type instance_type;
+    /// A type providing a container of instances.
+    typedef typename base_type::instances_type instances_type;
+    /// A type counting the number of instances.
+    typedef typename base_type::size_type size_type;
+    /// A type providing a random-access iterator.
+    typedef typename base_type::iterator iterator;
+    /// A type providing a read-only random-access iterator.
+    typedef typename base_type::const_iterator const_iterator;
+
+protected:
+    /// The directory where shard files are created.
+    std::string m_directory;
+    /// The maximum number of instances in a shard.
+    size_type m_shard_size;
+    /// The number of groups assigned to instances in turn (0: disabled).
+    int m_split;
+    /// The group number of the instances kept in the memory.
+    int m_holdout;
+    /// The number of instances assigned to groups so far.
+    size_type m_num_assigned;
+    /// The number of instances kept in the memory.
+    size_type m_num_kept;
+    /// The number of instances in the shards.
+    size_type m_num_spilled;
+    /// The file names of the shards.
+    std::vector<std::string> m_files;
+    /// The numbers of instances in the shards.
+    std::vector<size_type> m_sizes;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    sharded_data()
+        : m_directory("."), m_shard_size(100000), m_split(0), m_holdout(-1),
+        m_num_assigned(0), m_num_kept(0), m_num_spilled(0)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     *  This function removes the shard files.
+     */
+    virtual ~sharded_data()
+    {
+        for (size_t i = 0;i < m_files.size();++i) {
+            std::remove(m_files[i].c_str());
+        }
+    }
+
+    /**
+     * Sets the directory and size of shards.
+     *  @param  directory   The directory where shard files are created.
+     *  @param  shard_size  The maximum number of instances in a shard.
+     */
+    void set_storage(const std::string& directory, size_type shard_size)
+    {
+        m_directory = directory;
+        m_shard_size = (0 < shard_size ? shard_size : 1);
+    }
+
+    /**
+     * Assigns group numbers to instances in turn.
+     *  Since the instances are spilled while reading the data, this class
+     *  assigns the group number (i % split) to the i-th instance before
+     *  spilling it.
+     *  @param  split       The number of groups (0 to keep the group numbers
+     *                      set by the caller).
+     */
+    void set_split(int split)
+    {
+        m_split = split;
+    }
+
+    /**
+     * Sets the group number of the instances kept in the memory.
+     *  @param  holdout     The group number for holdout evaluations (-1 to
+     *                      spill all of the instances).
+     */
+    void set_holdout(int holdout)
+    {
+        m_holdout = holdout;
+    }
+
+    /**
+     * Tests if the data is empty.
+     *  @retval bool        \c true if the data (including the instances in
+     *                      the shards) is empty, \c false otherwise.
+     */
+    inline bool empty() const
+    {
+        return base_type::empty() && m_num_spilled == 0;
+    }
+
+    /**
+     * Returns the number of instances in the data.
+     *  @retval size_type   The number of instances including the ones in
+     *                      the shards.
+     */
+    inline size_type size() const
+    {
+        return base_type::size() + m_num_spilled;
+    }
+
+    /**
+     * Creates and returns a new instance.
+     *  This function spills the buffered instances to a new shard first if
+     *  the buffer is full.
+     *  @retval instance_type&  The reference to the new instance.
+     */
+    inline instance_type& new_element()
+    {
+        if (m_shard_size <= base_type::size() - m_num_kept) {
+            spill();
+        }
+        return base_type::new_element();
+    }
+
+    /**
+     * Spills the buffered instances to a new shard.
+     *  Call this function after reading the data.
+     */
+    void flush()
+    {
+        spill();
+    }
+
+    /**
+     * Returns the number of shards.
+     *  @return size_t      The number of shards.
+     */
+    size_t num_shards() const
+    {
+        return m_files.size();
+    }
+
+    /**
+     * Returns the file name of a shard.
+     *  @param  i           The index of the shard.
+     *  @return const std::string&  The file name.
+     */
+    const std::string& shard_file(size_t i) const
+    {
+        return m_files[i];
+    }
+
+    /**
+     * Returns the number of instances in a shard.
+     *  @param  i           The index of the shard.
+     *  @return size_type   The number of instances.
+     */
+    size_type shard_size(size_t i) const
+    {
+        return m_sizes[i];
+    }
+
+    /**
+     * Reads the instances in a shard.
+     *  @param  i           The index of the shard.
+     *  @param  instances   The container receiving the instances.
+     *  @return bool        \c true if the shard was read successfully.
+     */
+    bool load(size_t i, instances_type& instances) const
+    {
+        std::vector<char> buffer(1 << 20);
+        std::ifstream ifs;
+        ifs.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+        ifs.open(m_files[i].c_str(), std::ios::in | std::ios::binary);
+
+        instances.clear();
+        instances.resize(m_sizes[i]);
+        for (size_type j = 0;j < m_sizes[i] && ifs;++j) {
+            read_instance(ifs, instances[j]);
+        }
+        return !ifs.fail();
+    }
+
+    /**
+     * Generates features for pairs of attributes and labels.
+     *  In addition to the instances in the memory, this function reads the
+     *  shards to register the features occurring in them. This function is
+     *  available only for multi-class data sets.
+     *  @param  min_count   The minimum number of occurrences of a pair of
+     *                      an attribute and label (in the memory).
+     *  @return int         The number of the pairs removed.
+     */
+    int generate_features(int min_count = 1)
+    {
+        int removed = base_type::generate_features(min_count);
+
+        if (this->feature_generator.needs_registration()) {
+            instances_type instances;
+            for (size_t i = 0;i < m_files.size();++i) {
+                if (!load(i, instances)) {
+                    throw shard_error("Failed to read a shard: " + m_files[i]);
+                }
+                typename instances_type::const_iterator iti;
+                for (iti = instances.begin();iti != instances.end();++iti) {
+                    typename instance_type::const_iterator it;
+                    for (it = iti->begin();it != iti->end();++it) {
+                        this->feature_generator.regist(it->first, iti->get_label());
+                    }
+                }
+            }
+        }
+
+        return removed;
+    }
+
+protected:
+    /**
+     * Writes the buffered instances (except for holdout ones) to a shard.
+     */
+    void spill()
+    {
+        instances_type& instances = this->instances;
+        if (instances.size() <= m_num_kept) {
+            return;
+        }
+
+        // Create a new shard file.
+        std::string file = create_file();
+        std::vector<char> buffer(1 << 20);
+        std::ofstream ofs;
+        ofs.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+        ofs.open(file.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        m_files.push_back(file);
+        m_sizes.push_back(0);
+
+        // Write the instances, moving the holdout ones to the front.
+        size_type m = m_num_kept;
+        for (size_type i = m_num_kept;i < instances.size();++i) {
+            if (0 < m_split) {
+                instances[i].set_group((int)(m_num_assigned++ % m_split));
+            }
+            if (instances[i].get_group() == m_holdout) {
+                if (m != i) {
+                    std::swap(instances[m], instances[i]);
+                }
+                ++m;
+            } else {
+                write_instance(ofs, instances[i]);
+                ++m_sizes.back();
+            }
+        }
+        ofs.close();
+        if (ofs.fail()) {
+            throw shard_error("Failed to write a shard: " + file);
+        }
+        m_num_spilled += m_sizes.back();
+
+        // Discard the shard if it is empty.
+        if (m_sizes.back() == 0) {
+            std::remove(file.c_str());
+            m_files.pop_back();
+            m_sizes.pop_back();
+        }
+
+        // Keep the holdout instances only.
+        instances.erase(instances.begin() + m, instances.end());
+        m_num_kept = m;
+    }
+
+    /**
+     * Creates a new file with a unique name in the directory.
+     *  @return std::string The file name.
+     */
+    std::string create_file() const
+    {
+        std::string path = m_directory;
+        if (!path.empty() && path[path.size()-1] != '/') {
+            path += '/';
+        }
+        path += "classias-shard-XXXXXX";
+        std::vector<char> name(path.begin(), path.end());
+        name.push_back(0);
+
+#ifdef  _WIN32
+        if (_mktemp_s(&name[0], name.size()) != 0) {
+            throw shard_error("Failed to create a shard in: " + m_directory);
+        }
+#else
+        int fd = mkstemp(&name[0]);
+        if (fd == -1) {
+            throw shard_error("Failed to create a shard in: " + m_directory);
+        }
+        close(fd);
+#endif/*_WIN32*/
+
+        return std::string(&name[0]);
+    }
+
+private:
+    sharded_data(const sharded_data&);
+    sharded_data& operator=(const sharded_data&);
+
+public:
+    /**
+     * A reader of the instances in the shards.
+     *
+     *  This class reads the shards one by one in the order given by the
+     *  constructor. The instances of the current shard are accessible with
+     *  begin() and end(), while a background thread reads the next shard
+     *  (read-ahead). Call next() to move to the next shard.
+     */
+    class reader
+    {
+    protected:
+        /// The data set.
+        const sharded_data* m_data;
+        /// Whether the shards and the instances in them are shuffled.
+        bool m_shuffle;
+        /// The order of the shards.
+        std::vector<size_t> m_order;
+        /// The position (in m_order) of the shard being read ahead.
+        size_t m_pos;
+        /// The instances in the current shard.
+        instances_type m_current;
+        /// The instances in the shard being read ahead.
+        instances_type m_ahead;
+        /// Whether the shard being read ahead was read successfully.
+        bool m_ok;
+        /// The thread reading ahead.
+        thread m_thread;
+
+    public:
+        /**
+         * Constructs the object and starts reading the first shard.
+         *  @param  data        The data set.
+         *  @param  shuffle     \c true to shuffle the order of the shards
+         *                      and the instances in every shard.
+         */
+        reader(const sharded_data& data, bool shuffle)
+            : m_data(&data), m_shuffle(shuffle), m_pos(0), m_ok(true)
+        {
+            for (size_t i = 0;i < data.num_shards();++i) {
+                m_order.push_back(i);
+            }
+            if (m_shuffle) {
+                std::random_shuffle(m_order.begin(), m_order.end());
+            }
+            read_ahead();
+        }
+
+        /**
+         * Destructs the object.
+         */
+        virtual ~reader()
+        {
+            m_thread.join();
+        }
+
+        /**
+         * Moves to the next shard.
+         *  @return bool        \c true if the next shard is available,
+         *                      \c false if all shards have been read.
+         *  @throws shard_error.
+         */
+        bool next()
+        {
+            m_thread.join();
+            if (m_order.size() <= m_pos) {
+                m_current.clear();
+                return false;
+            }
+            if (!m_ok) {
+                throw shard_error(
+                    "Failed to read a shard: " + m_data->shard_file(m_order[m_pos]));
+            }
+
+            m_current.swap(m_ahead);
+            ++m_pos;
+            read_ahead();
+
+            if (m_shuffle) {
+                std::random_shuffle(m_current.begin(), m_current.end());
+            }
+            return true;
+        }
+
+        /**
+         * Returns a random-access iterator to the first instance.
+         *  @retval const_iterator  The iterator to the first instance in
+         *                          the current shard.
+         */
+        const_iterator begin() const
+        {
+            return m_current.begin();
+        }
+
+        /**
+         * Returns a random-access iterator pointing just beyond the last
+         * instance.
+         *  @retval const_iterator  The iterator to the end of the current
+         *                          shard.
+         */
+        const_iterator end() const
+        {
+            return m_current.end();
+        }
+
+    protected:
+        /**
+         * Starts reading the next shard in the background.
+         */
+        void read_ahead()
+        {
+            if (m_pos < m_order.size()) {
+                // Read synchronously when a thread is unavailable.
+                if (!m_thread.start(__read, this)) {
+                    __read(this);
+                }
+            }
+        }
+
+        static void __read(void *inst)
+        {
+            reader* pt = reinterpret_cast<reader*>(inst);
+            pt->m_ok = pt->m_data->load(pt->m_order[pt->m_pos], pt->m_ahead);
+        }
+
+    private:
+        reader(const reader&);
+        reader& operator=(const reader&);
+    };
+};
+
+};
+
+#endif/*__CLASSIAS_SHARD_H__*/
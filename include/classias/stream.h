@@ -0,0 +1,400 @@
+/*
+ *		Streaming of instances between threads.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_STREAM_H__
+#define __CLASSIAS_STREAM_H__
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "thread.h"
+
+namespace classias
+{
+
+/**
+ * Exception class for \ref streaming_data.
+ */
+class stream_error : public std::runtime_error
+{
+public:
+    /**
+     * Constructs an exception object.
+     *  @param  msg         The error message.
+     */
+    explicit stream_error(const std::string& msg)
+        : std::runtime_error(msg)
+    {
+    }
+};
+
+
+
+/**
+ * A bounded lock-free ring buffer for a single producer and consumer.
+ *
+ *  This class preallocates a power-of-two number of slots. A producer
+ *  thread obtains a free slot with acquire(), fills it, and publishes it
+ *  with commit(); a consumer thread obtains the oldest published slot with
+ *  front(), processes it, and returns it with pop(). A slot is reused
+ *  without being destroyed, so that the memory reserved by the object in a
+ *  slot (e.g., the vector of attributes) is recycled.
+ *
+ *  @param  value_tmpl      The type of a slot.
+ */
+template <
+    class value_tmpl
+>
+class ring_buffer
+{
+public:
+    /// The type of a slot.
+    typedef value_tmpl value_type;
+
+protected:
+    /// The slots.
+    std::vector<value_type> m_slots;
+    /// The mask for slot indices.
+    size_t m_mask;
+    /// The padding to avoid false sharing of the indices.
+    char m_pad0[64];
+    /// The number of slots popped by the consumer.
+    volatile size_t m_head;
+    /// The padding to avoid false sharing of the indices.
+    char m_pad1[64];
+    /// The number of slots committed by the producer.
+    volatile size_t m_tail;
+    /// The padding to avoid false sharing of the indices.
+    char m_pad2[64];
+
+public:
+    /**
+     * Constructs the object.
+     *  @param  capacity    The minimum number of slots.
+     */
+    ring_buffer(size_t capacity = 1024) : m_head(0), m_tail(0)
+    {
+        reserve(capacity);
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~ring_buffer()
+    {
+    }
+
+    /**
+     * Reallocates the slots.
+     *  Call this function only when neither thread uses the buffer.
+     *  @param  capacity    The minimum number of slots.
+     */
+    void reserve(size_t capacity)
+    {
+        size_t n = 1;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        m_slots.assign(n, value_type());
+        m_mask = n - 1;
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    /**
+     * Returns the number of slots.
+     *  @return size_t      The number of slots.
+     */
+    size_t capacity() const
+    {
+        return m_slots.size();
+    }
+
+    /**
+     * Obtains a free slot (for the producer).
+     *  @return value_type* The pointer to the free slot, or \c NULL if all
+     *                      slots are occupied.
+     */
+    value_type* acquire()
+    {
+        const size_t tail = m_tail;
+        if (tail - load_acquire(m_head) == m_slots.size()) {
+            return NULL;
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    /**
+     * Publishes the slot obtained by acquire() (for the producer).
+     */
+    void commit()
+    {
+        store_release(m_tail, m_tail + 1);
+    }
+
+    /**
+     * Obtains the oldest published slot (for the consumer).
+     *  @return value_type* The pointer to the slot, or \c NULL if no slot
+     *                      has been published.
+     */
+    value_type* front()
+    {
+        const size_t head = m_head;
+        if (load_acquire(m_tail) == head) {
+            return NULL;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    /**
+     * Returns the slot obtained by front() to the producer (for the
+     * consumer).
+     */
+    void pop()
+    {
+        store_release(m_head, m_head + 1);
+    }
+
+    /**
+     * Waits for a while before retrying an operation on the buffer.
+     *  This function yields the processor for the first retries, and then
+     *  sleeps for a millisecond so that a waiting thread does not occupy a
+     *  processor while the other thread is blocked (e.g., on a pipe).
+     *  @param  retries     The number of retries so far, incremented by
+     *                      this function.
+     */
+    static void backoff(int& retries)
+    {
+        if (++retries < 64) {
+            thread::yield();
+        } else {
+            thread::sleep(1);
+        }
+    }
+
+private:
+    ring_buffer(const ring_buffer&);
+    ring_buffer& operator=(const ring_buffer&);
+};
+
+
+
+/**
+ * A data set streaming instances from a reader to a training thread.
+ *
+ *  This class extends a data set class (data_tmpl) for online training
+ *  that never stores the whole data set. A reader thread creates instances
+ *  with new_element() as it does for a data set in the memory, but the
+ *  instances are slots of a \ref ring_buffer: new_element() publishes the
+ *  previous instance to the training thread and waits for a free slot if
+ *  the training thread lags behind. The training thread obtains published
+ *  instances with front() and returns them with pop().
+ *
+ *  The quarks of the data set grow in the reader thread; the training
+ *  thread must not access them until the reader thread finishes. Likewise,
+ *  the feature generator belongs to the training thread.
+ *
+ *  @param  data_tmpl       The type of a data set.
+ */
+template <
+    class data_tmpl
+>
+class streaming_data : public data_tmpl
+{
+public:
+    /// The type of the base data set.
+    typedef data_tmpl base_type;
+    /// The type of an instance.
+    typedef typename base_type::instance_type instance_type;
+    /// A type counting the number of instances.
+    typedef typename base_type::size_type size_type;
+
+protected:
+    /// The ring buffer of instances.
+    ring_buffer<instance_type> m_ring;
+    /// The instance being created by the reader thread.
+    instance_type* m_current;
+    /// An empty instance for resetting slots.
+    instance_type m_empty;
+    /// The number of instances created by the reader thread.
+    size_type m_num_created;
+    /// Whether the reader thread has finished.
+    volatile int m_closed;
+    /// Whether the training thread has cancelled the reading.
+    volatile int m_cancelled;
+
+public:
+    /**
+     * Constructs the object.
+     *  @param  capacity    The number of instances in the ring buffer.
+     */
+    streaming_data(size_t capacity = 1024)
+        : m_ring(capacity), m_current(NULL), m_num_created(0),
+        m_closed(0), m_cancelled(0)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~streaming_data()
+    {
+    }
+
+    /**
+     * Reallocates the ring buffer.
+     *  Call this function before starting the reader thread.
+     *  @param  capacity    The number of instances in the ring buffer.
+     */
+    void reserve(size_t capacity)
+    {
+        m_ring.reserve(capacity);
+    }
+
+    /**
+     * Tests if the reader thread has created no instance.
+     *  @retval bool        \c true if no instance has been created.
+     */
+    inline bool empty() const
+    {
+        return m_num_created == 0;
+    }
+
+    /**
+     * Returns the number of instances created by the reader thread.
+     *  @retval size_type   The number of instances.
+     */
+    inline size_type size() const
+    {
+        return m_num_created;
+    }
+
+    /**
+     * Returns the reference to the instance being created (for the reader
+     * thread).
+     *  @retval instance_type&  The reference to the instance.
+     */
+    inline instance_type& back()
+    {
+        return *m_current;
+    }
+
+    /**
+     * Publishes the previous instance, and creates a new instance (for the
+     * reader thread).
+     *  @retval instance_type&  The reference to the new instance.
+     *  @throws stream_error    If the training thread has cancelled.
+     */
+    inline instance_type& new_element()
+    {
+        if (m_current != NULL) {
+            m_ring.commit();
+            m_current = NULL;
+        }
+
+        int retries = 0;
+        instance_type* inst = NULL;
+        while ((inst = m_ring.acquire()) == NULL) {
+            if (load_acquire(m_cancelled)) {
+                throw stream_error("The training has been cancelled");
+            }
+            ring_buffer<instance_type>::backoff(retries);
+        }
+
+        // Reset the slot, keeping the memory reserved by the instance.
+        *inst = m_empty;
+        m_current = inst;
+        ++m_num_created;
+        return *m_current;
+    }
+
+    /**
+     * Publishes the last instance and notifies the end of the data (for
+     * the reader thread).
+     */
+    void close()
+    {
+        if (m_current != NULL) {
+            m_ring.commit();
+            m_current = NULL;
+        }
+        store_release(m_closed, 1);
+    }
+
+    /**
+     * Waits for the next instance (for the training thread).
+     *  @retval const instance_type*    The pointer to the instance, or
+     *                                  \c NULL at the end of the data.
+     */
+    const instance_type* front()
+    {
+        int retries = 0;
+        for (;;) {
+            const instance_type* inst = m_ring.front();
+            if (inst != NULL) {
+                return inst;
+            }
+            if (load_acquire(m_closed)) {
+                // Check the instances published just before closing.
+                return m_ring.front();
+            }
+            ring_buffer<instance_type>::backoff(retries);
+        }
+    }
+
+    /**
+     * Returns the instance obtained by front() (for the training thread).
+     */
+    void pop()
+    {
+        m_ring.pop();
+    }
+
+    /**
+     * Cancels the reader thread waiting for a free slot (for the training
+     * thread).
+     */
+    void cancel()
+    {
+        store_release(m_cancelled, 1);
+    }
+
+private:
+    streaming_data(const streaming_data&);
+    streaming_data& operator=(const streaming_data&);
+};
+
+};
+
+#endif/*__CLASSIAS_STREAM_H__*/
@@ -0,0 +1,471 @@
+/*
+ *		Portable threads.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_THREAD_H__
+#define __CLASSIAS_THREAD_H__
+
+#ifdef  _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#endif/*_WIN32*/
+
+namespace classias
+{
+
+/**
+ * A thread of execution.
+ *
+ *  This class is a thin wrapper of POSIX threads (or Win32 threads on
+ *  Windows) that runs a function with an argument in a new thread. An
+ *  object runs at most one thread at a time; call join() before starting
+ *  another thread with the same object. The destructor joins the thread
+ *  if it is still running.
+ */
+class thread
+{
+public:
+    /// The type of a function executed by a thread.
+    typedef void (*function_type)(void *arg);
+
+protected:
+    /// The function executed by the thread.
+    function_type m_func;
+    /// The argument for the function.
+    void* m_arg;
+    /// Whether the thread has started and has not been joined yet.
+    bool m_running;
+#ifdef  _WIN32
+    /// The handle of the thread.
+    HANDLE m_handle;
+#else
+    /// The handle of the thread.
+    pthread_t m_handle;
+#endif/*_WIN32*/
+
+public:
+    /**
+     * Constructs the object.
+     */
+    thread() : m_func(NULL), m_arg(NULL), m_running(false)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~thread()
+    {
+        join();
+    }
+
+    /**
+     * Starts a new thread.
+     *  @param  func        The function executed by the thread.
+     *  @param  arg         The argument for the function.
+     *  @return bool        \c true if the thread has started, \c false
+     *                      otherwise (the function is not executed).
+     */
+    bool start(function_type func, void *arg)
+    {
+        if (m_running) {
+            return false;
+        }
+
+        m_func = func;
+        m_arg = arg;
+#ifdef  _WIN32
+        uintptr_t h = _beginthreadex(NULL, 0, __entry, this, 0, NULL);
+        if (h == 0) {
+            return false;
+        }
+        m_handle = reinterpret_cast<HANDLE>(h);
+#else
+        if (pthread_create(&m_handle, NULL, __entry, this) != 0) {
+            return false;
+        }
+#endif/*_WIN32*/
+        m_running = true;
+        return true;
+    }
+
+    /**
+     * Waits for the thread to terminate.
+     *  This function returns immediately if no thread is running.
+     */
+    void join()
+    {
+        if (!m_running) {
+            return;
+        }
+#ifdef  _WIN32
+        WaitForSingleObject(m_handle, INFINITE);
+        CloseHandle(m_handle);
+#else
+        pthread_join(m_handle, NULL);
+#endif/*_WIN32*/
+        m_running = false;
+    }
+
+    /**
+     * Tests whether a thread has started and has not been joined yet.
+     *  @return bool        \c true if the thread is running.
+     */
+    bool running() const
+    {
+        return m_running;
+    }
+
+    /**
+     * Yields the processor to another thread.
+     */
+    static void yield()
+    {
+#ifdef  _WIN32
+        SwitchToThread();
+#else
+        sched_yield();
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Suspends the calling thread.
+     *  @param  msec        The duration in milliseconds.
+     */
+    static void sleep(unsigned int msec)
+    {
+#ifdef  _WIN32
+        Sleep(msec);
+#else
+        usleep(msec * 1000);
+#endif/*_WIN32*/
+    }
+
+protected:
+#ifdef  _WIN32
+    static unsigned __stdcall __entry(void *inst)
+    {
+        thread* pt = reinterpret_cast<thread*>(inst);
+        pt->m_func(pt->m_arg);
+        return 0;
+    }
+#else
+    static void* __entry(void *inst)
+    {
+        thread* pt = reinterpret_cast<thread*>(inst);
+        pt->m_func(pt->m_arg);
+        return NULL;
+    }
+#endif/*_WIN32*/
+
+private:
+    thread(const thread&);
+    thread& operator=(const thread&);
+};
+
+
+
+/**
+ * A mutual exclusion lock.
+ */
+class mutex
+{
+protected:
+#ifdef  _WIN32
+    /// The critical section.
+    CRITICAL_SECTION m_cs;
+#else
+    /// The mutex.
+    pthread_mutex_t m_mutex;
+#endif/*_WIN32*/
+
+    friend class condition;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    mutex()
+    {
+#ifdef  _WIN32
+        InitializeCriticalSection(&m_cs);
+#else
+        pthread_mutex_init(&m_mutex, NULL);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~mutex()
+    {
+#ifdef  _WIN32
+        DeleteCriticalSection(&m_cs);
+#else
+        pthread_mutex_destroy(&m_mutex);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Acquires the lock.
+     */
+    void lock()
+    {
+#ifdef  _WIN32
+        EnterCriticalSection(&m_cs);
+#else
+        pthread_mutex_lock(&m_mutex);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Releases the lock.
+     */
+    void unlock()
+    {
+#ifdef  _WIN32
+        LeaveCriticalSection(&m_cs);
+#else
+        pthread_mutex_unlock(&m_mutex);
+#endif/*_WIN32*/
+    }
+
+private:
+    mutex(const mutex&);
+    mutex& operator=(const mutex&);
+};
+
+
+
+/**
+ * A lock held during the lifetime of the object.
+ */
+class scoped_lock
+{
+protected:
+    /// The mutex.
+    mutex& m_mutex;
+
+public:
+    /**
+     * Acquires the lock.
+     *  @param  m           The mutex.
+     */
+    scoped_lock(mutex& m) : m_mutex(m)
+    {
+        m_mutex.lock();
+    }
+
+    /**
+     * Releases the lock.
+     */
+    virtual ~scoped_lock()
+    {
+        m_mutex.unlock();
+    }
+
+private:
+    scoped_lock(const scoped_lock&);
+    scoped_lock& operator=(const scoped_lock&);
+};
+
+
+
+/**
+ * A condition variable.
+ */
+class condition
+{
+protected:
+#ifdef  _WIN32
+    /// The condition variable.
+    CONDITION_VARIABLE m_cond;
+#else
+    /// The condition variable.
+    pthread_cond_t m_cond;
+#endif/*_WIN32*/
+
+public:
+    /**
+     * Constructs the object.
+     */
+    condition()
+    {
+#ifdef  _WIN32
+        InitializeConditionVariable(&m_cond);
+#else
+        pthread_cond_init(&m_cond, NULL);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~condition()
+    {
+#ifndef _WIN32
+        pthread_cond_destroy(&m_cond);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Waits for a notification.
+     *  @param  m           The mutex locked by the calling thread, which is
+     *                      released while waiting.
+     */
+    void wait(mutex& m)
+    {
+#ifdef  _WIN32
+        SleepConditionVariableCS(&m_cond, &m.m_cs, INFINITE);
+#else
+        pthread_cond_wait(&m_cond, &m.m_mutex);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Waits for a notification at most for a duration.
+     *  @param  m           The mutex locked by the calling thread, which is
+     *                      released while waiting.
+     *  @param  usec        The duration in microseconds.
+     */
+    void wait(mutex& m, unsigned int usec)
+    {
+#ifdef  _WIN32
+        SleepConditionVariableCS(&m_cond, &m.m_cs, (usec + 999) / 1000);
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += usec / 1000000;
+        ts.tv_nsec += (long)(usec % 1000000) * 1000;
+        if (1000000000L <= ts.tv_nsec) {
+            ts.tv_sec += 1;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&m_cond, &m.m_mutex, &ts);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Wakes up a waiting thread.
+     */
+    void signal()
+    {
+#ifdef  _WIN32
+        WakeConditionVariable(&m_cond);
+#else
+        pthread_cond_signal(&m_cond);
+#endif/*_WIN32*/
+    }
+
+    /**
+     * Wakes up all waiting threads.
+     */
+    void broadcast()
+    {
+#ifdef  _WIN32
+        WakeAllConditionVariable(&m_cond);
+#else
+        pthread_cond_broadcast(&m_cond);
+#endif/*_WIN32*/
+    }
+
+private:
+    condition(const condition&);
+    condition& operator=(const condition&);
+};
+
+
+
+/**
+ * Returns the time elapsed from an arbitrary point in the past.
+ *  @return double      The time in seconds, measured by a monotonic clock.
+ */
+inline double monotonic_time()
+{
+#ifdef  _WIN32
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif/*_WIN32*/
+}
+
+
+
+/**
+ * Reads a variable shared with another thread.
+ *  The load has the acquire semantics: the writes of another thread that
+ *  precede its store_release() to the variable are visible after this
+ *  function returns the stored value.
+ *  @param  x           The variable.
+ *  @return value_type  The value of the variable.
+ */
+template <class value_type>
+inline value_type load_acquire(const volatile value_type& x)
+{
+#ifdef  _MSC_VER
+    value_type v = x;
+    _ReadWriteBarrier();
+    return v;
+#else
+    return __atomic_load_n(&x, __ATOMIC_ACQUIRE);
+#endif/*_MSC_VER*/
+}
+
+/**
+ * Writes a variable shared with another thread.
+ *  The store has the release semantics (see load_acquire()).
+ *  @param  x           The variable.
+ *  @param  v           The value.
+ */
+template <class value_type>
+inline void store_release(volatile value_type& x, value_type v)
+{
+#ifdef  _MSC_VER
+    _ReadWriteBarrier();
+    x = v;
+#else
+    __atomic_store_n(&x, v, __ATOMIC_RELEASE);
+#endif/*_MSC_VER*/
+}
+
+};
+
+#endif/*__CLASSIAS_THREAD_H__*/
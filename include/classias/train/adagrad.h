@@ -0,0 +1,624 @@
+/*
+ *      Adaptive subgradient method (AdaGrad) with L1 regularization.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_TRAIN_ADAGRAD_H__
+#define __CLASSIAS_TRAIN_ADAGRAD_H__
+
+#include <cmath>
+#include <iostream>
+
+#include <classias/types.h>
+#include <classias/parameters.h>
+
+namespace classias
+{
+
+namespace train
+{
+
+/**
+ * The base class for AdaGrad with L1 regularization.
+ *  The detail of this algorithm is described in:
+ *
+ *  -   John Duchi, Elad Hazan, and Yoram Singer.
+ *      Adaptive Subgradient Methods for Online Learning and Stochastic
+ *      Optimization.
+ *      JMLR 12(Jul):2121-2159, 2011.
+ *
+ *  This class implements the diagonal version of the composite mirror
+ *  descent update. The learning rate of a feature is inversely
+ *  proportional to the square root of the sum of its squared gradients.
+ *  The L1 penalty of a step is applied to all features in principle;
+ *  because the learning rate of a feature does not change while the feature
+ *  is absent from instances, the penalties are applied lazily when the
+ *  feature appears in an instance (or when the model is requested). The
+ *  per-coordinate values (the sum of squared gradients and the time stamp
+ *  of the penalties) are stored in a paged vector, which allocates a page
+ *  (of 4096 features) only when a feature in the page appears in an
+ *  instance.
+ *
+ *  This class implements internal variables, operations, and interface
+ *  that are common for training a binary/multi classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class adagrad_base
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of this class.
+    typedef adagrad_base<error_tmpl> this_class;
+
+    /// The per-coordinate values of a feature.
+    struct coordinate_type
+    {
+        /// The sum of squared gradients.
+        value_type g2;
+        /// The update count when L1 penalties were applied.
+        value_type stamp;
+
+        coordinate_type() : g2(0.), stamp(0.)
+        {
+        }
+    };
+    /// The type of an array of per-coordinate values.
+    typedef paged_vector<coordinate_type, std::allocator<coordinate_type>, 12> state_type;
+
+    /// The type of progress information.
+    struct report_type
+    {
+        /// The loss.
+        value_type loss;
+        /// The L1-norm of feature weights.
+        value_type norm1;
+        /// The L2-norm of feature weights.
+        value_type norm2;
+        /// The number of active features.
+        int num_actives;
+
+        void init()
+        {
+            loss = 0;
+            norm1 = 0;
+            norm2 = 0;
+            num_actives = 0;
+        }
+    };
+    report_type m_report;
+
+protected:
+    /// The array of feature weights.
+    model_type m_w;
+    /// The array of per-coordinate values of features.
+    state_type m_state;
+    /// The set of features whose weights have been updated.
+    index_set m_touched;
+
+    /// The lambda (coefficient for L1 regularization).
+    value_type m_lambda;
+    /// The update count.
+    int m_t;
+    /// The loss.
+    value_type m_loss;
+
+    /// Parameter interface.
+    parameter_exchange m_params;
+    /// The coefficient for L1 regularization.
+    value_type m_c;
+    /// The number of instances in the data set.
+    value_type m_n;
+    /// The learning rate.
+    value_type m_eta;
+    /// The initial value for the denominator of learning rates.
+    value_type m_delta;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    adagrad_base()
+    {
+        clear();
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~adagrad_base()
+    {
+    }
+
+    /**
+     * Resets the internal states and parameters to default.
+     */
+    void clear()
+    {
+        // Clear the weight vector.
+        m_w.clear();
+        this->initialize_weights();
+
+        // Initialize the parameters.
+        m_params.init("c", &m_c, 1.,
+            "Coefficient for L1 regularization.");
+        m_params.init("n", &m_n, 1.,
+            "The number of instances in the data set.");
+        m_params.init("eta", &m_eta, 0.1,
+            "Learning rate");
+        m_params.init("delta", &m_delta, 1e-6,
+            "The initial value for the denominator of learning rates.");
+    }
+
+    /**
+     * Sets the number of features.
+     *  This function resizes the weight vector.
+     *  @param  size        The number of features.
+     */
+    void set_num_features(size_t size)
+    {
+        m_w.resize(size);
+        this->initialize_weights();
+    }
+
+public:
+    /**
+     * Starts a training process.
+     *  This function resets the internal states, and prepares for a training
+     *  process.
+     */
+    void start()
+    {
+        this->initialize_weights();
+        m_lambda = m_c / m_n;
+        m_t = 0;
+        m_loss = 0;
+
+        m_report.init();
+    }
+
+    /**
+     * Terminates a training process.
+     *  This function performs a post-processing after a training process.
+     */
+    void finish()
+    {
+        this->apply_penalty();
+    }
+
+    void discontinue()
+    {
+        this->apply_penalty();
+
+        // Fill the progress information.
+        m_report.init();
+        m_report.loss = m_loss;
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            value_type v = m_w[*it];
+            m_report.norm1 += std::fabs(v);
+            m_report.norm2 += v * v;
+            if (v != 0.) {
+                ++m_report.num_actives;
+            }
+        }
+        m_report.loss += m_c * m_report.norm1;
+        m_report.norm2 = std::sqrt(m_report.norm2);
+
+        // Reset the run-time information.
+        m_loss = 0;
+    }
+
+public:
+    /**
+     * Shows the copyright information.
+     *  @param  os          The output stream.
+     */
+    void copyright(std::ostream& os)
+    {
+        os << "AdaGrad for " << error_type::name() << std::endl;
+    }
+
+    /**
+     * Reports the current state of the training process.
+     *  @param  os          The output stream.
+     */
+    void report(std::ostream& os)
+    {
+        os << "Loss: " << m_report.loss << std::endl;
+        os << "Feature L1-norm: " << m_report.norm1 << std::endl;
+        os << "Feature L2-norm: " << m_report.norm2 << std::endl;
+        os << "Active features: " << m_report.num_actives << " / " << m_w.size() << std::endl;
+        os << "Total number of feature updates: " << m_t << std::endl;
+    }
+
+protected:
+    /**
+     * Initializes the weight vector.
+     *  This function sets W = 0.
+     */
+    void initialize_weights()
+    {
+        for (size_t i = 0;i < m_w.size();++i) {
+            m_w[i] = 0.;
+        }
+        m_state.clear();
+        m_touched.clear();
+    }
+
+    /**
+     * Applies the L1 penalties to the weight vector.
+     *  The features that have never been updated have zero weights, which
+     *  do not need L1 penalties.
+     */
+    void apply_penalty()
+    {
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            this->apply_penalty(*it);
+        }
+    }
+
+    /**
+     * Applies the pending L1 penalties to the weight of a feature.
+     *  The penalty of a step is (eta * lambda / (delta + sqrt(G))), which
+     *  is constant while the feature does not appear in instances. This
+     *  function applies the penalties for the steps after the last update
+     *  of the feature at once.
+     *  @param  i           The feature index.
+     */
+    inline void apply_penalty(int i)
+    {
+        coordinate_type& c = m_state[i];
+        value_type steps = m_t - c.stamp;
+        if (0 < steps) {
+            value_type w = m_w[i];
+            if (w != 0.) {
+                value_type alpha = steps * m_eta * m_lambda / (m_delta + std::sqrt(c.g2));
+                if (0 < w) {
+                    m_w[i] = (alpha < w) ? (w - alpha) : 0.;
+                } else {
+                    m_w[i] = (alpha < -w) ? (w + alpha) : 0.;
+                }
+            }
+            c.stamp = m_t;
+        }
+    }
+
+    /**
+     * Updates the weight of a feature with its gradient.
+     *  @param  i           The feature index.
+     *  @param  g           The gradient for the feature weight.
+     */
+    inline void update_weight(int i, value_type g)
+    {
+        coordinate_type& c = m_state[i];
+        c.g2 += g * g;
+        m_w[i] -= m_eta * g / (m_delta + std::sqrt(c.g2));
+        m_touched.insert(i);
+    }
+
+public:
+    /**
+     * Obtains the parameter interface.
+     *  @return parameter_exchange& The parameter interface associated with
+     *                              this algorithm.
+     */
+    parameter_exchange& params()
+    {
+        return m_params;
+    }
+
+public:
+    /**
+     * Obtains an access to the weight vector (model).
+     *  @return model_type&         The weight vector (model).
+     */
+    model_type& model()
+    {
+        this->apply_penalty();
+        return m_w;
+    }
+
+    /**
+     * Obtains a read-only access to the weight vector (model).
+     *  @return const model_type&   The weight vector (model).
+     */
+    const model_type& model() const
+    {
+        // Force to remove the const modifier for applying penalties.
+        return const_cast<this_class*>(this)->model();
+    }
+
+    value_type loss() const
+    {
+        return m_report.loss;
+    }
+};
+
+
+
+/**
+ * AdaGrad for binary classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class adagrad_binary :
+    public adagrad_base<error_tmpl>
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of the base class.
+    typedef adagrad_base<error_tmpl> base_class;
+    /// A synonym of this class.
+    typedef adagrad_binary<error_tmpl> this_class;
+
+public:
+    /**
+     * Receives a training instance and updates feature weights.
+     *  @param  it          An interator for the training instance.
+     */
+    template <class iterator_type>
+    void update(iterator_type it)
+    {
+        // Apply the pending L1 penalties to the features in the instance.
+        this->apply_penalty(it->begin(), it->end());
+
+        // Compute the error and loss for the instance.
+        error_type cls(this->m_w);
+        cls.inner_product(it->begin(), it->end());
+        value_type nlogp = 0.;
+        value_type err = cls.error(it->get_label(), nlogp);
+        this->m_loss += (it->get_weight() * nlogp);
+
+        // Update the feature weights with the gradient.
+        update_weights(it->begin(), it->end(), err * it->get_weight());
+
+        // Apply the L1 penalty of this step to the features in the instance.
+        ++this->m_t;
+        this->apply_penalty(it->begin(), it->end());
+    }
+
+    /**
+     * Receives multiple training instances and updates feature weights.
+     *  @param  first       The iterator pointing to the first instance.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      instance.
+     */
+    template <class iterator_type>
+    inline void update(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->update(it);
+        }
+    }
+
+protected:
+    /**
+     * Updates the weights of the features in a feature vector.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @param  err         The error multiplied by the instance weight.
+     */
+    template <class iterator_type>
+    inline void update_weights(iterator_type first, iterator_type last, value_type err)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            base_class::update_weight(it->first, err * it->second);
+        }
+    }
+
+    /**
+     * Applies L1 penalties to the feature weights.
+     *  This function applies L1 penalties to the weights in a feature vector.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     */
+    template <class iterator_type>
+    inline void apply_penalty(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            base_class::apply_penalty(it->first);
+        }
+    }
+};
+
+
+
+/**
+ * AdaGrad for multi-class classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class adagrad_multi :
+    public adagrad_base<error_tmpl>
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of the base class.
+    typedef adagrad_base<error_tmpl> base_class;
+    /// A synonym of this class.
+    typedef adagrad_multi<error_tmpl> this_class;
+
+public:
+    /**
+     * Receives a training instance and updates feature weights.
+     *  @param  it          An interator for the training instance.
+     *  @param  fgen        The feature generator.
+     */
+    template <class iterator_type, class feature_generator_type>
+    void update(iterator_type it, feature_generator_type& fgen)
+    {
+        const int L = (int)fgen.num_labels();
+        const int N = it->num_candidates(L);
+
+        // Apply the pending L1 penalties to the features in the instance.
+        for (int i = 0;i < N;++i) {
+            apply_penalty(
+                i, fgen, it->attributes(i).begin(), it->attributes(i).end());
+        }
+
+        // Compute the scores for the labels (candidates) in the instance.
+        error_type cls(this->m_w);
+        cls.resize(N);
+        for (int i = 0;i < N;++i) {
+            cls.inner_product(
+                i,
+                fgen,
+                it->attributes(i).begin(),
+                it->attributes(i).end(),
+                i
+                );
+        }
+        cls.finalize();
+
+        // Compute the loss for the instance.
+        this->m_loss += -it->get_weight() * cls.logprob(it->get_label());
+
+        // Update the feature weights with the gradient.
+        for (int i = 0;i < N;++i) {
+            value_type err = cls.error(i, it->get_label());
+            update_weights(
+                i,
+                fgen,
+                it->attributes(i).begin(),
+                it->attributes(i).end(),
+                err * it->get_weight()
+                );
+        }
+
+        // Apply the L1 penalty of this step to the features in the instance.
+        ++this->m_t;
+        for (int i = 0;i < N;++i) {
+            apply_penalty(
+                i, fgen, it->attributes(i).begin(), it->attributes(i).end());
+        }
+    }
+
+    /**
+     * Receives multiple training instances and updates feature weights.
+     *  @param  first       The iterator pointing to the first instance.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      instance.
+     */
+    template <class iterator_type>
+    inline void update(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->update(it);
+        }
+    }
+
+protected:
+    /**
+     * Updates the weights of the features in a feature vector.
+     *  @param  l           The label or candidate index.
+     *  @param  fgen        The feature generator.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @param  err         The error multiplied by the instance weight.
+     */
+    template <class feature_generator_type, class iterator_type>
+    inline void update_weights(
+        int l,
+        feature_generator_type& fgen,
+        iterator_type first,
+        iterator_type last,
+        value_type err
+        )
+    {
+        for (iterator_type it = first;it != last;++it) {
+            typename feature_generator_type::feature_type f;
+            if (fgen.forward(it->first, l, f)) {
+                base_class::update_weight((int)f, err * it->second);
+            }
+        }
+    }
+
+    /**
+     * Applies L1 penalties to the feature weights.
+     *  This function applies L1 penalties to the weights in a feature vector.
+     *  @param  l           The label or candidate index.
+     *  @param  fgen        The feature generator.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     */
+    template <class feature_generator_type, class iterator_type>
+    inline void apply_penalty(
+        int l,
+        feature_generator_type& fgen,
+        iterator_type first,
+        iterator_type last
+        )
+    {
+        for (iterator_type it = first;it != last;++it) {
+            typename feature_generator_type::feature_type f;
+            if (fgen.forward(it->first, l, f)) {
+                base_class::apply_penalty((int)f);
+            }
+        }
+    }
+};
+
+};
+
+};
+
+#endif/*__CLASSIAS_TRAIN_ADAGRAD_H__*/
@@ -62,7 +62,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of this class.
     typedef averaged_perceptron_base<error_tmpl> this_class;
 
@@ -81,6 +81,8 @@ protected:
     model_type m_w;
     /// The array of cumulative feature weights used for computing the average.
     model_type m_ws;
+    /// The set of features whose weights have been updated.
+    index_set m_touched;
     /// The indicator whether m_w is averaged or not.
     bool m_averaged;
 
@@ -163,8 +165,8 @@ public:
         // Fill the progress information.
         m_report.loss = m_loss;
         m_report.norm2 = 0;
-        for (size_t i = 0;i < m_w.size();++i) {
-            m_report.norm2 += m_w[i] * m_w[i];
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            m_report.norm2 += m_w[*it] * m_w[*it];
         }
         m_report.norm2 = std::sqrt(m_report.norm2);
 
@@ -203,6 +205,7 @@ protected:
             m_w[i] = 0.;
             m_ws[i] = 0.;
         }
+        m_touched.clear();
         m_c = 1;
     }
 
@@ -214,11 +217,10 @@ protected:
     void average_weights()
     {
         if (!m_averaged) {
-            for (size_t i = 0;i < m_w.size();++i) {
-                m_w[i] -= m_ws[i] / m_c;
-            }
-            for (size_t i = 0;i < m_w.size();++i) {
-                m_ws[i] = m_w[i];
+            // Only the features that have been updated need averaging.
+            for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+                m_w[*it] -= m_ws[*it] / m_c;
+                m_ws[*it] = m_w[*it];
             }
             m_averaged = true;
         }
@@ -281,7 +283,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of the base class.
     typedef averaged_perceptron_base<error_tmpl> base_class;
     /// A synonym of this class.
@@ -350,6 +352,7 @@ protected:
     {
         for (iterator_type it = first;it != last;++it) {
             w[it->first] += (delta * it->second);
+            this->m_touched.insert(it->first);
         }
     }
 };
@@ -373,7 +376,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of the base class.
     typedef averaged_perceptron_base<error_tmpl> base_class;
     /// A synonym of this class.
@@ -494,6 +497,7 @@ protected:
             typename feature_generator_type::feature_type f;
             if (fgen.forward(it->first, l, f)) {
                 w[f] += (delta * it->second);
+                this->m_touched.insert((int)f);
             }
         }
     }
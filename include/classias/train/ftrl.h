@@ -0,0 +1,634 @@
+/*
+ *      Follow The Regularized Leader (FTRL-Proximal).
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_TRAIN_FTRL_H__
+#define __CLASSIAS_TRAIN_FTRL_H__
+
+#include <cmath>
+#include <iostream>
+
+#include <classias/types.h>
+#include <classias/parameters.h>
+
+namespace classias
+{
+
+namespace train
+{
+
+/**
+ * The base class for FTRL-Proximal.
+ *  The detail of this algorithm is described in:
+ *
+ *  -   H. Brendan McMahan, Gary Holt, D. Sculley, et al.
+ *      Ad Click Prediction: a View from the Trenches.
+ *      In Proc. of KDD 2013, pp 1222-1230, 2013.
+ *
+ *  The algorithm maintains two values (z and n) for every feature, and
+ *  updates them only for the features that appear in an instance. The
+ *  values are stored in a paged vector, which allocates a page (of 4096
+ *  features) only when a feature in the page appears in an instance. A
+ *  feature weight is a closed-form function of (z, n) with per-coordinate
+ *  learning rates, L1 and L2 regularization. The weights are materialized
+ *  only for the features in the current instance during training, and for
+ *  all features when the model is requested.
+ *
+ *  This class implements internal variables, operations, and interface
+ *  that are common for training a binary/multi classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class ftrl_base
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of this class.
+    typedef ftrl_base<error_tmpl> this_class;
+
+    /// The per-coordinate values of a feature.
+    struct coordinate_type
+    {
+        /// The (adjusted) sum of gradients.
+        value_type z;
+        /// The sum of squared gradients.
+        value_type n;
+
+        coordinate_type() : z(0.), n(0.)
+        {
+        }
+    };
+    /// The type of an array of per-coordinate values.
+    typedef paged_vector<coordinate_type, std::allocator<coordinate_type>, 12> state_type;
+
+    /// The type of progress information.
+    struct report_type
+    {
+        /// The loss.
+        value_type loss;
+        /// The L1-norm of feature weights.
+        value_type norm1;
+        /// The L2-norm of feature weights.
+        value_type norm2;
+        /// The number of active features.
+        int num_actives;
+
+        void init()
+        {
+            loss = 0;
+            norm1 = 0;
+            norm2 = 0;
+            num_actives = 0;
+        }
+    };
+    report_type m_report;
+
+protected:
+    /// The array of feature weights (materialized on demand).
+    model_type m_w;
+    /// The array of (z, n) values of features.
+    state_type m_state;
+    /// The set of features whose (z, n) values have been updated.
+    index_set m_touched;
+
+    /// The loss.
+    value_type m_loss;
+    /// The update count.
+    int m_t;
+
+    /// Parameter interface.
+    parameter_exchange m_params;
+    /// The coefficient for L1 regularization.
+    value_type m_c1;
+    /// The coefficient for L2 regularization.
+    value_type m_c2;
+    /// The parameter alpha for per-coordinate learning rates.
+    value_type m_alpha;
+    /// The parameter beta for per-coordinate learning rates.
+    value_type m_beta;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    ftrl_base()
+    {
+        clear();
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~ftrl_base()
+    {
+    }
+
+    /**
+     * Resets the internal states and parameters to default.
+     */
+    void clear()
+    {
+        // Clear the weight vector.
+        m_w.clear();
+        this->initialize_weights();
+
+        // Initialize the parameters.
+        m_params.init("c1", &m_c1, 1.,
+            "Coefficient for L1 regularization.");
+        m_params.init("c2", &m_c2, 0.,
+            "Coefficient for L2 regularization.");
+        m_params.init("alpha", &m_alpha, 0.1,
+            "The parameter alpha for per-coordinate learning rates.");
+        m_params.init("beta", &m_beta, 1.,
+            "The parameter beta for per-coordinate learning rates.");
+    }
+
+    /**
+     * Sets the number of features.
+     *  This function resizes the weight vector.
+     *  @param  size        The number of features.
+     */
+    void set_num_features(size_t size)
+    {
+        m_w.resize(size);
+        this->initialize_weights();
+    }
+
+public:
+    /**
+     * Starts a training process.
+     *  This function resets the internal states, and prepares for a training
+     *  process.
+     */
+    void start()
+    {
+        this->initialize_weights();
+        m_t = 0;
+        m_loss = 0;
+
+        m_report.init();
+    }
+
+    /**
+     * Terminates a training process.
+     *  This function performs a post-processing after a training process.
+     */
+    void finish()
+    {
+        this->materialize_weights();
+    }
+
+    void discontinue()
+    {
+        this->materialize_weights();
+
+        // Fill the progress information.
+        m_report.init();
+        m_report.loss = m_loss;
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            value_type v = m_w[*it];
+            m_report.norm1 += std::fabs(v);
+            m_report.norm2 += v * v;
+            if (v != 0.) {
+                ++m_report.num_actives;
+            }
+        }
+        m_report.loss += m_c1 * m_report.norm1 + m_c2 * m_report.norm2;
+        m_report.norm2 = std::sqrt(m_report.norm2);
+
+        // Reset the run-time information.
+        m_loss = 0;
+    }
+
+public:
+    /**
+     * Shows the copyright information.
+     *  @param  os          The output stream.
+     */
+    void copyright(std::ostream& os)
+    {
+        os << "FTRL-Proximal for " << error_type::name() << std::endl;
+    }
+
+    /**
+     * Reports the current state of the training process.
+     *  @param  os          The output stream.
+     */
+    void report(std::ostream& os)
+    {
+        os << "Loss: " << m_report.loss << std::endl;
+        os << "Feature L1-norm: " << m_report.norm1 << std::endl;
+        os << "Feature L2-norm: " << m_report.norm2 << std::endl;
+        os << "Active features: " << m_report.num_actives << " / " << m_w.size() << std::endl;
+        os << "Total number of feature updates: " << m_t << std::endl;
+    }
+
+protected:
+    /**
+     * Initializes the weight vector.
+     *  This function sets W = 0.
+     */
+    void initialize_weights()
+    {
+        for (size_t i = 0;i < m_w.size();++i) {
+            m_w[i] = 0.;
+        }
+        m_state.clear();
+        m_touched.clear();
+    }
+
+    /**
+     * Computes the weight of a feature from its (z, n) values.
+     *  @param  i           The feature index.
+     *  @return value_type  The feature weight.
+     */
+    inline value_type weight(int i) const
+    {
+        const coordinate_type& c = m_state[i];
+        if (std::fabs(c.z) <= m_c1) {
+            return 0.;
+        }
+        value_type sign = (c.z < 0.) ? -1. : 1.;
+        value_type rate = (m_beta + std::sqrt(c.n)) / m_alpha + 2. * m_c2;
+        return -(c.z - sign * m_c1) / rate;
+    }
+
+    /**
+     * Receives the gradient for a feature weight.
+     *  This function updates (z, n) of the feature with the gradient.
+     *  m_w[i] must hold the weight used for computing the gradient.
+     *  @param  i           The feature index.
+     *  @param  g           The gradient for the feature weight.
+     */
+    inline void update_weight(int i, value_type g)
+    {
+        coordinate_type& c = m_state[i];
+        value_type sigma = (std::sqrt(c.n + g * g) - std::sqrt(c.n)) / m_alpha;
+        c.z += g - sigma * m_w[i];
+        c.n += g * g;
+        m_touched.insert(i);
+    }
+
+    /**
+     * Materializes the weight vector.
+     *  This function computes the weights of all features from (z, n).
+     *  The features whose (z, n) values have never been updated have
+     *  zero weights.
+     */
+    void materialize_weights()
+    {
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            m_w[*it] = this->weight(*it);
+        }
+    }
+
+public:
+    /**
+     * Obtains the parameter interface.
+     *  @return parameter_exchange& The parameter interface associated with
+     *                              this algorithm.
+     */
+    parameter_exchange& params()
+    {
+        return m_params;
+    }
+
+public:
+    /**
+     * Obtains an access to the weight vector (model).
+     *  @return model_type&         The weight vector (model).
+     */
+    model_type& model()
+    {
+        this->materialize_weights();
+        return m_w;
+    }
+
+    /**
+     * Obtains a read-only access to the weight vector (model).
+     *  @return const model_type&   The weight vector (model).
+     */
+    const model_type& model() const
+    {
+        // Force to remove the const modifier for materializing weights.
+        return const_cast<this_class*>(this)->model();
+    }
+
+    value_type loss() const
+    {
+        return m_report.loss;
+    }
+};
+
+
+
+/**
+ * FTRL-Proximal for binary classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class ftrl_binary :
+    public ftrl_base<error_tmpl>
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of the base class.
+    typedef ftrl_base<error_tmpl> base_class;
+    /// A synonym of this class.
+    typedef ftrl_binary<error_tmpl> this_class;
+
+public:
+    /**
+     * Receives a training instance and updates feature weights.
+     *  @param  it          An interator for the training instance.
+     */
+    template <class iterator_type>
+    void update(iterator_type it)
+    {
+        // Materialize the weights of the features in the instance.
+        this->materialize_weights(it->begin(), it->end());
+
+        // Compute the error and loss for the instance.
+        error_type cls(this->m_w);
+        cls.inner_product(it->begin(), it->end());
+        value_type nlogp = 0.;
+        value_type err = cls.error(it->get_label(), nlogp);
+        this->m_loss += (it->get_weight() * nlogp);
+
+        // Update (z, n) of the features in the instance.
+        this->update_weights(it->begin(), it->end(), err * it->get_weight());
+
+        // Increment the update count.
+        ++this->m_t;
+    }
+
+    /**
+     * Receives multiple training instances and updates feature weights.
+     *  @param  first       The iterator pointing to the first instance.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      instance.
+     */
+    template <class iterator_type>
+    inline void update(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->update(it);
+        }
+    }
+
+protected:
+    /**
+     * Materializes the weights of a feature vector.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     */
+    template <class iterator_type>
+    inline void materialize_weights(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->m_w[it->first] = base_class::weight(it->first);
+        }
+    }
+
+    /**
+     * Updates (z, n) of the features in a feature vector.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @param  err         The error multiplied by the instance weight.
+     */
+    template <class iterator_type>
+    inline void update_weights(iterator_type first, iterator_type last, value_type err)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            base_class::update_weight(it->first, err * it->second);
+        }
+    }
+};
+
+
+
+/**
+ * FTRL-Proximal for multi-class classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class ftrl_multi :
+    public ftrl_base<error_tmpl>
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of the base class.
+    typedef ftrl_base<error_tmpl> base_class;
+    /// A synonym of this class.
+    typedef ftrl_multi<error_tmpl> this_class;
+
+public:
+    /**
+     * Receives a training instance and updates feature weights.
+     *  @param  it          An interator for the training instance.
+     *  @param  fgen        The feature generator.
+     */
+    template <class iterator_type, class feature_generator_type>
+    void update(iterator_type it, feature_generator_type& fgen)
+    {
+        const int L = (int)fgen.num_labels();
+        const int N = it->num_candidates(L);
+
+        // Materialize the weights of the features in the instance.
+        for (int i = 0;i < N;++i) {
+            materialize_weights(
+                i, fgen, it->attributes(i).begin(), it->attributes(i).end());
+        }
+
+        // Compute the scores for the labels (candidates) in the instance.
+        error_type cls(this->m_w);
+        cls.resize(N);
+        for (int i = 0;i < N;++i) {
+            cls.inner_product(
+                i,
+                fgen,
+                it->attributes(i).begin(),
+                it->attributes(i).end(),
+                i
+                );
+        }
+        cls.finalize();
+
+        // Compute the loss for the instance.
+        this->m_loss += -it->get_weight() * cls.logprob(it->get_label());
+
+        // Update (z, n) of the features in the instance.
+        for (int i = 0;i < N;++i) {
+            value_type err = cls.error(i, it->get_label());
+            update_weights(
+                i,
+                fgen,
+                it->attributes(i).begin(),
+                it->attributes(i).end(),
+                err * it->get_weight()
+                );
+        }
+
+        // Increment the update count.
+        ++this->m_t;
+    }
+
+    /**
+     * Receives multiple training instances and updates feature weights.
+     *  @param  first       The iterator pointing to the first instance.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      instance.
+     */
+    template <class iterator_type>
+    inline void update(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->update(it);
+        }
+    }
+
+protected:
+    /**
+     * Materializes the weights of a feature vector.
+     *  @param  l           The label or candidate index.
+     *  @param  fgen        The feature generator.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     */
+    template <class feature_generator_type, class iterator_type>
+    inline void materialize_weights(
+        int l,
+        feature_generator_type& fgen,
+        iterator_type first,
+        iterator_type last
+        )
+    {
+        for (iterator_type it = first;it != last;++it) {
+            typename feature_generator_type::feature_type f;
+            if (fgen.forward(it->first, l, f)) {
+                this->m_w[f] = base_class::weight((int)f);
+            }
+        }
+    }
+
+    /**
+     * Updates (z, n) of the features in a feature vector.
+     *  @param  l           The label or candidate index.
+     *  @param  fgen        The feature generator.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @param  err         The error multiplied by the instance weight.
+     */
+    template <class feature_generator_type, class iterator_type>
+    inline void update_weights(
+        int l,
+        feature_generator_type& fgen,
+        iterator_type first,
+        iterator_type last,
+        value_type err
+        )
+    {
+        for (iterator_type it = first;it != last;++it) {
+            typename feature_generator_type::feature_type f;
+            if (fgen.forward(it->first, l, f)) {
+                base_class::update_weight((int)f, err * it->second);
+            }
+        }
+    }
+};
+
+};
+
+};
+
+/*
+
+This is a pseudo-code of the FTRL-Proximal algorithm with per-coordinate
+learning rates, L1 regularization (c1), and L2 regularization (c2).
+
+1:  z = 0, n = 0
+2:  for epoch in range(max_epoch):
+3:      for inst in data:
+4:          for f, v in inst:
+5:              if |z[f]| <= c1:
+6:                  W[f] = 0
+7:              else:
+8:                  W[f] = -(z[f] - sign(z[f]) * c1) /
+                            ((beta + sqrt(n[f])) / alpha + 2 * c2)
+9:          err = error_function(W, inst)
+10:         for f, v in inst:
+11:             g = err * v
+12:             sigma = (sqrt(n[f] + g * g) - sqrt(n[f])) / alpha
+13:             z[f] += g - sigma * W[f]
+14:             n[f] += g * g
+15: return W
+
+Steps 4-8 and 10-14 touch only the features in the instance. Because the
+features absent from the instance receive zero gradients, their (z, n)
+values do not change, and no lazy update is necessary for them. The (z, n)
+values are allocated (in pages) only for the features that have appeared
+in instances.
+
+*/
+
+#endif/*__CLASSIAS_TRAIN_FTRL_H__*/
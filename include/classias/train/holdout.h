@@ -0,0 +1,510 @@
+/*
+ *      Holdout evaluation during training.
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_TRAIN_HOLDOUT_H__
+#define __CLASSIAS_TRAIN_HOLDOUT_H__
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <classias/evaluation.h>
+#include <classias/parameters.h>
+#include <classias/thread.h>
+
+namespace classias
+{
+
+namespace train
+{
+
+/**
+ * The base class for holdout evaluations during training.
+ *
+ *  A training algorithm hands the progress report of every iteration to
+ *  submit() together with the current weight vector. When a holdout
+ *  evaluation is scheduled for the iteration, this class copies the weight
+ *  vector to a snapshot and evaluates the snapshot on the holdout data. In
+ *  the asynchronous mode, the evaluation runs in a background thread while
+ *  the training algorithm proceeds to the next iteration; the report of the
+ *  iteration is output together with the evaluation result when the next
+ *  report is submitted or when wait() is called. Therefore, the reports are
+ *  always output in the order of iterations.
+ *
+ *  This class also implements early stopping on a holdout metric. When the
+ *  patience is positive, this class keeps a copy of the weight vector that
+ *  yielded the best score so far, and stopped() becomes \c true after the
+ *  number of consecutive evaluations without an improvement (greater than
+ *  the minimum delta) reaches the patience. In the asynchronous mode, the
+ *  decision is based on the evaluations finished so far, i.e., it may lag
+ *  behind the training algorithm by one iteration.
+ *
+ *  @param  model_tmpl  The type of a weight vector for features.
+ */
+template <
+    class model_tmpl
+>
+class holdout_evaluator_base
+{
+public:
+    /// The type implementing a model (weight vector for features).
+    typedef model_tmpl model_type;
+    /// A synonym of this class.
+    typedef holdout_evaluator_base<model_tmpl> this_class;
+
+protected:
+    /// The output stream for progress reports.
+    std::ostream* m_os;
+    /// The group number for holdout evaluation.
+    int m_holdout;
+    /// The period (in iterations) of holdout evaluations.
+    int m_period;
+    /// Whether holdout evaluations run in a background thread.
+    bool m_async;
+    /// The number of evaluations without an improvement for early stopping.
+    int m_patience;
+    /// The minimum improvement of the score for early stopping.
+    double m_min_delta;
+    /// The metric for early stopping.
+    std::string m_metric;
+
+    /// The snapshot of the weight vector being evaluated.
+    model_type m_snapshot;
+    /// The progress report of the iteration being evaluated.
+    std::string m_report;
+    /// The result of the holdout evaluation.
+    std::ostringstream m_result;
+    /// The scores of the holdout evaluation.
+    holdout_scores m_scores;
+    /// The iteration number being evaluated.
+    int m_iteration;
+    /// Whether a progress report is waiting for the output.
+    bool m_pending;
+    /// The thread for holdout evaluations.
+    thread m_thread;
+
+    /// The weight vector that yielded the best score.
+    model_type m_best;
+    /// The best score.
+    double m_best_score;
+    /// The iteration number that yielded the best score.
+    int m_best_iteration;
+    /// The number of consecutive evaluations without an improvement.
+    int m_num_stalls;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    holdout_evaluator_base()
+        : m_os(NULL), m_holdout(-1), m_period(1), m_async(false),
+        m_patience(0), m_min_delta(0.), m_metric("accuracy"),
+        m_iteration(0), m_pending(false),
+        m_best_score(0.), m_best_iteration(0), m_num_stalls(0)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~holdout_evaluator_base()
+    {
+    }
+
+    /**
+     * Starts holdout evaluations.
+     *  @param  os          The output stream for progress reports.
+     *  @param  holdout     The group number for holdout evaluation. Specify
+     *                      a negative value if a holdout evaluation is
+     *                      unnecessary.
+     *  @param  period      The period (in iterations) of holdout
+     *                      evaluations.
+     *  @param  async       \c true to evaluate in a background thread.
+     */
+    void start(std::ostream& os, int holdout, int period, bool async)
+    {
+        wait();
+        m_os = &os;
+        m_holdout = holdout;
+        m_period = period;
+        m_async = async;
+        m_best.clear();
+        m_best_score = 0.;
+        m_best_iteration = 0;
+        m_num_stalls = 0;
+    }
+
+    /**
+     * Configures early stopping.
+     *  Call this function before start().
+     *  @param  patience    The number of consecutive evaluations without an
+     *                      improvement to stop the training. Specify zero to
+     *                      disable early stopping.
+     *  @param  min_delta   The minimum increase of the score regarded as an
+     *                      improvement.
+     *  @param  metric      The metric, \c "accuracy", \c "micro_f1", or
+     *                      \c "macro_f1".
+     *  @throw  invalid_parameter   The metric is unknown.
+     */
+    void early_stopping(int patience, double min_delta, const std::string& metric)
+    {
+        if (!holdout_scores::known(metric)) {
+            throw invalid_parameter("Unknown metric for early stopping: " + metric);
+        }
+        m_patience = patience;
+        m_min_delta = min_delta;
+        m_metric = metric;
+    }
+
+    /**
+     * Tests whether the early stopping criterion is satisfied.
+     *  @return bool        \c true if the training should stop.
+     */
+    bool stopped() const
+    {
+        return (0 < m_patience && m_patience <= m_num_stalls);
+    }
+
+    /**
+     * Tests whether the best weight vector is available.
+     *  @return bool        \c true if early stopping is enabled and at least
+     *                      one evaluation has finished.
+     */
+    bool has_best() const
+    {
+        return (0 < m_patience && 0 < m_best_iteration);
+    }
+
+    /**
+     * Obtains the weight vector that yielded the best score.
+     *  @return const model_type&   The best weight vector.
+     */
+    const model_type& best() const
+    {
+        return m_best;
+    }
+
+    /**
+     * Tests whether a holdout evaluation is scheduled for an iteration.
+     *  @param  k           The iteration number (starting from one).
+     *  @return bool        \c true if the iteration is evaluated.
+     */
+    bool scheduled(int k) const
+    {
+        return (0 <= m_holdout && 0 < m_period && k % m_period == 0);
+    }
+
+    /**
+     * Submits the progress report of an iteration.
+     *  This function outputs the report of the previous iteration (waiting
+     *  for its evaluation if necessary), and then starts the holdout
+     *  evaluation for this iteration if scheduled.
+     *  @param  k           The iteration number (starting from one).
+     *  @param  report      The progress report of the iteration.
+     *  @param  model       The weight vector at the iteration.
+     */
+    void submit(int k, const std::string& report, model_type& model)
+    {
+        wait();
+
+        if (!scheduled(k)) {
+            *m_os << report << std::endl;
+            m_os->flush();
+            return;
+        }
+
+        m_iteration = k;
+        m_report = report;
+        m_result.str("");
+        m_pending = true;
+
+        // Evaluate the snapshot of the weight vector in a background thread.
+        if (m_async) {
+            m_snapshot = model;
+            if (m_thread.start(__evaluate, this)) {
+                return;
+            }
+        }
+
+        // Evaluate the weight vector synchronously (also as a fallback when
+        // a thread is unavailable).
+        m_scores = evaluate(m_result, model);
+        complete(model);
+    }
+
+    /**
+     * Waits for the holdout evaluation in progress and outputs the report.
+     */
+    void wait()
+    {
+        if (m_pending) {
+            m_thread.join();
+            complete(m_snapshot);
+        }
+    }
+
+protected:
+    /**
+     * Finishes the holdout evaluation of the pending report.
+     *  @param  model       The weight vector evaluated.
+     */
+    void complete(model_type& model)
+    {
+        // Keep the weight vector if it yields the best score so far.
+        if (0 < m_patience) {
+            double score = m_scores.get(m_metric);
+            if (m_best_iteration == 0 || m_best_score + m_min_delta < score) {
+                if (&model == &m_snapshot) {
+                    m_best.swap(m_snapshot);
+                } else {
+                    m_best = model;
+                }
+                m_best_score = score;
+                m_best_iteration = m_iteration;
+                m_num_stalls = 0;
+            } else {
+                ++m_num_stalls;
+            }
+        }
+
+        // Output the report with the evaluation result.
+        *m_os << m_report << m_result.str();
+        if (0 < m_patience) {
+            *m_os << "Best " << m_metric << ": " <<
+                std::fixed << std::setprecision(4) << m_best_score <<
+                std::setprecision(6) <<
+                " (iteration #" << m_best_iteration << ")" << std::endl;
+            m_os->unsetf(std::ios::fixed);
+        }
+        *m_os << std::endl;
+        m_os->flush();
+        m_pending = false;
+    }
+
+    /**
+     * Evaluates a weight vector on the holdout data.
+     *  @param  os          The output stream for the evaluation result.
+     *  @param  model       The weight vector.
+     *  @return holdout_scores  The scores of the evaluation.
+     */
+    virtual holdout_scores evaluate(std::ostream& os, model_type& model) = 0;
+
+    static void __evaluate(void *inst)
+    {
+        this_class* pt = reinterpret_cast<this_class*>(inst);
+        pt->m_scores = pt->evaluate(pt->m_result, pt->m_snapshot);
+    }
+};
+
+
+
+/**
+ * Holdout evaluations for binary classification.
+ *
+ *  @param  data_tmpl   The type of a data set.
+ *  @param  error_tmpl  The type of a classifier for the evaluation.
+ */
+template <
+    class data_tmpl,
+    class error_tmpl
+>
+class holdout_evaluator_binary :
+    public holdout_evaluator_base<typename error_tmpl::model_type>
+{
+public:
+    /// The type representing a data set.
+    typedef data_tmpl data_type;
+    /// The type implementing a classifier.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type of the base class.
+    typedef holdout_evaluator_base<model_type> base_class;
+
+protected:
+    /// The data set.
+    const data_type* m_data;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    holdout_evaluator_binary() : m_data(NULL)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~holdout_evaluator_binary()
+    {
+        // Make sure that the thread does not call evaluate() any longer.
+        this->m_thread.join();
+    }
+
+    /**
+     * Starts holdout evaluations.
+     *  @param  os          The output stream for progress reports.
+     *  @param  data        The data set for training (and holdout evaluation).
+     *  @param  holdout     The group number for holdout evaluation.
+     *  @param  period      The period (in iterations) of holdout
+     *                      evaluations.
+     *  @param  async       \c true to evaluate in a background thread.
+     */
+    void start(
+        std::ostream& os,
+        const data_type& data,
+        int holdout,
+        int period,
+        bool async
+        )
+    {
+        base_class::start(os, holdout, period, async);
+        m_data = &data;
+    }
+
+protected:
+    holdout_scores evaluate(std::ostream& os, model_type& model)
+    {
+        error_type cla(model);
+        return holdout_evaluation_binary(
+            os,
+            m_data->begin(),
+            m_data->end(),
+            cla,
+            this->m_holdout
+            );
+    }
+};
+
+
+
+/**
+ * Holdout evaluations for multi/candidate classification.
+ *
+ *  @param  data_tmpl   The type of a data set.
+ *  @param  error_tmpl  The type of a classifier for the evaluation.
+ */
+template <
+    class data_tmpl,
+    class error_tmpl
+>
+class holdout_evaluator_multi :
+    public holdout_evaluator_base<typename error_tmpl::model_type>
+{
+public:
+    /// The type representing a data set.
+    typedef data_tmpl data_type;
+    /// The type implementing a classifier.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type of the base class.
+    typedef holdout_evaluator_base<model_type> base_class;
+
+protected:
+    /// The data set.
+    const data_type* m_data;
+    /// Whether the evaluation reports accuracy scores only.
+    bool m_acconly;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    holdout_evaluator_multi() : m_data(NULL), m_acconly(true)
+    {
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~holdout_evaluator_multi()
+    {
+        // Make sure that the thread does not call evaluate() any longer.
+        this->m_thread.join();
+    }
+
+    /**
+     * Starts holdout evaluations.
+     *  @param  os          The output stream for progress reports.
+     *  @param  data        The data set for training (and holdout evaluation).
+     *  @param  holdout     The group number for holdout evaluation.
+     *  @param  acconly     \c true to report accuracy scores only.
+     *  @throw  invalid_parameter   Early stopping on an F1 score is
+     *                              configured with \a acconly.
+     *  @param  period      The period (in iterations) of holdout
+     *                      evaluations.
+     *  @param  async       \c true to evaluate in a background thread.
+     */
+    void start(
+        std::ostream& os,
+        const data_type& data,
+        int holdout,
+        bool acconly,
+        int period,
+        bool async
+        )
+    {
+        if (acconly && 0 < this->m_patience && this->m_metric != "accuracy") {
+            throw invalid_parameter(
+                "Early stopping on F1 scores is unavailable for this task");
+        }
+        base_class::start(os, holdout, period, async);
+        m_data = &data;
+        m_acconly = acconly;
+    }
+
+protected:
+    holdout_scores evaluate(std::ostream& os, model_type& model)
+    {
+        error_type cla(model);
+        return holdout_evaluation_multi(
+            os,
+            m_data->begin(),
+            m_data->end(),
+            cla,
+            m_data->feature_generator,
+            this->m_holdout,
+            m_acconly,
+            m_data->labels,
+            m_data->positive_labels.begin(),
+            m_data->positive_labels.end()
+            );
+    }
+};
+
+};
+
+};
+
+#endif/*__CLASSIAS_TRAIN_HOLDOUT_H__*/
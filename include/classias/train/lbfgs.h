@@ -39,6 +39,7 @@
 #include <iostream>
 #include <limits.h>
 #include <set>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -49,6 +50,7 @@
 #include <classias/evaluation.h>
 #include <classias/classify/linear/binary.h>
 #include <classias/classify/linear/multi.h>
+#include <classias/train/holdout.h>
 
 namespace classias
 {
@@ -60,6 +62,9 @@ namespace train
  * The base class for gradient descent using L-BFGS.
  *  This class implements internal variables, operations, and interface
  *  that are common for training a binary/multi classification.
+ *  Unlike online training algorithms, the weight vector must store values
+ *  in double precision because the L-BFGS routine works on the array of
+ *  weights directly.
  *
  *  @param  model_tmpl  The type of a weight vector for features.
  */
@@ -101,6 +106,16 @@ protected:
     std::string m_lbfgs_linesearch;
     /// The maximum number of trials for the line search algorithm.
     int m_lbfgs_max_linesearch;
+    /// The period (in iterations) of holdout evaluations.
+    int m_holdout_period;
+    /// Whether holdout evaluations run in a background thread.
+    int m_holdout_async;
+    /// The patience (in evaluations) for early stopping.
+    int m_holdout_patience;
+    /// The minimum improvement of the holdout metric for early stopping.
+    value_type m_holdout_min_delta;
+    /// The holdout metric for early stopping.
+    std::string m_holdout_metric;
 
     /// A group number for holdout evaluation.
     int m_holdout;
@@ -111,6 +126,10 @@ protected:
     clock_t m_clk_prev;
     /// The start index for regularization.
     int m_regularization_start;
+    /// The number of active features at the latest evaluation.
+    int m_num_actives;
+    /// Whether the iterations were terminated by early stopping.
+    bool m_early_stopped;
 
 public:
     /**
@@ -138,6 +157,7 @@ public:
         // Initialize the members.
         m_holdout = -1;
         m_os = NULL;
+        m_early_stopped = false;
 
         // Initialize the parameters.
         m_params.init("c1", &m_c1, 0.0,
@@ -161,6 +181,18 @@ public:
             "{'MoreThuente': More and Thuente's method, 'Backtracking': backtracking}");
         m_params.init("max_linesearch", &m_lbfgs_max_linesearch, 20,
             "The maximum number of trials for the line search algorithm.");
+        m_params.init("holdout_period", &m_holdout_period, 1,
+            "The period (in iterations) of holdout evaluations.");
+        m_params.init("holdout_async", &m_holdout_async, 1,
+            "Evaluate a snapshot of the model on the holdout data in a background\n"
+            "thread while the training proceeds {0: no, 1: yes}.");
+        m_params.init("holdout_patience", &m_holdout_patience, 0,
+            "Stop the training when the holdout metric has not improved for this number\n"
+            "of evaluations, and use the model with the best holdout metric (0: disabled).");
+        m_params.init("holdout_min_delta", &m_holdout_min_delta, 0.,
+            "The minimum increase of the holdout metric regarded as an improvement.");
+        m_params.init("holdout_metric", &m_holdout_metric, "accuracy",
+            "The holdout metric for early stopping {'accuracy', 'micro_f1', 'macro_f1'}.");
     }
 
 protected:
@@ -238,40 +270,32 @@ protected:
         int ls)
     {
         // Compute the duration required for this iteration.
-        std::ostream& os = *m_os;
         clock_t duration, clk = std::clock();
         duration = clk - m_clk_prev;
         m_clk_prev = clk;
 
-        // Count the number of active features.
-        int num_active = 0;
-        for (int i = 0;i < n;++i) {
-            if (x[i] != 0.) {
-                ++num_active;
-            }
-        }
+        // The number of active features was counted by loss_and_gradient()
+        // for the latest evaluation, which was made at x.
+        int num_active = m_num_actives;
 
         // Output the current progress.
-        os << "***** Iteration #" << k << " *****" << std::endl;
-        os << "Loss: " << fx << std::endl;
-        os << "Feature L2-norm: " << xnorm << std::endl;
-        os << "Error norm: " << gnorm << std::endl;
-        os << "Active features: " << num_active << " / " << n << std::endl;
-        os << "Line search trials: " << ls << std::endl;
-        os << "Line search step: " << step << std::endl;
-        os << "Seconds required for this iteration: " <<
+        std::ostringstream rs;
+        rs << "***** Iteration #" << k << " *****" << std::endl;
+        rs << "Loss: " << fx << std::endl;
+        rs << "Feature L2-norm: " << xnorm << std::endl;
+        rs << "Error norm: " << gnorm << std::endl;
+        rs << "Active features: " << num_active << " / " << n << std::endl;
+        rs << "Line search trials: " << ls << std::endl;
+        rs << "Line search step: " << step << std::endl;
+        rs << "Seconds required for this iteration: " <<
             duration / (double)CLOCKS_PER_SEC << std::endl;
-        os.flush();
 
-        // Holdout evaluation if necessary.
-        if (0 <= m_holdout) {
-            holdout_evaluation();
+        // Output the report with a holdout evaluation if necessary, and
+        // terminate if the holdout metric has stopped improving.
+        if (holdout_evaluation(k, rs.str()) != 0) {
+            m_early_stopped = true;
+            return 1;
         }
-
-        // Output an empty line.
-        os << std::endl;
-        os.flush();
-
         return 0;
     }
 
@@ -301,6 +325,8 @@ protected:
         // Store the start clock.
         m_os = &os;
         m_clk_prev = clock();
+        m_num_actives = 0;
+        m_early_stopped = false;
         m_holdout = holdout;
         m_regularization_start = regularization_start;
 
@@ -318,7 +344,9 @@ protected:
 
     void lbfgs_output_status(std::ostream& os, int status)
     {
-        if (status == LBFGS_CONVERGENCE) {
+        if (m_early_stopped) {
+            os << "L-BFGS terminated with the early stopping criterion" << std::endl;
+        } else if (status == LBFGS_CONVERGENCE) {
             os << "L-BFGS resulted in convergence" << std::endl;
         } else if (status == LBFGS_STOP) {
             os << "L-BFGS terminated with the stopping criteria" << std::endl;
@@ -333,7 +361,15 @@ protected:
         const int n
         ) = 0;
 
-    virtual void holdout_evaluation() = 0;
+    /**
+     * Outputs the progress report of an iteration with a holdout
+     * evaluation if necessary.
+     *  @param  k           The iteration number.
+     *  @param  report      The progress report of the iteration.
+     *  @return int         Non-zero value to terminate the L-BFGS iterations
+     *                      with the early stopping criterion.
+     */
+    virtual int holdout_evaluation(int k, const std::string& report) = 0;
 
 public:
     /**
@@ -393,10 +429,14 @@ public:
     typedef typename features_type::identifier_type feature_identifier_type;
     /// A classifier type.
     typedef classify::linear_binary_logistic<model_type> error_type;
+    /// The type implementing holdout evaluations.
+    typedef holdout_evaluator_binary<data_type, error_type> evaluator_type;
 
 protected:
     /// A data set for training.
     const data_type* m_data;
+    /// The holdout evaluator.
+    evaluator_type m_evaluator;
 
 public:
     /**
@@ -442,9 +482,14 @@ protected:
         value_type loss = 0;
         error_type cls(this->m_w); // we know that &m_w[0] and x are identical.
 
-        // Initialize the gradients with zero.
+        // Initialize the gradients with zero, and count the number of
+        // active features.
+        this->m_num_actives = 0;
         for (int i = 0;i < n;++i) {
             g[i] = 0.;
+            if (x[i] != 0.) {
+                ++this->m_num_actives;
+            }
         }
 
         // For each instance in the data.
@@ -504,12 +549,22 @@ public:
 
         // Call the L-BFGS solver.
         m_data = &data;
+        m_evaluator.early_stopping(
+            this->m_holdout_patience, this->m_holdout_min_delta,
+            this->m_holdout_metric);
+        m_evaluator.start(
+            os, data, holdout,
+            this->m_holdout_period, this->m_holdout_async != 0);
         int ret = this->lbfgs_solve(
             (const int)K,
             os,
             holdout,
             data.get_user_feature_start()
             );
+        m_evaluator.wait();
+        if (m_evaluator.has_best()) {
+            this->m_w = m_evaluator.best();
+        }
 
         // Report the result from the L-BFGS solver.
         this->lbfgs_output_status(os, ret);
@@ -517,19 +572,18 @@ public:
 
 protected:
     /**
-     * Performs a holdout evaluation.
+     * Outputs the progress report of an iteration with a holdout
+     * evaluation if necessary.
+     *  @param  k           The iteration number.
+     *  @param  report      The progress report of the iteration.
+     *  @return int         Non-zero value to terminate the L-BFGS iterations
+     *                      with the early stopping criterion.
      */
-    void holdout_evaluation()
+    int holdout_evaluation(int k, const std::string& report)
     {
-        error_type cla(this->m_w);
-
-        holdout_evaluation_binary(
-            *this->m_os,
-            this->m_data->begin(),
-            this->m_data->end(),
-            cla,
-            this->m_holdout
-            );
+        // We know that &m_w[0] and x are identical.
+        m_evaluator.submit(k, report, this->m_w);
+        return m_evaluator.stopped() ? 1 : 0;
     }
 };
 
@@ -571,13 +625,17 @@ protected:
     typedef typename data_type::attribute_type attribute_type;
     /// The type of a classifier.
     typedef classify::linear_multi_logistic<model_type> error_type;
+    /// The type implementing holdout evaluations.
+    typedef holdout_evaluator_multi<data_type, error_type> evaluator_type;
 
     /// An array [K] of observation expectations.
-    value_type *m_oexps;
+    model_type m_oexps;
     /// A data set for training.
     const data_type* m_data;
     /// The flag indicating whether 
     bool m_acconly;
+    /// The holdout evaluator.
+    evaluator_type m_evaluator;
 
 public:
     /**
@@ -585,7 +643,6 @@ public:
      */
     lbfgs_logistic_multi()
     {
-        m_oexps = NULL;
         m_data = NULL;
         m_acconly = true;
         clear();
@@ -604,8 +661,7 @@ public:
      */
     void clear()
     {
-        delete[] m_oexps;
-        m_oexps = NULL;
+        m_oexps.clear();
         m_data = NULL;
         base_class::clear();
     }
@@ -629,9 +685,14 @@ protected:
         const int L = data.num_labels();
         error_type cls(this->m_w); // We know that &m_w[0] and x are identical.
 
-        // Initialize the gradients with (the negative of) observation expexcations.
+        // Initialize the gradients with (the negative of) observation
+        // expexcations, and count the number of active features.
+        this->m_num_actives = 0;
         for (int i = 0;i < n;++i) {
             g[i] = -m_oexps[i];
+            if (x[i] != 0.) {
+                ++this->m_num_actives;
+            }
         }
 
         // For each instance in the data.
@@ -657,11 +718,12 @@ protected:
             for (int i = 0;i < inst.num_candidates(L);++i) {
                 const attributes_type& v = inst.attributes(i);
                 this->add_weights(
-                    g, i, data.feature_generator, v.begin(), v.end(), cls.prob(i));
+                    g, i, data.feature_generator, v.begin(), v.end(),
+                    inst.get_weight() * cls.prob(i));
             }
 
             // Accumulate the loss for predicting the instance.
-            loss -= cls.logprob(inst.get_label());
+            loss -= inst.get_weight() * cls.logprob(inst.get_label());
         }
 
         return loss;
@@ -690,7 +752,7 @@ public:
 
         // Initialize feature expectations and weights.
         this->initialize_weights(K);
-        m_oexps = new double[K];
+        m_oexps.resize(K);
         for (size_t k = 0;k < K;++k) {
             m_oexps[k] = 0.;
         }
@@ -712,18 +774,29 @@ public:
             const int l = iti->get_label();
             const attributes_type& v = iti->attributes(l);
             this->add_weights(
-                m_oexps, l, data.feature_generator, v.begin(), v.end(), 1.0);
+                &m_oexps[0], l, data.feature_generator, v.begin(), v.end(),
+                iti->get_weight());
         }
 
         // Call the L-BFGS solver.
         m_data = &data;
         m_acconly = acconly;
+        m_evaluator.early_stopping(
+            this->m_holdout_patience, this->m_holdout_min_delta,
+            this->m_holdout_metric);
+        m_evaluator.start(
+            os, data, holdout, acconly,
+            this->m_holdout_period, this->m_holdout_async != 0);
         int ret = this->lbfgs_solve(
             (const int)K,
             os,
             holdout,
             data.get_user_feature_start()
             );
+        m_evaluator.wait();
+        if (m_evaluator.has_best()) {
+            this->m_w = m_evaluator.best();
+        }
 
         // Report the result from the L-BFGS solver.
         this->lbfgs_output_status(os, ret);
@@ -731,24 +804,18 @@ public:
 
 protected:
     /**
-     * Performs a holdout evaluation.
+     * Outputs the progress report of an iteration with a holdout
+     * evaluation if necessary.
+     *  @param  k           The iteration number.
+     *  @param  report      The progress report of the iteration.
+     *  @return int         Non-zero value to terminate the L-BFGS iterations
+     *                      with the early stopping criterion.
      */
-    void holdout_evaluation()
+    int holdout_evaluation(int k, const std::string& report)
     {
-        error_type cla(this->m_w);
-
-        holdout_evaluation_multi(
-            *this->m_os,
-            this->m_data->begin(),
-            this->m_data->end(),
-            cla,
-            this->m_data->feature_generator,
-            this->m_holdout,
-            this->m_acconly,
-            this->m_data->labels,
-            this->m_data->positive_labels.begin(),
-            this->m_data->positive_labels.end()
-            );
+        // We know that &m_w[0] and x are identical.
+        m_evaluator.submit(k, report, this->m_w);
+        return m_evaluator.stopped() ? 1 : 0;
     }
 
 protected:
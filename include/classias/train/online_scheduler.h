@@ -39,9 +39,12 @@
 #include <numeric>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 #include <vector>
 #include <classias/parameters.h>
 #include <classias/evaluation.h>
+#include <classias/shard.h>
+#include <classias/train/holdout.h>
 
 namespace classias {
 
@@ -120,10 +123,14 @@ public:
     typedef typename trainer_type::error_type error_type;
     /// The type implementing a model (weight vector for features).
     typedef typename trainer_type::model_type model_type;
+    /// The type implementing holdout evaluations.
+    typedef holdout_evaluator_binary<data_type, error_type> evaluator_type;
 
 protected:
     /// Trainer type.
     trainer_type m_trainer;
+    /// The holdout evaluator.
+    evaluator_type m_evaluator;
     /// The sample method.
     std::string m_sample;
     /// The maximum number of iterations.
@@ -134,6 +141,16 @@ protected:
     int m_period;
     /// The epsilon for improvement ratio.
     value_type m_epsilon;
+    /// The period (in iterations) of holdout evaluations.
+    int m_holdout_period;
+    /// Whether holdout evaluations run in a background thread.
+    int m_holdout_async;
+    /// The patience (in evaluations) for early stopping.
+    int m_holdout_patience;
+    /// The minimum improvement of the holdout metric for early stopping.
+    value_type m_holdout_min_delta;
+    /// The holdout metric for early stopping.
+    std::string m_holdout_metric;
 
 public:
     /**
@@ -169,6 +186,18 @@ public:
             "The period to measure the improvement ratio");
         par.init("epsilon", &m_epsilon, 1e-4,
             "The stopping criterion for the improvement ratio");
+        par.init("holdout_period", &m_holdout_period, 1,
+            "The period (in iterations) of holdout evaluations.");
+        par.init("holdout_async", &m_holdout_async, 1,
+            "Evaluate a snapshot of the model on the holdout data in a background\n"
+            "thread while the training proceeds {0: no, 1: yes}.");
+        par.init("holdout_patience", &m_holdout_patience, 0,
+            "Stop the training when the holdout metric has not improved for this number\n"
+            "of evaluations, and use the model with the best holdout metric (0: disabled).");
+        par.init("holdout_min_delta", &m_holdout_min_delta, 0.,
+            "The minimum increase of the holdout metric regarded as an improvement.");
+        par.init("holdout_metric", &m_holdout_metric, "accuracy",
+            "The holdout metric for early stopping {'accuracy', 'micro_f1', 'macro_f1'}.");
     }
 
     /**
@@ -184,10 +213,15 @@ public:
 
     /**
      * Obtains a read-only access to the weight vector (model).
+     *  This function returns the weight vector that yielded the best
+     *  holdout metric if early stopping is enabled.
      *  @return const model_type&   The weight vector (model).
      */
     const model_type& model() const
     {
+        if (m_evaluator.has_best()) {
+            return m_evaluator.best();
+        }
         return m_trainer.model();
     }
 
@@ -211,7 +245,11 @@ public:
         // Ring buffer for moving averages.
         std::vector<value_type> pf(m_period);
 
-        // Set the number of instances for the target algorithm.
+        // Set the number of instances for the target algorithm. This is
+        // the number of instances stored (not the sum of their weights):
+        // an epoch applies the regularization (c / n) once per stored
+        // instance, and merged duplicates (weighted by their counts) bring
+        // the same loss per epoch, so the same c yields the same model.
         parameter_exchange& par = this->params();
         par.set("n", (double)data.size(), false);
 
@@ -225,6 +263,10 @@ public:
 
         // Initialize the training algorithm.
         m_trainer.start();
+        m_evaluator.early_stopping(
+            m_holdout_patience, m_holdout_min_delta, m_holdout_metric);
+        m_evaluator.start(
+            os, data, holdout, m_holdout_period, m_holdout_async != 0);
 
         // Loop for iterations.
         for (int k = 1;k <= m_max_iterations;++k) {
@@ -233,34 +275,7 @@ public:
             clock_t clk = std::clock();
 
             // Send instances to the algorithm.
-            if (m_sample == "random") {
-                // Choose N instances at random.
-                for (size_t i = 0;i < data.size();++i) {
-                    const_iterator it = random_sample(data.begin(), data.end());
-                    if (it->get_group() != holdout) {
-                        m_trainer.update(it);
-                    }
-                }
-            } else if (m_sample == "cycle") {
-                // Do not change the ordering of instances.
-                for (const_iterator it = data.begin();it != data.end();++it) {
-                    if (it->get_group() != holdout) {
-                        m_trainer.update(it);
-                    }
-                }
-            } else if (m_sample == "shuffle") {
-                // Shuffle N instances first.
-                std::vector<const_iterator> perm(data.size());
-                shuffle_permutation(perm, data.begin(), data.end());
-                for (size_t i = 0;i < perm.size();++i) {
-                    const_iterator it = perm[i];
-                    if (it->get_group() != holdout) {
-                        m_trainer.update(it);
-                    }
-                }
-            } else {
-                throw invalid_parameter("Unknown sampling method for instances");
-            }
+            feed(data, holdout);
 
             // Pause the training process, and compute the loss.
             m_trainer.discontinue();
@@ -282,42 +297,109 @@ public:
             }
 
             // Report the progress.
-            os << "***** Iteration #" << k << " *****" << std::endl;
-            m_trainer.report(os);
+            std::ostringstream rs;
+            rs << "***** Iteration #" << k << " *****" << std::endl;
+            m_trainer.report(rs);
             if (m_period < k) {
-                os << "Loss variance: " << nvar << std::endl;
+                rs << "Loss variance: " << nvar << std::endl;
             }
-            os << "Seconds required for this iteration: " <<
+            rs << "Seconds required for this iteration: " <<
                 (std::clock() - clk) / (double)CLOCKS_PER_SEC << std::endl;
 
-            // Holdout evaluation if necessary.
-            if (0 <= holdout) {
-                error_type cla(m_trainer.model());
-                holdout_evaluation_binary(
-                    os,
-                    data.begin(),
-                    data.end(),
-                    cla,
-                    holdout
-                    );
-            }
-
-            // Flush the output stream.
-            os << std::endl;
-            os.flush();
+            // Output the report with a holdout evaluation if necessary.
+            m_evaluator.submit(k, rs.str(), m_trainer.model());
 
             // Terminate if the stopping criterion is satisfied.
             if (nvar < m_epsilon) {
+                m_evaluator.wait();
                 os << "Terminated with the stopping criterion" << std::endl;
                 os << std::endl;
                 os.flush();
                 break;
             }
+
+            // Terminate if the holdout metric has stopped improving.
+            if (m_evaluator.stopped()) {
+                m_evaluator.wait();
+                os << "Terminated with the early stopping criterion" << std::endl;
+                os << std::endl;
+                os.flush();
+                break;
+            }
         }
 
+        // Wait for the holdout evaluation in progress.
+        m_evaluator.wait();
+
         // Finalize the training procedure.
         m_trainer.finish();
     }
+
+protected:
+    /**
+     * Sends the instances in a data set to the training algorithm.
+     *  @param  data        The data set.
+     *  @param  holdout     The group number for holdout evaluation.
+     */
+    template <class dataset_type>
+    void feed(const dataset_type& data, int holdout)
+    {
+        if (m_sample == "random") {
+            // Choose N instances at random.
+            for (size_t i = 0;i < data.size();++i) {
+                const_iterator it = random_sample(data.begin(), data.end());
+                if (it->get_group() != holdout) {
+                    m_trainer.update(it);
+                }
+            }
+        } else if (m_sample == "cycle") {
+            // Do not change the ordering of instances.
+            for (const_iterator it = data.begin();it != data.end();++it) {
+                if (it->get_group() != holdout) {
+                    m_trainer.update(it);
+                }
+            }
+        } else if (m_sample == "shuffle") {
+            // Shuffle N instances first.
+            std::vector<const_iterator> perm(data.size());
+            shuffle_permutation(perm, data.begin(), data.end());
+            for (size_t i = 0;i < perm.size();++i) {
+                const_iterator it = perm[i];
+                if (it->get_group() != holdout) {
+                    m_trainer.update(it);
+                }
+            }
+        } else {
+            throw invalid_parameter("Unknown sampling method for instances");
+        }
+    }
+
+    /**
+     * Sends the instances in the shards of a data set to the training
+     * algorithm.
+     *  The sampling method "shuffle" shuffles the order of the shards and
+     *  the instances in every shard; "random" is unavailable.
+     *  @param  data        The data set.
+     *  @param  holdout     The group number for holdout evaluation.
+     */
+    template <class dataset_type>
+    void feed(const sharded_data<dataset_type>& data, int holdout)
+    {
+        if (m_sample == "random") {
+            throw invalid_parameter("Random sampling is unavailable for instances in shards");
+        } else if (m_sample != "cycle" && m_sample != "shuffle") {
+            throw invalid_parameter("Unknown sampling method for instances");
+        }
+
+        typename sharded_data<dataset_type>::reader rd(data, m_sample == "shuffle");
+        while (rd.next()) {
+            for (const_iterator it = rd.begin();it != rd.end();++it) {
+                if (it->get_group() != holdout) {
+                    m_trainer.update(it);
+                }
+            }
+        }
+    }
 };
 
 
@@ -354,10 +436,14 @@ public:
     typedef typename trainer_type::error_type error_type;
     /// The type implementing a model (weight vector for features).
     typedef typename trainer_type::model_type model_type;
+    /// The type implementing holdout evaluations.
+    typedef holdout_evaluator_multi<data_type, error_type> evaluator_type;
 
 protected:
     /// Trainer type.
     trainer_type m_trainer;
+    /// The holdout evaluator.
+    evaluator_type m_evaluator;
     /// The sample method.
     std::string m_sample;
     /// The maximum number of iterations.
@@ -368,6 +454,16 @@ protected:
     int m_period;
     /// The epsilon for improvement ratio.
     value_type m_epsilon;
+    /// The period (in iterations) of holdout evaluations.
+    int m_holdout_period;
+    /// Whether holdout evaluations run in a background thread.
+    int m_holdout_async;
+    /// The patience (in evaluations) for early stopping.
+    int m_holdout_patience;
+    /// The minimum improvement of the holdout metric for early stopping.
+    value_type m_holdout_min_delta;
+    /// The holdout metric for early stopping.
+    std::string m_holdout_metric;
 
 public:
     /**
@@ -403,6 +499,18 @@ public:
             "The period to measure the improvement ratio");
         par.init("epsilon", &m_epsilon, 1e-6,
             "The stopping criterion for the improvement ratio");
+        par.init("holdout_period", &m_holdout_period, 1,
+            "The period (in iterations) of holdout evaluations.");
+        par.init("holdout_async", &m_holdout_async, 1,
+            "Evaluate a snapshot of the model on the holdout data in a background\n"
+            "thread while the training proceeds {0: no, 1: yes}.");
+        par.init("holdout_patience", &m_holdout_patience, 0,
+            "Stop the training when the holdout metric has not improved for this number\n"
+            "of evaluations, and use the model with the best holdout metric (0: disabled).");
+        par.init("holdout_min_delta", &m_holdout_min_delta, 0.,
+            "The minimum increase of the holdout metric regarded as an improvement.");
+        par.init("holdout_metric", &m_holdout_metric, "accuracy",
+            "The holdout metric for early stopping {'accuracy', 'micro_f1', 'macro_f1'}.");
     }
 
     /**
@@ -418,10 +526,15 @@ public:
 
     /**
      * Obtains a read-only access to the weight vector (model).
+     *  This function returns the weight vector that yielded the best
+     *  holdout metric if early stopping is enabled.
      *  @return const model_type&   The weight vector (model).
      */
     const model_type& model() const
     {
+        if (m_evaluator.has_best()) {
+            return m_evaluator.best();
+        }
         return m_trainer.model();
     }
 
@@ -445,7 +558,11 @@ public:
         // Ring buffer for moving averages.
         std::vector<value_type> pf(m_period);
 
-        // Set the number of instances for the target algorithm.
+        // Set the number of instances for the target algorithm. This is
+        // the number of instances stored (not the sum of their weights):
+        // an epoch applies the regularization (c / n) once per stored
+        // instance, and merged duplicates (weighted by their counts) bring
+        // the same loss per epoch, so the same c yields the same model.
         parameter_exchange& par = this->params();
         par.set("n", (double)data.size(), false);
 
@@ -459,6 +576,10 @@ public:
 
         // Initialize the training algorithm.
         m_trainer.start();
+        m_evaluator.early_stopping(
+            m_holdout_patience, m_holdout_min_delta, m_holdout_metric);
+        m_evaluator.start(
+            os, data, holdout, acconly, m_holdout_period, m_holdout_async != 0);
 
         // Loop for iterations.
         for (int k = 1;k <= m_max_iterations;++k) {
@@ -467,37 +588,7 @@ public:
             clock_t clk = std::clock();
 
             // Send instances to the algorithm.
-            if (m_sample == "random") {
-                // Choose N instances at random.
-                for (size_t i = 0;i < data.size();++i) {
-                    const_iterator it = random_sample(data.begin(), data.end());
-                    if (it->get_group() != holdout) {
-                        m_trainer.update(
-                            it, const_cast<data_type&>(data).feature_generator);
-                    }
-                }
-            } else if (m_sample == "cycle") {
-                // Do not change the ordering of instances.
-                for (const_iterator it = data.begin();it != data.end();++it) {
-                    if (it->get_group() != holdout) {
-                        m_trainer.update(
-                            it, const_cast<data_type&>(data).feature_generator);
-                    }
-                }
-            } else if (m_sample == "shuffle") {
-                // Shuffle N instances first.
-                std::vector<const_iterator> perm(data.size());
-                shuffle_permutation(perm, data.begin(), data.end());
-                for (size_t i = 0;i < perm.size();++i) {
-                    const_iterator it = perm[i];
-                    if (it->get_group() != holdout) {
-                        m_trainer.update(
-                            it, const_cast<data_type&>(data).feature_generator);
-                    }
-                }
-            } else {
-                throw invalid_parameter("Unknown sampling method for instances");
-            }
+            feed(data, holdout);
 
             // Pause the training process, and compute the loss.
             m_trainer.discontinue();
@@ -519,47 +610,113 @@ public:
             }
 
             // Report the progress.
-            os << "***** Iteration #" << k << " *****" << std::endl;
-            m_trainer.report(os);
+            std::ostringstream rs;
+            rs << "***** Iteration #" << k << " *****" << std::endl;
+            m_trainer.report(rs);
             if (m_period < k) {
-                os << "Loss variance: " << nvar << std::endl;
+                rs << "Loss variance: " << nvar << std::endl;
             }
-            os << "Seconds required for this iteration: " <<
+            rs << "Seconds required for this iteration: " <<
                 (std::clock() - clk) / (double)CLOCKS_PER_SEC << std::endl;
 
-            // Holdout evaluation if necessary.
-            if (0 <= holdout) {
-                error_type cla(m_trainer.model());
-                holdout_evaluation_multi(
-                    os,
-                    data.begin(),
-                    data.end(),
-                    cla,
-                    data.feature_generator,
-                    holdout,
-                    acconly,
-                    data.labels,
-                    data.positive_labels.begin(),
-                    data.positive_labels.end()
-                    );
-            }
-
-            // Flush the output stream.
-            os << std::endl;
-            os.flush();
+            // Output the report with a holdout evaluation if necessary.
+            m_evaluator.submit(k, rs.str(), m_trainer.model());
 
             // Terminate if the stopping criterion is satisfied.
             if (nvar < m_epsilon) {
+                m_evaluator.wait();
                 os << "Terminated with the stopping criterion" << std::endl;
                 os << std::endl;
                 os.flush();
                 break;
             }
+
+            // Terminate if the holdout metric has stopped improving.
+            if (m_evaluator.stopped()) {
+                m_evaluator.wait();
+                os << "Terminated with the early stopping criterion" << std::endl;
+                os << std::endl;
+                os.flush();
+                break;
+            }
         }
 
+        // Wait for the holdout evaluation in progress.
+        m_evaluator.wait();
+
         // Finalize the training procedure.
         m_trainer.finish();
     }
+
+protected:
+    /**
+     * Sends the instances in a data set to the training algorithm.
+     *  @param  data        The data set.
+     *  @param  holdout     The group number for holdout evaluation.
+     */
+    template <class dataset_type>
+    void feed(const dataset_type& data, int holdout)
+    {
+        if (m_sample == "random") {
+            // Choose N instances at random.
+            for (size_t i = 0;i < data.size();++i) {
+                const_iterator it = random_sample(data.begin(), data.end());
+                if (it->get_group() != holdout) {
+                    m_trainer.update(
+                        it, const_cast<data_type&>(data).feature_generator);
+                }
+            }
+        } else if (m_sample == "cycle") {
+            // Do not change the ordering of instances.
+            for (const_iterator it = data.begin();it != data.end();++it) {
+                if (it->get_group() != holdout) {
+                    m_trainer.update(
+                        it, const_cast<data_type&>(data).feature_generator);
+                }
+            }
+        } else if (m_sample == "shuffle") {
+            // Shuffle N instances first.
+            std::vector<const_iterator> perm(data.size());
+            shuffle_permutation(perm, data.begin(), data.end());
+            for (size_t i = 0;i < perm.size();++i) {
+                const_iterator it = perm[i];
+                if (it->get_group() != holdout) {
+                    m_trainer.update(
+                        it, const_cast<data_type&>(data).feature_generator);
+                }
+            }
+        } else {
+            throw invalid_parameter("Unknown sampling method for instances");
+        }
+    }
+
+    /**
+     * Sends the instances in the shards of a data set to the training
+     * algorithm.
+     *  The sampling method "shuffle" shuffles the order of the shards and
+     *  the instances in every shard; "random" is unavailable.
+     *  @param  data        The data set.
+     *  @param  holdout     The group number for holdout evaluation.
+     */
+    template <class dataset_type>
+    void feed(const sharded_data<dataset_type>& data, int holdout)
+    {
+        if (m_sample == "random") {
+            throw invalid_parameter("Random sampling is unavailable for instances in shards");
+        } else if (m_sample != "cycle" && m_sample != "shuffle") {
+            throw invalid_parameter("Unknown sampling method for instances");
+        }
+
+        typename sharded_data<dataset_type>::reader rd(data, m_sample == "shuffle");
+        while (rd.next()) {
+            for (const_iterator it = rd.begin();it != rd.end();++it) {
+                if (it->get_group() != holdout) {
+                    m_trainer.update(
+                        it, const_cast<data_type&>(data).feature_generator);
+                }
+            }
+        }
+    }
 };
 
 };
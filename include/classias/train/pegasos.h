@@ -52,6 +52,11 @@ namespace train
  *      Pegasos: Primal Estimated sub-GrAdient SOlver for SVM.
  *      In Proc. of ICML 2007, pp 807-814, 2007.
  *
+ *  When the parameter "average" is set to 1, the model is the average of
+ *  the weight vectors after every update (averaged stochastic gradient
+ *  descent). The running average is maintained lazily in terms of the
+ *  scaled representation W = scale * V so that an update remains O(d).
+ *
  *  This class implements internal variables, operations, and interface
  *  that are common for training a binary/multi classification.
  *
@@ -69,7 +74,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of this class.
     typedef pegasos_base<error_tmpl> this_class;
 
@@ -86,11 +91,19 @@ public:
 protected:
     /// The array of feature weights.
     model_type m_model;
+    /// The array of the corrections for the sum of weight vectors.
+    model_type m_wsum;
+    /// The array of averaged feature weights.
+    model_type m_avg;
+    /// The set of features whose weights have been updated.
+    index_set m_touched;
 
     /// The lambda (coefficient for L2 regularization).
     value_type m_lambda;
     /// The square of the L2-norm of feature weights.
     value_type m_norm22;
+    /// The number of active features.
+    int m_num_actives;
     /// The decay factor for feature weights.
     value_type m_decay;
     /// The projection factor for feature weights.
@@ -105,6 +118,8 @@ protected:
     value_type m_loss;
     /// The update count.
     value_type m_t;
+    /// The sum of scaling factors for computing the averaged weights.
+    value_type m_sum_scale;
 
     /// Parameter interface.
     parameter_exchange m_params;
@@ -114,6 +129,8 @@ protected:
     value_type m_n;
     /// The initial learning rate.
     value_type m_eta0;
+    /// The flag indicating whether the weights are averaged.
+    int m_average;
 
 public:
     /**
@@ -138,6 +155,8 @@ public:
     {
         // Clear the weight vector.
         m_model.clear();
+        m_wsum.clear();
+        m_avg.clear();
         this->initialize_weights();
 
         // Initialize the parameters.
@@ -147,6 +166,8 @@ public:
             "The number of instances in the data set.");
         m_params.init("eta", &m_eta0, 0.1,
             "Initial learning rate");
+        m_params.init("average", &m_average, 0,
+            "Use the average of weight vectors over updates (1) or the last weight vector (0).");
     }
 
     /**
@@ -174,6 +195,20 @@ public:
         m_t0 = 1.0 / (m_lambda * m_eta0);
         m_loss = 0;
 
+        // Prepare the running average of weight vectors.
+        m_sum_scale = 0;
+        if (m_average) {
+            m_wsum.resize(m_model.size());
+            m_avg.resize(m_model.size());
+            for (size_t i = 0;i < m_model.size();++i) {
+                m_wsum[i] = 0.;
+                m_avg[i] = 0.;
+            }
+        } else {
+            m_wsum.clear();
+            m_avg.clear();
+        }
+
         m_report.loss = 0;
         m_report.norm2 = 0;
     }
@@ -215,17 +250,9 @@ public:
      */
     void report(std::ostream& os)
     {
-        // Count the number of active features.
-        int num_active = 0;
-        for (size_t i = 0;i < m_model.size();++i) {
-            if (m_model[i] != 0.) {
-                ++num_active;
-            }
-        }
-
         os << "Loss: " << m_report.loss << std::endl;
         os << "Feature L2-norm: " << m_report.norm2 << std::endl;
-        os << "Active features: " << num_active << " / " << m_model.size() << std::endl;
+        os << "Active features: " << m_num_actives << " / " << m_model.size() << std::endl;
         os << "Learning rate (eta): " << m_eta << std::endl;
         os << "Total number of feature updates: " << m_t << std::endl;
     }
@@ -240,6 +267,28 @@ protected:
         for (size_t i = 0;i < m_model.size();++i) {
             m_model[i] = 0.;
         }
+        m_touched.clear();
+        m_num_actives = 0;
+        m_norm22 = 0;
+        m_decay = 1;
+        m_proj = 1;
+        m_scale = 1;
+    }
+
+    /**
+     * Resets the weight vector during a training process.
+     *  This function sets W = 0 while keeping the running average of
+     *  weight vectors.
+     */
+    void reset_weights()
+    {
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            if (m_average) {
+                m_wsum[*it] -= m_sum_scale * m_model[*it];
+            }
+            m_model[*it] = 0.;
+        }
+        m_num_actives = 0;
         m_norm22 = 0;
         m_decay = 1;
         m_proj = 1;
@@ -249,21 +298,78 @@ protected:
     /**
      * Finalizes the weight vector.
      *  This function computes the actual weight vector W from the internal
-     *  representation (V, decay, proj).
+     *  representation (V, decay, proj). Only the features that have been
+     *  updated can have non-zero weights.
      */
     void rescale_weights()
     {
         m_norm22 = 0;
-        for (size_t i = 0;i < m_model.size();++i) {
-            m_model[i] *= m_scale;
-            m_norm22 += (m_model[i] * m_model[i]);
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            m_model[*it] *= m_scale;
+            m_norm22 += (m_model[*it] * m_model[*it]);
         }
 
+        // Keep (sum_scale * V) unchanged for the running average.
+        m_sum_scale /= m_scale;
+
         m_decay = 1;
         m_proj = 1;
         m_scale = 1;
     }
 
+    /**
+     * Accumulates the current weight vector to the running average.
+     *  This function must be called at the end of every update.
+     */
+    inline void accumulate_average()
+    {
+        if (m_average) {
+            m_sum_scale += m_scale;
+        }
+    }
+
+    /**
+     * Computes the averaged weight vector.
+     *  The sum of weight vectors after updates is (sum_scale * V - wsum).
+     */
+    void average_weights()
+    {
+        if (0 < m_t) {
+            for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+                m_avg[*it] = (m_sum_scale * m_model[*it] - m_wsum[*it]) / m_t;
+            }
+        }
+    }
+
+    /**
+     * Adds a value to the weight of a feature.
+     *  This function maintains the square of the L2-norm, the number of
+     *  active features, the set of updated features, and the correction
+     *  for the running average incrementally.
+     *  @param  i           The feature index.
+     *  @param  d           The value to be added to V[i].
+     */
+    inline void add_weight(int i, value_type d)
+    {
+        value_type w = m_model[i];
+        value_type v = w + d;
+        m_model[i] = v;
+        m_norm22 += d * (d + w + w);
+        if (w == 0.) {
+            if (v != 0.) {
+                ++m_num_actives;
+            }
+        } else if (v == 0.) {
+            --m_num_actives;
+        }
+        m_touched.insert(i);
+
+        // Correct the sum of weight vectors for the change of V.
+        if (m_average) {
+            m_wsum[i] += d * m_sum_scale;
+        }
+    }
+
 
 public:
     /**
@@ -286,6 +392,10 @@ public:
         if (m_scale != 1.) {
             this->rescale_weights();
         }
+        if (m_average) {
+            this->average_weights();
+            return m_avg;
+        }
         return m_model;
     }
 
@@ -324,7 +434,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of the base class.
     typedef pegasos_base<error_tmpl> base_class;
     /// A synonym of this class.
@@ -377,7 +487,7 @@ public:
             gain = eta / scale;
         } else {
             // decay = 0 implies that W should be initialized to 0.
-            this->initialize_weights();
+            this->reset_weights();
             gain = 1;
         }
 
@@ -390,6 +500,9 @@ public:
             scale = decay * proj;
         }
 
+        // Accumulate the weight vector to the running average.
+        this->accumulate_average();
+
         // Increment the update count.
         ++t;
     }
@@ -421,14 +534,8 @@ protected:
     template <class iterator_type>
     inline void update_weights(iterator_type first, iterator_type last, value_type delta)
     {
-        model_type& model = this->m_model;
-        value_type& norm22 = this->m_norm22;
-
         for (iterator_type it = first;it != last;++it) {
-            value_type w = model[it->first];
-            value_type d = delta * it->second;
-            model[it->first] += d;
-            norm22 += d * (d + w + w);
+            base_class::add_weight(it->first, delta * it->second);
         }
     }
 };
@@ -453,7 +560,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of the base class.
     typedef pegasos_base<error_tmpl> base_class;
     /// A synonym of this class.
@@ -520,7 +627,7 @@ public:
             gain = eta / scale;
         } else {
             // decay = 0 implies that W should be initialized to 0.
-            this->initialize_weights();
+            this->reset_weights();
             gain = 1;
         }
         gain *= it->get_weight();
@@ -547,6 +654,9 @@ public:
             scale = decay * proj;
         }
 
+        // Accumulate the weight vector to the running average.
+        this->accumulate_average();
+
         // Increment the update count.
         ++t;
     }
@@ -586,16 +696,10 @@ protected:
         value_type delta
         )
     {
-        model_type& model = this->m_model;
-        value_type& norm22 = this->m_norm22;
-
         for (iterator_type it = first;it != last;++it) {
             typename feature_generator_type::feature_type f;
             if (fgen.forward(it->first, l, f)) {
-                value_type w = model[f];
-                value_type d = delta * it->second;
-                model[f] += d;
-                norm22 += d * (d + w + w);
+                base_class::add_weight((int)f, delta * it->second);
             }
         }
     }
@@ -676,6 +780,18 @@ This is the final version of the efficient implementation:
 11:         t += 1
 12: return (scale * V)
 
+The averaged weight vector after T updates is (1/T) * sum_{t} W_t, where
+W_t = scale_t * V_t is the weight vector after the t-th update. Let
+sum_scale_t = sum_{u<=t} scale_u. When delta is added to V[f] at the t-th
+update, the element contributes delta * scale_u to every W_u (u >= t).
+Therefore,
+    sum_{t} W_t[f] = sum_scale_T * V_T[f] - wsum[f],
+    wsum[f] = sum_{updates of V[f]} delta * sum_scale_{t-1}.
+The array wsum is updated only for the features in the instance, and the
+scalar sum_scale is incremented by scale at the end of every update. When V
+is rescaled by the factor s (V *= s, scale = 1), sum_scale is divided by s
+so that (sum_scale * V) does not change.
+
 */
 
 #endif/*__CLASSIAS_TRAIN_PEGASOS_H__*/
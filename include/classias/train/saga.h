@@ -0,0 +1,778 @@
+/*
+ *      Stochastic Average Gradient Accelerated (SAGA).
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* $Id$ */
+
+#ifndef __CLASSIAS_TRAIN_SAGA_H__
+#define __CLASSIAS_TRAIN_SAGA_H__
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include <classias/types.h>
+#include <classias/quark.h>
+#include <classias/parameters.h>
+
+namespace classias
+{
+
+namespace train
+{
+
+/**
+ * The base class for SAGA, a variance-reduced stochastic gradient method.
+ *  The detail of this algorithm is described in:
+ *
+ *  -   Aaron Defazio, Francis Bach, and Simon Lacoste-Julien.
+ *      SAGA: A Fast Incremental Gradient Method With Support for
+ *      Non-Strongly Convex Composite Objectives.
+ *      In Proc. of NIPS 2014, pp 1646-1654, 2014.
+ *
+ *  The algorithm remembers the gradient of the loss function computed for
+ *  every instance at its last visit, and corrects a stochastic gradient by
+ *  the average of the remembered gradients. Because the average gradient is
+ *  dense, this class applies it to a feature weight lazily, only when the
+ *  feature appears in an instance (just-in-time update). Together with the
+ *  scaling trick used by Pegasos for L2 regularization, each update requires
+ *  O(d) computations, where d is the number of active features in the
+ *  instance.
+ *
+ *  The gradient of a linear model for an instance is represented by the
+ *  error value(s) multiplied by the feature vector. Hence, the algorithm
+ *  remembers only one scalar per instance (binary) or per candidate (multi).
+ *  The remembered values are associated with the address of an instance;
+ *  instances must not be moved during a training process, which holds for
+ *  instances in a data set given to online_scheduler_binary and
+ *  online_scheduler_multi.
+ *
+ *  This class implements internal variables, operations, and interface
+ *  that are common for training a binary/multi classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class saga_base
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// The type of an array of time stamps, which are kept in double
+    /// precision even for a single-precision model.
+    typedef typename rebind_container<model_type, value_type>::container_type stamp_type;
+    /// A synonym of this class.
+    typedef saga_base<error_tmpl> this_class;
+
+    /// The type of progress information.
+    struct report_type
+    {
+        /// The loss.
+        value_type loss;
+        /// The L2-norm of feature weights.
+        value_type norm2;
+        /// The number of active features.
+        int num_actives;
+    };
+    report_type m_report;
+
+protected:
+    /// The type associating an instance with its remembered gradients.
+    typedef UNORDERED_MAP<const void*, size_t> memory_index_type;
+
+    /// The array of feature weights (W = scale * V).
+    model_type m_w;
+    /// The array of the sums of remembered gradients for features.
+    model_type m_gsum;
+    /// The array of accumulated step sizes when features were updated.
+    stamp_type m_stamp;
+    /// The set of features whose weights have been updated.
+    index_set m_touched;
+    /// The remembered gradients (errors) of instances.
+    std::vector<value_type> m_memory;
+    /// The offsets of instances in m_memory.
+    memory_index_type m_memory_index;
+
+    /// The lambda (coefficient for L2 regularization).
+    value_type m_lambda;
+    /// The scaling factor for feature weights.
+    value_type m_scale;
+    /// The accumulated step sizes (sum of eta / scale).
+    value_type m_sum_eta;
+    /// The current learning rate.
+    value_type m_eta;
+    /// The maximum of the Lipschitz constants of instances observed so far.
+    value_type m_max_lipschitz;
+    /// The square of the L2-norm of feature weights.
+    value_type m_norm22;
+    /// The loss.
+    value_type m_loss;
+    /// The update count.
+    int m_t;
+
+    /// Parameter interface.
+    parameter_exchange m_params;
+    /// The coefficient for L2 regularization.
+    value_type m_c;
+    /// The number of instances in the data set.
+    value_type m_n;
+    /// The learning rate.
+    value_type m_eta0;
+
+public:
+    /**
+     * Constructs the object.
+     */
+    saga_base()
+    {
+        clear();
+    }
+
+    /**
+     * Destructs the object.
+     */
+    virtual ~saga_base()
+    {
+    }
+
+    /**
+     * Resets the internal states and parameters to default.
+     */
+    void clear()
+    {
+        // Clear the weight vector.
+        m_w.clear();
+        m_gsum.clear();
+        m_stamp.clear();
+        this->initialize_weights();
+
+        // Initialize the parameters.
+        m_params.init("c", &m_c, 1.,
+            "Coefficient for L2 regularization.");
+        m_params.init("n", &m_n, 1.,
+            "The number of instances in the data set.");
+        m_params.init("eta", &m_eta0, 0.,
+            "Learning rate (0: determined from the Lipschitz constants of instances)");
+    }
+
+    /**
+     * Sets the number of features.
+     *  This function resizes the weight vector.
+     *  @param  size        The number of features.
+     */
+    void set_num_features(size_t size)
+    {
+        m_w.resize(size);
+        m_gsum.resize(size);
+        m_stamp.resize(size);
+        this->initialize_weights();
+    }
+
+public:
+    /**
+     * Starts a training process.
+     *  This function resets the internal states, and prepares for a training
+     *  process.
+     */
+    void start()
+    {
+        this->initialize_weights();
+        m_lambda = 2 * m_c / m_n;
+        m_eta = m_eta0;
+        m_max_lipschitz = 0;
+        m_t = 0;
+        m_loss = 0;
+
+        m_report.loss = 0;
+        m_report.norm2 = 0;
+        m_report.num_actives = 0;
+    }
+
+    /**
+     * Terminates a training process.
+     *  This function performs a post-processing after a training process.
+     */
+    void finish()
+    {
+        this->rescale_weights();
+    }
+
+    void discontinue()
+    {
+        this->rescale_weights();
+
+        // Fill the progress information.
+        m_report.loss = m_loss + m_norm22 * m_c;
+        m_report.norm2 = std::sqrt(m_norm22);
+
+        // Reset the run-time information.
+        m_loss = 0;
+    }
+
+public:
+    /**
+     * Shows the copyright information.
+     *  @param  os          The output stream.
+     */
+    void copyright(std::ostream& os)
+    {
+        os << "SAGA for " << error_type::name() << std::endl;
+    }
+
+    /**
+     * Reports the current state of the training process.
+     *  @param  os          The output stream.
+     */
+    void report(std::ostream& os)
+    {
+        os << "Loss: " << m_report.loss << std::endl;
+        os << "Feature L2-norm: " << m_report.norm2 << std::endl;
+        os << "Active features: " << m_report.num_actives << " / " << m_w.size() << std::endl;
+        os << "Learning rate (eta): " << m_eta << std::endl;
+        os << "Remembered gradients: " << m_memory.size() << std::endl;
+        os << "Total number of feature updates: " << m_t << std::endl;
+    }
+
+protected:
+    /**
+     * Initializes the weight vector and the remembered gradients.
+     *  This function sets W = 0.
+     */
+    void initialize_weights()
+    {
+        for (size_t i = 0;i < m_w.size();++i) {
+            m_w[i] = 0.;
+            m_gsum[i] = 0.;
+            m_stamp[i] = 0.;
+        }
+        m_touched.clear();
+        m_memory.clear();
+        m_memory_index.clear();
+        m_norm22 = 0;
+        m_scale = 1;
+        m_sum_eta = 0;
+    }
+
+    /**
+     * Obtains the remembered gradients for an instance.
+     *  This function allocates the storage for the remembered gradients
+     *  when the instance is visited for the first time.
+     *  @param  inst        The pointer to the instance.
+     *  @param  size        The number of gradients remembered for the
+     *                      instance.
+     *  @return size_t      The offset of the gradients in m_memory.
+     */
+    size_t remembered(const void *inst, size_t size)
+    {
+        typename memory_index_type::const_iterator it = m_memory_index.find(inst);
+        if (it != m_memory_index.end()) {
+            return it->second;
+        }
+
+        size_t offset = m_memory.size();
+        m_memory.resize(offset + size, 0.);
+        m_memory_index.insert(
+            typename memory_index_type::value_type(inst, offset));
+        return offset;
+    }
+
+    /**
+     * Updates the learning rate for an instance.
+     *  Unless the learning rate is specified by the parameter, the learning
+     *  rate is set to 1 / (3 * L), where L is the maximum of the Lipschitz
+     *  constants of the gradients of instances observed so far.
+     *  @param  lipschitz   The Lipschitz constant for the current instance.
+     */
+    inline void update_learning_rate(value_type lipschitz)
+    {
+        if (m_eta0 <= 0. && m_max_lipschitz < lipschitz) {
+            m_max_lipschitz = lipschitz;
+            m_eta = 1. / (3. * (m_max_lipschitz + m_lambda));
+        }
+    }
+
+    /**
+     * Applies the pending corrections to the weight of a feature.
+     *  The average of the remembered gradients for the feature has not
+     *  changed since the last update of the feature. Therefore, the
+     *  corrections are computed at once from the accumulated step sizes.
+     *  @param  i           The feature index.
+     */
+    inline void catchup(int i)
+    {
+        value_type steps = m_sum_eta - m_stamp[i];
+        if (steps != 0.) {
+            m_w[i] -= steps * m_gsum[i] / m_n;
+            m_stamp[i] = m_sum_eta;
+        }
+    }
+
+    /**
+     * Applies the L2 regularization and accumulates the step size.
+     *  This function computes W *= (1 - eta * lambda) by updating the
+     *  scaling factor, and makes the average gradient for this update
+     *  pending for all features.
+     */
+    inline void decay()
+    {
+        m_scale *= (1. - m_eta * m_lambda);
+        m_sum_eta += m_eta / m_scale;
+    }
+
+    /**
+     * Finalizes the weight vector.
+     *  This function applies all pending corrections and computes the
+     *  actual weight vector W from the internal representation (V, scale).
+     *  The features that have never been updated have zero weights and
+     *  zero sums of remembered gradients, which need no corrections.
+     */
+    void rescale_weights()
+    {
+        m_norm22 = 0;
+        m_report.num_actives = 0;
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            const int i = *it;
+            this->catchup(i);
+            m_w[i] *= m_scale;
+            m_stamp[i] = 0.;
+            m_norm22 += (m_w[i] * m_w[i]);
+            if (m_w[i] != 0.) {
+                ++m_report.num_actives;
+            }
+        }
+
+        m_scale = 1;
+        m_sum_eta = 0;
+    }
+
+public:
+    /**
+     * Obtains the parameter interface.
+     *  @return parameter_exchange& The parameter interface associated with
+     *                              this algorithm.
+     */
+    parameter_exchange& params()
+    {
+        return m_params;
+    }
+
+public:
+    /**
+     * Obtains an access to the weight vector (model).
+     *  @return model_type&         The weight vector (model).
+     */
+    model_type& model()
+    {
+        if (m_scale != 1. || m_sum_eta != 0.) {
+            this->rescale_weights();
+        }
+        return m_w;
+    }
+
+    /**
+     * Obtains a read-only access to the weight vector (model).
+     *  @return const model_type&   The weight vector (model).
+     */
+    const model_type& model() const
+    {
+        // Force to remove the const modifier for rescaling.
+        return const_cast<this_class*>(this)->model();
+    }
+
+    value_type loss() const
+    {
+        return m_report.loss;
+    }
+};
+
+
+
+/**
+ * SAGA for binary classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class saga_binary :
+    public saga_base<error_tmpl>
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of the base class.
+    typedef saga_base<error_tmpl> base_class;
+    /// A synonym of this class.
+    typedef saga_binary<error_tmpl> this_class;
+
+public:
+    /**
+     * Receives a training instance and updates feature weights.
+     *  @param  it          An interator for the training instance.
+     */
+    template <class iterator_type>
+    void update(iterator_type it)
+    {
+        // Define synonyms to avoid using "this->" for member variables.
+        model_type& w = this->m_w;
+        value_type& scale = this->m_scale;
+        value_type& eta = this->m_eta;
+        value_type& loss = this->m_loss;
+
+        // Bring the weights of the features in the instance up to date.
+        value_type norm22 = this->catchup(it->begin(), it->end());
+
+        // Determine the learning rate. The Lipschitz constant of the
+        // gradient of the logistic loss is (|x|^2 / 4).
+        this->update_learning_rate(0.25 * it->get_weight() * norm22);
+
+        // Compute the error for the instance.
+        value_type nlogp = 0.;
+        error_type cls(w);
+        cls.inner_product(it->begin(), it->end());
+        cls.scale(scale);
+        value_type err = it->get_weight() * cls.error(it->get_label(), nlogp);
+        loss += (it->get_weight() * nlogp);
+
+        // Replace the remembered gradient with the new one.
+        value_type& prev = this->m_memory[this->remembered(&*it, 1)];
+        value_type delta = err - prev;
+        prev = err;
+
+        // W *= (1 - eta * lambda), and apply the average gradient for
+        // this update to the features in the instance.
+        this->decay();
+        this->catchup(it->begin(), it->end());
+
+        // W -= eta * (g_new - g_old) <==> V -= eta * (g_new - g_old) / scale.
+        this->update_weights(it->begin(), it->end(), delta, -eta / scale);
+
+        // Increment the update count.
+        ++this->m_t;
+    }
+
+    /**
+     * Receives multiple training instances and updates feature weights.
+     *  @param  first       The iterator pointing to the first instance.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      instance.
+     */
+    template <class iterator_type>
+    inline void update(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->update(it);
+        }
+    }
+
+protected:
+    /**
+     * Applies the pending corrections to the weights of a feature vector.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @return value_type  The square of the L2-norm of the feature vector.
+     */
+    template <class iterator_type>
+    inline value_type catchup(iterator_type first, iterator_type last)
+    {
+        value_type norm22 = 0.;
+        for (iterator_type it = first;it != last;++it) {
+            base_class::catchup(it->first);
+            norm22 += it->second * it->second;
+        }
+        return norm22;
+    }
+
+    /**
+     * Updates the weights and gradient sums for a feature vector.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @param  delta       The change of the gradient (error).
+     *  @param  gain        The gain multiplied to the change of the gradient.
+     */
+    template <class iterator_type>
+    inline void update_weights(
+        iterator_type first,
+        iterator_type last,
+        value_type delta,
+        value_type gain
+        )
+    {
+        model_type& w = this->m_w;
+        model_type& gsum = this->m_gsum;
+
+        for (iterator_type it = first;it != last;++it) {
+            value_type d = delta * it->second;
+            w[it->first] += gain * d;
+            gsum[it->first] += d;
+            this->m_touched.insert(it->first);
+        }
+    }
+};
+
+
+
+/**
+ * SAGA for multi classification.
+ *
+ *  @param  error_tmpl  The type of the error (loss) function.
+ */
+template <
+    class error_tmpl
+>
+class saga_multi :
+    public saga_base<error_tmpl>
+{
+public:
+    /// The type implementing an error function.
+    typedef error_tmpl error_type;
+    /// The type implementing a model (weight vector for features).
+    typedef typename error_type::model_type model_type;
+    /// The type representing a value.
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
+    /// A synonym of the base class.
+    typedef saga_base<error_tmpl> base_class;
+    /// A synonym of this class.
+    typedef saga_multi<error_tmpl> this_class;
+
+public:
+    /**
+     * Receives a training instance and updates feature weights.
+     *  @param  it          An interator for the training instance.
+     *  @param  fgen        The feature generator.
+     */
+    template <class iterator_type, class feature_generator_type>
+    void update(iterator_type it, feature_generator_type& fgen)
+    {
+        const int L = (int)fgen.num_labels();
+        const int N = it->num_candidates(L);
+
+        // Define synonyms to avoid using "this->" for member variables.
+        model_type& w = this->m_w;
+        value_type& scale = this->m_scale;
+        value_type& eta = this->m_eta;
+        value_type& loss = this->m_loss;
+
+        // Bring the weights of the features in the instance up to date.
+        value_type norm22 = 0.;
+        for (int i = 0;i < N;++i) {
+            value_type v = catchup(
+                i, fgen, it->attributes(i).begin(), it->attributes(i).end());
+            if (norm22 < v) {
+                norm22 = v;
+            }
+        }
+
+        // Determine the learning rate. The Lipschitz constant of the
+        // gradient of the soft-max loss is bounded by (max_i |x_i|^2 / 2).
+        this->update_learning_rate(0.5 * it->get_weight() * norm22);
+
+        // Compute the scores for the labels (candidates) in the instance.
+        error_type cls(w);
+        cls.resize(N);
+        for (int i = 0;i < N;++i) {
+            cls.inner_product(
+                i,
+                fgen,
+                it->attributes(i).begin(),
+                it->attributes(i).end(),
+                i
+                );
+            cls.scale(i, scale);
+        }
+        cls.finalize();
+
+        // Compute the loss for the instance.
+        loss += -it->get_weight() * cls.logprob(it->get_label());
+
+        // W *= (1 - eta * lambda), and apply the average gradient for
+        // this update to the features in the instance.
+        this->decay();
+        for (int i = 0;i < N;++i) {
+            catchup(i, fgen, it->attributes(i).begin(), it->attributes(i).end());
+        }
+
+        // Replace the remembered gradients with the new ones, and
+        // W -= eta * (g_new - g_old) <==> V -= eta * (g_new - g_old) / scale.
+        size_t offset = this->remembered(&*it, N);
+        for (int i = 0;i < N;++i) {
+            value_type err = it->get_weight() * cls.error(i, it->get_label());
+            value_type& prev = this->m_memory[offset + i];
+            value_type delta = err - prev;
+            prev = err;
+
+            update_weights(
+                i,
+                fgen,
+                it->attributes(i).begin(),
+                it->attributes(i).end(),
+                delta,
+                -eta / scale
+                );
+        }
+
+        // Increment the update count.
+        ++this->m_t;
+    }
+
+    /**
+     * Receives multiple training instances and updates feature weights.
+     *  @param  first       The iterator pointing to the first instance.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      instance.
+     */
+    template <class iterator_type>
+    inline void update(iterator_type first, iterator_type last)
+    {
+        for (iterator_type it = first;it != last;++it) {
+            this->update(it);
+        }
+    }
+
+protected:
+    /**
+     * Applies the pending corrections to the weights of a feature vector.
+     *  @param  l           The label or candidate index.
+     *  @param  fgen        The feature generator.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @return value_type  The square of the L2-norm of the feature vector.
+     */
+    template <class feature_generator_type, class iterator_type>
+    inline value_type catchup(
+        int l,
+        feature_generator_type& fgen,
+        iterator_type first,
+        iterator_type last
+        )
+    {
+        value_type norm22 = 0.;
+        for (iterator_type it = first;it != last;++it) {
+            typename feature_generator_type::feature_type f;
+            if (fgen.forward(it->first, l, f)) {
+                base_class::catchup((int)f);
+                norm22 += it->second * it->second;
+            }
+        }
+        return norm22;
+    }
+
+    /**
+     * Updates the weights and gradient sums for a feature vector.
+     *  @param  l           The label or candidate index.
+     *  @param  fgen        The feature generator.
+     *  @param  first       The iterator pointing to the first element of
+     *                      the feature vector.
+     *  @param  last        The iterator pointing just beyond the last
+     *                      element of the feature vector.
+     *  @param  delta       The change of the gradient (error).
+     *  @param  gain        The gain multiplied to the change of the gradient.
+     */
+    template <class feature_generator_type, class iterator_type>
+    inline void update_weights(
+        int l,
+        feature_generator_type& fgen,
+        iterator_type first,
+        iterator_type last,
+        value_type delta,
+        value_type gain
+        )
+    {
+        model_type& w = this->m_w;
+        model_type& gsum = this->m_gsum;
+
+        for (iterator_type it = first;it != last;++it) {
+            typename feature_generator_type::feature_type f;
+            if (fgen.forward(it->first, l, f)) {
+                value_type d = delta * it->second;
+                w[f] += gain * d;
+                gsum[f] += d;
+                this->m_touched.insert((int)f);
+            }
+        }
+    }
+};
+
+};
+
+};
+
+/*
+
+This is a naive pseudo-code of the SAGA algorithm for the objective
+    (lambda / 2) * |W|^2 + (1 / n) * sum_{i} loss_{i}(W),
+where each gradient of loss_{i} is g_{i} = err_{i} * x_{i}.
+
+1:  W = 0, G = 0, mem[i] = 0 for all instances
+2:  for epoch in range(max_epoch):
+3:      for inst in data:
+4:          err = error_function(W, inst)
+5:          delta = err - mem[inst]
+6:          mem[inst] = err
+7:          W = (1 - eta * lambda) * W
+8:          W -= eta * (delta * x + G / n)
+9:          G += delta * x
+10: return W
+
+Step 8 requires O(k) computations, where k is the total number of features,
+because the average gradient (G / n) is dense. However, G[f] changes only
+when the feature f appears in an instance. Between two updates of the
+feature f, the weight W[f] receives the same correction (G[f] / n) for
+every step, scaled by the learning rate of the step.
+
+Using the same representation as Pegasos, W = scale * V, the correction
+to V[f] in a step is eta * G[f] / (n * scale). We accumulate the step sizes
+    sum_eta = sum_{t} eta_{t} / scale_{t},
+and remember the value of sum_eta (stamp[f]) at the last update of V[f].
+The pending corrections are applied at once just before the feature f is
+used by an instance:
+    V[f] -= (sum_eta - stamp[f]) * G[f] / n
+This keeps each update O(d), where d is the number of active features in
+the current instance.
+
+*/
+
+#endif/*__CLASSIAS_TRAIN_SAGA_H__*/
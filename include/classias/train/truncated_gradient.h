@@ -68,7 +68,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of this class.
     typedef truncated_gradient_base<error_tmpl> this_class;
 
@@ -99,6 +99,8 @@ protected:
     model_type m_w;
     /// The array of L1 penalties previously applied to weights.
     model_type m_penalty;
+    /// The set of features whose weights have been updated.
+    index_set m_touched;
 
     /// The lambda (coefficient for L1 regularization).
     value_type m_lambda;
@@ -206,11 +208,12 @@ public:
     {
         this->apply_penalty();
 
-        // Fill the progress information.
+        // Fill the progress information. Only the features that have been
+        // updated can have non-zero weights.
         m_report.init();
         m_report.loss = m_loss;
-        for (size_t i = 0;i < m_w.size();++i) {
-            value_type v = m_w[i];
+        for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+            value_type v = m_w[*it];
             m_report.norm1 += std::fabs(v);
             m_report.norm2 += v * v;
             if (v != 0.) {
@@ -292,18 +295,21 @@ protected:
             m_w[i] = 0.;
             m_penalty[i] = 0.;
         }
+        m_touched.clear();
         m_sum_penalty = 0.;
         m_truncated = true;
     }
 
     /**
      * Applies the L1 penalties to the weight vector.
+     *  The features that have never been updated have zero weights, which
+     *  do not need L1 penalties.
      */
     inline void apply_penalty()
     {
         if (!m_truncated) {
-            for (int i = 0;i < (int)m_w.size();++i) {
-                apply_penalty(i);
+            for (index_set::const_iterator it = m_touched.begin();it != m_touched.end();++it) {
+                apply_penalty(*it);
             }
             m_truncated = true;
         }
@@ -393,7 +399,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of the base class.
     typedef truncated_gradient_base<error_tmpl> base_class;
     /// A synonym of this class.
@@ -466,6 +472,7 @@ protected:
         for (iterator_type it = first;it != last;++it) {
             this->m_w[it->first] += delta * it->second;
             this->m_penalty[it->first] = this->m_sum_penalty;
+            this->m_touched.insert(it->first);
         }
     }
 
@@ -505,7 +512,7 @@ public:
     /// The type implementing a model (weight vector for features).
     typedef typename error_type::model_type model_type;
     /// The type representing a value.
-    typedef typename model_type::value_type value_type;
+    typedef typename numeric_traits<typename model_type::value_type>::value_type value_type;
     /// A synonym of the base class.
     typedef truncated_gradient_base<error_tmpl> base_class;
     /// A synonym of this class.
@@ -620,6 +627,7 @@ protected:
             if (fgen.forward(it->first, l, f)) {
                 this->m_w[f] += delta * it->second;
                 this->m_penalty[f] = this->m_sum_penalty;
+                this->m_touched.insert((int)f);
             }
         }
     }
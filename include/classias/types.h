@@ -33,6 +33,11 @@
 #ifndef __CLASSIAS_TYPES_H__
 #define __CLASSIAS_TYPES_H__
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
 #include <vector>
 
 
@@ -382,17 +387,536 @@ public:
     {
         cont.push_back(element_type(id, value));
     }
+
+    /**
+     * Replaces the element identifiers by using a map.
+     *  This function replaces the identifier of every element with
+     *  map[identifier], and removes elements whose identifiers are mapped
+     *  to negative values. The order of the remaining elements is kept.
+     *  @param  map         The map from old identifiers to new ones.
+     */
+    template <class map_type>
+    inline void remap(const map_type& map)
+    {
+        iterator out = cont.begin();
+        for (iterator it = cont.begin();it != cont.end();++it) {
+            if (0 <= map[it->first]) {
+                out->first = map[it->first];
+                out->second = it->second;
+                ++out;
+            }
+        }
+
+        // Release the memory occupied by the removed elements.
+        if (out != cont.end()) {
+            container_type(cont.begin(), out).swap(cont);
+        }
+    }
+
+    /**
+     * Releases the memory reserved but not occupied by the elements.
+     */
+    inline void shrink()
+    {
+        if (cont.size() < cont.capacity()) {
+            container_type(cont).swap(cont);
+        }
+    }
+
+    /**
+     * Merges elements with the same identifier.
+     *  This function sorts the elements in ascending order of their
+     *  identifiers, and replaces elements with the same identifier with
+     *  a single element whose value is the sum of their values.
+     */
+    inline void canonicalize()
+    {
+        this->sort();
+
+        iterator out = cont.begin();
+        for (iterator it = cont.begin();it != cont.end();++it) {
+            if (out != cont.begin() && (out-1)->first == it->first) {
+                (out-1)->second += it->second;
+            } else {
+                *out = *it;
+                ++out;
+            }
+        }
+
+        // Release the memory occupied by the merged elements.
+        if (out != cont.end()) {
+            container_type(cont.begin(), out).swap(cont);
+        }
+    }
+
+    /**
+     * Computes a hash value of the elements.
+     *  @return size_t      The hash value computed from the identifiers and
+     *                      values of the elements (in their order).
+     */
+    inline size_t hash() const
+    {
+        // FNV-1a hash over the bytes of identifiers and values.
+        size_t h = 2166136261U;
+        for (const_iterator it = cont.begin();it != cont.end();++it) {
+            const unsigned char* p = (const unsigned char*)&it->first;
+            for (size_t i = 0;i < sizeof(it->first);++i) {
+                h = (h ^ p[i]) * 16777619U;
+            }
+            p = (const unsigned char*)&it->second;
+            for (size_t i = 0;i < sizeof(it->second);++i) {
+                h = (h ^ p[i]) * 16777619U;
+            }
+        }
+        return h;
+    }
+
+    /**
+     * Tests if two sparse vectors have the same elements in the same order.
+     *  @param  x           The sparse vector compared with this vector.
+     *  @retval bool        \c true if the elements are identical.
+     */
+    inline bool equals(const sparse_vector_base& x) const
+    {
+        return cont == x.cont;
+    }
+
+    /**
+     * Sorts the elements in ascending order of their identifiers.
+     *  Elements with the same identifier keep their order.
+     */
+    inline void sort()
+    {
+        std::stable_sort(cont.begin(), cont.end(), less_identifier);
+    }
+
+protected:
+    /**
+     * Compares the identifiers of two elements.
+     *  @param  x           An element.
+     *  @param  y           Another element.
+     *  @retval bool        \c true if the identifier of x is smaller.
+     */
+    static bool less_identifier(const element_type& x, const element_type& y)
+    {
+        return x.first < y.first;
+    }
+};
+
+
+
+/**
+ * A template class for compressed sparse vectors.
+ *
+ *  This class implements a sparse vector that stores elements in a byte
+ *  array to reduce the memory footprint and the memory traffic of training
+ *  algorithms. An element is encoded into a variable-length integer (7 bits
+ *  per byte) of the zigzag-encoded difference between its identifier and the
+ *  identifier of the previous element, shifted left by one bit. The lowest
+ *  bit indicates that the raw bytes of the element value follow; the value
+ *  is omitted if it is 1. Values are stored without loss, and the order of
+ *  elements is kept. Elements are decoded on the fly by the (read-only)
+ *  iterators, which expose (identifier, value) pairs in the same manner as
+ *  sparse_vector_base. Sorting the elements by their identifiers (e.g., by
+ *  renumbering attributes) makes the differences and thus the array smaller.
+ *
+ *  @param  identifier_base The type of element identifier.
+ *  @param  value_base      The type of element values.
+ */
+template <class identifier_base, class value_base>
+class compressed_sparse_vector_base
+{
+public:
+    /// A type representing an element identifier.
+    typedef identifier_base identifier_type;
+    /// A type representing an element value.
+    typedef value_base value_type;
+    /// A type representing an element, a pair of (identifier, value).
+    typedef std::pair<identifier_type, value_type> element_type;
+    /// A type providing a container of encoded elements.
+    typedef std::vector<unsigned char> container_type;
+    /// A type counting the number of elements in the vector.
+    typedef size_t size_type;
+
+    /**
+     * A read-only forward iterator decoding elements.
+     */
+    class const_iterator
+    {
+    public:
+        /// The category of this iterator.
+        typedef std::forward_iterator_tag iterator_category;
+        /// The type of an element.
+        typedef element_type value_type;
+        /// The type of a distance between iterators.
+        typedef std::ptrdiff_t difference_type;
+        /// The type of a pointer to an element.
+        typedef const element_type* pointer;
+        /// The type of a reference to an element.
+        typedef const element_type& reference;
+
+    protected:
+        /// The position of the current element.
+        const unsigned char* m_cur;
+        /// The position of the next element.
+        const unsigned char* m_next;
+        /// The end of the encoded elements.
+        const unsigned char* m_end;
+        /// The current element.
+        element_type m_elem;
+
+    public:
+        /**
+         * Constructs an iterator.
+         *  @param  cur     The position of the current element.
+         *  @param  end     The end of the encoded elements.
+         */
+        const_iterator(const unsigned char* cur = NULL, const unsigned char* end = NULL)
+            : m_cur(cur), m_next(cur), m_end(end), m_elem(0, 1)
+        {
+            decode();
+        }
+
+        /**
+         * Returns the current element.
+         *  @return reference   The reference to the decoded element.
+         */
+        inline reference operator*() const
+        {
+            return m_elem;
+        }
+
+        /**
+         * Returns the pointer to the current element.
+         *  @return pointer     The pointer to the decoded element.
+         */
+        inline pointer operator->() const
+        {
+            return &m_elem;
+        }
+
+        /**
+         * Moves to the next element (prefix increment).
+         *  @return const_iterator& The reference to this iterator.
+         */
+        inline const_iterator& operator++()
+        {
+            m_cur = m_next;
+            decode();
+            return *this;
+        }
+
+        /**
+         * Moves to the next element (postfix increment).
+         *  @return const_iterator  The iterator before the increment.
+         */
+        inline const_iterator operator++(int)
+        {
+            const_iterator it = *this;
+            ++(*this);
+            return it;
+        }
+
+        /**
+         * Tests if two iterators address the same position.
+         *  @param  x           Another iterator.
+         *  @retval bool        \c true if the positions are identical.
+         */
+        inline bool operator==(const const_iterator& x) const
+        {
+            return m_cur == x.m_cur;
+        }
+
+        /**
+         * Tests if two iterators address different positions.
+         *  @param  x           Another iterator.
+         *  @retval bool        \c true if the positions are different.
+         */
+        inline bool operator!=(const const_iterator& x) const
+        {
+            return m_cur != x.m_cur;
+        }
+
+    protected:
+        /**
+         * Decodes the element at the current position.
+         */
+        inline void decode()
+        {
+            if (m_cur != m_end) {
+                const unsigned char* p = m_cur;
+
+                // Read a variable-length integer.
+                size_t code = 0;
+                for (int shift = 0;;shift += 7) {
+                    const unsigned char b = *p++;
+                    code |= (size_t)(b & 0x7F) << shift;
+                    if (!(b & 0x80)) {
+                        break;
+                    }
+                }
+
+                // Restore the identifier from the zigzag-encoded difference.
+                const size_t zz = code >> 1;
+                if (zz & 1) {
+                    m_elem.first -= (identifier_type)(zz >> 1) + 1;
+                } else {
+                    m_elem.first += (identifier_type)(zz >> 1);
+                }
+
+                // Read the value if it follows.
+                if (code & 1) {
+                    std::memcpy(&m_elem.second, p, sizeof(m_elem.second));
+                    p += sizeof(m_elem.second);
+                } else {
+                    m_elem.second = 1;
+                }
+                m_next = p;
+            }
+        }
+    };
+
+    /// A type providing a read-only iterator (elements are read-only).
+    typedef const_iterator iterator;
+
+protected:
+    /// The encoded elements.
+    container_type cont;
+    /// The number of elements.
+    size_type m_size;
+    /// The identifier of the last element.
+    identifier_type m_last;
+
+public:
+    /**
+     * Constructs a sparse vector.
+     */
+    compressed_sparse_vector_base() : m_size(0), m_last(0)
+    {
+    }
+
+    /**
+     * Destructs the sparse vector.
+     */
+    virtual ~compressed_sparse_vector_base()
+    {
+    }
+
+    /**
+     * Erases all the elements of the vector.
+     */
+    inline void clear()
+    {
+        cont.clear();
+        m_size = 0;
+        m_last = 0;
+    }
+
+    /**
+     * Tests if the sparse vector is empty.
+     *  @retval bool        \c true if the sparse vector is empty,
+     *                      \c false otherwise.
+     */
+    inline bool empty() const
+    {
+        return (m_size == 0);
+    }
+
+    /**
+     * Returns the number of elements in the vector.
+     *  @retval size_type   The current size of the sparse vector.
+     */
+    inline size_type size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * Returns the number of bytes occupied by the encoded elements.
+     *  @retval size_type   The number of bytes.
+     */
+    inline size_type bytes() const
+    {
+        return cont.size();
+    }
+
+    /**
+     * Returns a read-only iterator to the first element.
+     *  @retval const_iterator  An iterator addressing the first element in
+     *                          the vector or to the location succeeding an
+     *                          empty element.
+     */
+    inline const_iterator begin() const
+    {
+        const unsigned char* p = cont.empty() ? NULL : &cont[0];
+        return const_iterator(p, p + cont.size());
+    }
+
+    /**
+     * Returns a read-only iterator pointing just beyond the last element.
+     *  @retval const_iterator  An iterator addressing the end of the element.
+     */
+    inline const_iterator end() const
+    {
+        const unsigned char* p = cont.empty() ? NULL : &cont[0] + cont.size();
+        return const_iterator(p, p);
+    }
+
+    /**
+     * Appends an element (name, value) to the end of the vector.
+     *  @param  id          The element identifier.
+     *  @param  value       The element value.
+     */
+    inline void append(const identifier_type& id, const value_type& value)
+    {
+        // Zigzag-encode the difference of the identifiers.
+        size_t code = (id < m_last) ?
+            (((size_t)(m_last - id) - 1) << 1) | 1 :
+            ((size_t)(id - m_last) << 1);
+        code = (code << 1) | (value != 1 ? 1 : 0);
+
+        // Write a variable-length integer.
+        while (0x80 <= code) {
+            cont.push_back((unsigned char)(code & 0x7F) | 0x80);
+            code >>= 7;
+        }
+        cont.push_back((unsigned char)code);
+
+        // Write the value if necessary.
+        if (value != 1) {
+            const unsigned char* p = (const unsigned char*)&value;
+            cont.insert(cont.end(), p, p + sizeof(value_type));
+        }
+
+        m_last = id;
+        ++m_size;
+    }
+
+    /**
+     * Releases the memory reserved but not occupied by the elements.
+     */
+    inline void shrink()
+    {
+        if (cont.size() < cont.capacity()) {
+            container_type(cont).swap(cont);
+        }
+    }
+
+    /**
+     * Replaces the element identifiers by using a map.
+     *  This function replaces the identifier of every element with
+     *  map[identifier], and removes elements whose identifiers are mapped
+     *  to negative values. The order of the remaining elements is kept.
+     *  @param  map         The map from old identifiers to new ones.
+     */
+    template <class map_type>
+    inline void remap(const map_type& map)
+    {
+        std::vector<element_type> elems;
+        for (const_iterator it = begin();it != end();++it) {
+            if (0 <= map[it->first]) {
+                elems.push_back(element_type(map[it->first], it->second));
+            }
+        }
+        assign(elems);
+    }
+
+    /**
+     * Merges elements with the same identifier.
+     *  This function sorts the elements in ascending order of their
+     *  identifiers, and replaces elements with the same identifier with
+     *  a single element whose value is the sum of their values.
+     */
+    inline void canonicalize()
+    {
+        std::vector<element_type> elems(begin(), end());
+        std::stable_sort(elems.begin(), elems.end(), less_identifier);
+
+        typename std::vector<element_type>::iterator out = elems.begin();
+        typename std::vector<element_type>::iterator it;
+        for (it = elems.begin();it != elems.end();++it) {
+            if (out != elems.begin() && (out-1)->first == it->first) {
+                (out-1)->second += it->second;
+            } else {
+                *out = *it;
+                ++out;
+            }
+        }
+        elems.erase(out, elems.end());
+        assign(elems);
+    }
+
+    /**
+     * Computes a hash value of the elements.
+     *  @return size_t      The hash value computed from the encoded elements.
+     */
+    inline size_t hash() const
+    {
+        // FNV-1a hash over the encoded elements.
+        size_t h = 2166136261U;
+        for (container_type::const_iterator it = cont.begin();it != cont.end();++it) {
+            h = (h ^ *it) * 16777619U;
+        }
+        return h;
+    }
+
+    /**
+     * Tests if two sparse vectors have the same elements in the same order.
+     *  @param  x           The sparse vector compared with this vector.
+     *  @retval bool        \c true if the elements are identical.
+     */
+    inline bool equals(const compressed_sparse_vector_base& x) const
+    {
+        return cont == x.cont;
+    }
+
+    /**
+     * Sorts the elements in ascending order of their identifiers.
+     *  Elements with the same identifier keep their order.
+     */
+    inline void sort()
+    {
+        std::vector<element_type> elems(begin(), end());
+        std::stable_sort(elems.begin(), elems.end(), less_identifier);
+        assign(elems);
+    }
+
+protected:
+    /**
+     * Replaces the elements with decoded ones.
+     *  @param  elems       The elements.
+     */
+    void assign(const std::vector<element_type>& elems)
+    {
+        clear();
+        for (size_t i = 0;i < elems.size();++i) {
+            append(elems[i].first, elems[i].second);
+        }
+        shrink();
+    }
+
+    /**
+     * Compares the identifiers of two elements.
+     *  @param  x           An element.
+     *  @param  y           Another element.
+     *  @retval bool        \c true if the identifier of x is smaller.
+     */
+    static bool less_identifier(const element_type& x, const element_type& y)
+    {
+        return x.first < y.first;
+    }
 };
 
 
 
 template <
-    class type
+    class type,
+    class allocator_type = std::allocator<type>
     >
-class default_vector : public std::vector<type>
+class default_vector : public std::vector<type, allocator_type>
 {
 public:
-    typedef std::vector<type> base_type;
+    typedef std::vector<type, allocator_type> base_type;
 
 public:
     default_vector()
@@ -417,6 +941,468 @@ public:
     }
 };
 
+
+
+/**
+ * A growable vector storing elements in fixed-size pages.
+ *
+ *  This class provides the subset of the interface of std::vector used by
+ *  classifiers and training algorithms for a model (weight vector) whose
+ *  size is unknown in advance, e.g., in online training on a feature space
+ *  growing without bound. Elements are stored in pages of 2^page_bits
+ *  elements, which are allocated (and initialized with zeros) when an
+ *  element in the page is accessed by the non-const operator[] for the
+ *  first time, whether the element is read or written. An element is
+ *  located with a shift and a mask; growing the vector never relocates
+ *  the existing elements, but only extends the table of page pointers.
+ *
+ *  The non-const operator[] extends the size of the vector to include the
+ *  index. The const operator[] never allocates memory: it returns zero for
+ *  an element in a page that has not been allocated yet, so read a vector
+ *  through a const reference to avoid allocating the pages of unknown
+ *  features.
+ *
+ *  @param  type            The type of an element.
+ *  @param  allocator_type  The allocator for pages.
+ *  @param  page_bits       The base-2 logarithm of the number of elements
+ *                          in a page (a page of doubles fills a 2MB huge
+ *                          page by default).
+ */
+template <
+    class type,
+    class allocator_type = std::allocator<type>,
+    int page_bits = 18
+    >
+class paged_vector
+{
+public:
+    /// The type of an element.
+    typedef type value_type;
+    /// The type of a reference to an element.
+    typedef type& reference;
+    /// The type of a read-only reference to an element.
+    typedef const type& const_reference;
+    /// A type counting the number of elements.
+    typedef size_t size_type;
+
+protected:
+    /// A type providing a table of pages.
+    typedef std::vector<value_type*> pages_type;
+
+    /// The number of elements in a page.
+    static const size_type page_size = ((size_type)1 << page_bits);
+    /// The mask for the offset of an element in a page.
+    static const size_type page_mask = page_size - 1;
+
+    /// The table of pages (NULL for a page that has not been allocated).
+    pages_type m_pages;
+    /// The number of elements.
+    size_type m_size;
+    /// The allocator for pages.
+    allocator_type m_alloc;
+
+public:
+    /**
+     * Constructs an empty vector.
+     */
+    paged_vector() : m_size(0)
+    {
+    }
+
+    /**
+     * Constructs a vector with zeros.
+     *  @param  n           The number of elements.
+     */
+    explicit paged_vector(size_type n) : m_size(0)
+    {
+        resize(n);
+    }
+
+    /**
+     * Constructs a copy of a vector.
+     *  @param  x           The vector to copy.
+     */
+    paged_vector(const paged_vector& x) : m_size(0)
+    {
+        *this = x;
+    }
+
+    /**
+     * Destructs the vector.
+     */
+    virtual ~paged_vector()
+    {
+        clear();
+    }
+
+    /**
+     * Copies a vector.
+     *  @param  x           The vector to copy.
+     *  @return paged_vector&   This object.
+     */
+    paged_vector& operator=(const paged_vector& x)
+    {
+        if (this != &x) {
+            clear();
+            m_pages.resize(x.m_pages.size(), NULL);
+            for (size_type p = 0;p < x.m_pages.size();++p) {
+                if (x.m_pages[p] != NULL) {
+                    std::copy(x.m_pages[p], x.m_pages[p] + page_size, page(p));
+                }
+            }
+            m_size = x.m_size;
+        }
+        return *this;
+    }
+
+    /**
+     * Exchanges the elements with another vector.
+     *  @param  x           The vector.
+     */
+    void swap(paged_vector& x)
+    {
+        m_pages.swap(x.m_pages);
+        std::swap(m_size, x.m_size);
+    }
+
+    /**
+     * Returns the number of elements.
+     *  @return size_type   The number of elements.
+     */
+    inline size_type size() const
+    {
+        return m_size;
+    }
+
+    /**
+     * Tests if the vector is empty.
+     *  @return bool        \c true if the vector is empty.
+     */
+    inline bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    /**
+     * Releases all of the pages.
+     */
+    void clear()
+    {
+        for (size_type p = 0;p < m_pages.size();++p) {
+            free_page(p);
+        }
+        m_pages.clear();
+        m_size = 0;
+    }
+
+    /**
+     * Changes the number of elements.
+     *  This function does not allocate pages; the new elements are zeros.
+     *  @param  n           The number of elements.
+     */
+    void resize(size_type n)
+    {
+        if (n < m_size) {
+            // Release the pages beyond the new size, and reset the rest of
+            // the last page so that the elements become zeros when the
+            // vector grows again.
+            const size_type num_pages = (n + page_mask) >> page_bits;
+            for (size_type p = num_pages;p < m_pages.size();++p) {
+                free_page(p);
+            }
+            m_pages.resize(num_pages);
+            if ((n & page_mask) != 0 && m_pages[n >> page_bits] != NULL) {
+                value_type* block = m_pages[n >> page_bits];
+                std::fill(block + (n & page_mask), block + page_size, value_type());
+            }
+        }
+        m_size = n;
+    }
+
+    /**
+     * Returns a reference to an element.
+     *  This function extends the vector to include the element if
+     *  necessary, and allocates the page of the element on first access.
+     *  @param  i           The index of the element.
+     *  @return reference   The reference to the element.
+     */
+    inline reference operator[](size_type i)
+    {
+        if (m_size <= i) {
+            m_size = i+1;
+        }
+        const size_type p = (i >> page_bits);
+        if (p < m_pages.size() && m_pages[p] != NULL) {
+            return m_pages[p][i & page_mask];
+        }
+        return page(p)[i & page_mask];
+    }
+
+    /**
+     * Returns a read-only reference to an element.
+     *  This function never allocates memory.
+     *  @param  i           The index of the element.
+     *  @return const_reference The reference to the element, or to zero if
+     *                      the page of the element has not been allocated.
+     */
+    inline const_reference operator[](size_type i) const
+    {
+        static const value_type zero = value_type();
+        const size_type p = (i >> page_bits);
+        if (p < m_pages.size() && m_pages[p] != NULL) {
+            return m_pages[p][i & page_mask];
+        }
+        return zero;
+    }
+
+protected:
+    /**
+     * Returns a page, allocating it if necessary.
+     *  @param  p           The index of the page.
+     *  @return value_type* The pointer to the first element in the page.
+     */
+    value_type* page(size_type p)
+    {
+        if (m_pages.size() <= p) {
+            m_pages.resize(p+1, NULL);
+        }
+        if (m_pages[p] == NULL) {
+            value_type* block = m_alloc.allocate(page_size);
+            std::uninitialized_fill(block, block + page_size, value_type());
+            m_pages[p] = block;
+        }
+        return m_pages[p];
+    }
+
+    /**
+     * Releases a page.
+     *  @param  p           The index of the page.
+     */
+    void free_page(size_type p)
+    {
+        if (m_pages[p] != NULL) {
+            m_alloc.deallocate(m_pages[p], page_size);
+            m_pages[p] = NULL;
+        }
+    }
+};
+
+
+
+/**
+ * Numeric traits of feature weights.
+ *
+ *  A model (weight vector) may store feature weights in single precision
+ *  (\c float) to halve its memory footprint. Classifiers and training
+ *  algorithms compute scores, losses, and updates with the type
+ *  numeric_traits<T>::value_type, where \c T is the type of stored values;
+ *  it is \c double for both \c float and \c double storage.
+ *
+ *  @param  storage_tmpl    The type of values stored in a model.
+ */
+template <
+    class storage_tmpl
+    >
+struct numeric_traits
+{
+    /// The type for computing values.
+    typedef double value_type;
+};
+
+
+
+/**
+ * An allocator of the same kind as another allocator, allocating another
+ * type.
+ *
+ *  The member template rebind of std::allocator is deprecated in C++17 and
+ *  removed in C++20; this class uses std::allocator_traits if the compiler
+ *  supports C++11 (or Visual C++ 2012 and later), and the member template
+ *  rebind otherwise.
+ *
+ *  @param  allocator_tmpl  The type of the original allocator.
+ *  @param  value_tmpl      The type of values allocated by the new
+ *                          allocator.
+ */
+template <
+    class allocator_tmpl,
+    class value_tmpl
+    >
+struct rebind_allocator
+{
+#if     201103L <= __cplusplus || (defined(_MSC_VER) && 1700 <= _MSC_VER)
+    typedef typename std::allocator_traits<allocator_tmpl>::template rebind_alloc<value_tmpl> allocator_type;
+#else
+    typedef typename allocator_tmpl::template rebind<value_tmpl>::other allocator_type;
+#endif
+};
+
+
+
+/**
+ * A container of the same kind as another container, holding another type.
+ *
+ *  Training algorithms use this class to allocate auxiliary arrays that
+ *  must keep double precision (e.g., time stamps of lazy updates) and grow
+ *  in the same way as a (possibly single-precision) model.
+ *
+ *  @param  container_tmpl  The type of the original container.
+ *  @param  value_tmpl      The type of values of the new container.
+ */
+template <
+    class container_tmpl,
+    class value_tmpl
+    >
+struct rebind_container;
+
+template <
+    class type,
+    class allocator_type,
+    class value_tmpl
+    >
+struct rebind_container<std::vector<type, allocator_type>, value_tmpl>
+{
+    typedef std::vector<
+        value_tmpl,
+        typename rebind_allocator<allocator_type, value_tmpl>::allocator_type
+        > container_type;
+};
+
+template <
+    class type,
+    class allocator_type,
+    class value_tmpl
+    >
+struct rebind_container<default_vector<type, allocator_type>, value_tmpl>
+{
+    typedef default_vector<
+        value_tmpl,
+        typename rebind_allocator<allocator_type, value_tmpl>::allocator_type
+        > container_type;
+};
+
+template <
+    class type,
+    class allocator_type,
+    int page_bits,
+    class value_tmpl
+    >
+struct rebind_container<paged_vector<type, allocator_type, page_bits>, value_tmpl>
+{
+    typedef paged_vector<
+        value_tmpl,
+        typename rebind_allocator<allocator_type, value_tmpl>::allocator_type,
+        page_bits
+        > container_type;
+};
+
+
+
+/**
+ * A set of indices (e.g., features touched by a training algorithm).
+ *
+ *  This class remembers the indices inserted to the set in the order of
+ *  their first insertions. Inserting an index and testing the membership
+ *  take O(1) time; enumerating and clearing the set take the time
+ *  proportional to the number of elements in the set, not to the largest
+ *  index. Training algorithms use this class to restrict O(K) operations
+ *  on the weight vector to the features that are actually updated.
+ */
+class index_set
+{
+public:
+    /// The type representing an index.
+    typedef int index_type;
+    /// A type providing a read-only iterator for the indices.
+    typedef std::vector<index_type>::const_iterator const_iterator;
+    /// A type counting the number of indices in the set.
+    typedef std::vector<index_type>::size_type size_type;
+
+protected:
+    /// The indices in the set.
+    std::vector<index_type> m_indices;
+    /// The flags indicating the membership of indices.
+    std::vector<bool> m_flags;
+
+public:
+    /**
+     * Constructs an empty set.
+     */
+    index_set()
+    {
+    }
+
+    /**
+     * Destructs the set.
+     */
+    virtual ~index_set()
+    {
+    }
+
+    /**
+     * Inserts an index to the set.
+     *  @param  i           The index.
+     */
+    inline void insert(index_type i)
+    {
+        if (m_flags.size() <= (size_type)i) {
+            m_flags.resize(i+1, false);
+        }
+        if (!m_flags[i]) {
+            m_flags[i] = true;
+            m_indices.push_back(i);
+        }
+    }
+
+    /**
+     * Tests if the set contains an index.
+     *  @param  i           The index.
+     *  @retval bool        \c true if the set contains the index.
+     */
+    inline bool contains(index_type i) const
+    {
+        return ((size_type)i < m_flags.size() && m_flags[i]);
+    }
+
+    /**
+     * Removes all the indices from the set.
+     */
+    inline void clear()
+    {
+        for (const_iterator it = m_indices.begin();it != m_indices.end();++it) {
+            m_flags[*it] = false;
+        }
+        m_indices.clear();
+    }
+
+    /**
+     * Returns the number of indices in the set.
+     *  @retval size_type   The number of indices.
+     */
+    inline size_type size() const
+    {
+        return m_indices.size();
+    }
+
+    /**
+     * Returns an iterator to the first index in the set.
+     *  @retval const_iterator  A read-only iterator.
+     */
+    inline const_iterator begin() const
+    {
+        return m_indices.begin();
+    }
+
+    /**
+     * Returns an iterator pointing just beyond the last index in the set.
+     *  @retval const_iterator  A read-only iterator.
+     */
+    inline const_iterator end() const
+    {
+        return m_indices.end();
+    }
+};
+
 };
 
 #endif/*__CLASSIAS_TYPES_H__*/
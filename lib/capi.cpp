@@ -0,0 +1,134 @@
+/*
+ *		C API of the predictors (libclassias).
+ *
+ * Copyright (c) 2008,2009 Naoaki Okazaki
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of the authors nor the names of its contributors
+ *       may be used to endorse or promote products derived from this
+ *       software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER
+ * OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/* $Id$ */
+
+#ifdef  HAVE_CONFIG_H
+#include <config.h>
+#endif/*HAVE_CONFIG_H*/
+
+#include <cstring>
+#include <exception>
+#include <new>
+
+#include <classias/predictor.h>
+#include <classias/capi.h>
+
+struct tag_classias_predictor
+{
+    classias::predictor impl;
+};
+
+static void set_error(char *error, size_t size, const char *msg)
+{
+    if (error != NULL && 0 < size) {
+        std::strncpy(error, msg, size - 1);
+        error[size-1] = '\0';
+    }
+}
+
+classias_predictor_t* classias_predictor_open(const char *filename, char *error, size_t size)
+{
+    classias_predictor_t* p = new(std::nothrow) classias_predictor_t;
+    if (p == NULL) {
+        set_error(error, size, "out of memory");
+        return NULL;
+    }
+
+    try {
+        p->impl.open(filename);
+    } catch (const std::exception& e) {
+        set_error(error, size, e.what());
+        delete p;
+        return NULL;
+    }
+    return p;
+}
+
+void classias_predictor_close(classias_predictor_t* p)
+{
+    delete p;
+}
+
+int classias_predictor_type(const classias_predictor_t* p)
+{
+    return p->impl.type();
+}
+
+int classias_predictor_num_labels(const classias_predictor_t* p)
+{
+    return p->impl.num_labels();
+}
+
+const char* classias_predictor_label(const classias_predictor_t* p, int i, size_t *length)
+{
+    return p->impl.label(i, *length);
+}
+
+int classias_predictor_feature(const classias_predictor_t* p, const char *name, size_t length)
+{
+    return p->impl.feature(name, length);
+}
+
+double classias_predictor_score(const classias_predictor_t* p, const int *features, const double *values, size_t n)
+{
+    return p->impl.score(features, values, n);
+}
+
+double classias_predictor_score_names(const classias_predictor_t* p, const char * const *names, const double *values, size_t n)
+{
+    return p->impl.score(names, values, n);
+}
+
+int classias_predictor_score_labels(const classias_predictor_t* p, const int *attributes, const double *values, size_t n, double *scores)
+{
+    return p->impl.score_labels(attributes, values, n, scores);
+}
+
+int classias_predictor_score_labels_names(const classias_predictor_t* p, const char * const *attributes, const double *values, size_t n, double *scores)
+{
+    return p->impl.score_labels(attributes, values, n, scores);
+}
+
+int classias_predictor_score_candidates(const classias_predictor_t* p, const int *features, const double *values, const size_t *offsets, size_t num_candidates, double *scores)
+{
+    return p->impl.score_candidates(features, values, offsets, num_candidates, scores);
+}
+
+double classias_logistic(double score)
+{
+    return classias::predictor::logistic(score);
+}
+
+void classias_softmax(double *scores, int n)
+{
+    classias::predictor::softmax(scores, n);
+}
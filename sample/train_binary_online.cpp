@@ -37,13 +37,15 @@
 #include <classias/classias.h>
 #include <classias/classify/linear/binary.h>
 #include <classias/train/pegasos.h>
+#include <classias/train/ftrl.h>
 
 #include "strsplit.h"   // necessary for strsplit() and get_id_value().
 
 typedef classias::expandable_weight_vector model_type;
 
 // Define the type of a training algorithm. Change this type to use a
-// different online training algorithm.
+// different online training algorithm, e.g., classias::train::ftrl_binary
+// for sparse models with per-coordinate learning rates.
 typedef classias::train::pegasos_binary<
     classias::classify::linear_binary_hinge<model_type>
     >